@@ -0,0 +1,42 @@
+// No copyright.
+// Bump allocator for per compilation unit data.
+
+#include "Arena.hpp"
+
+#include <cstdint>
+
+Arena::Arena(const std::size_t block_size) : block_size_(block_size) {}
+
+void* Arena::allocate(const std::size_t size, const std::size_t alignment) {
+  auto address = reinterpret_cast<std::uintptr_t>(current_);
+  auto aligned = (address + alignment - 1) & ~(alignment - 1);
+  if (current_ == nullptr ||
+      aligned + size > reinterpret_cast<std::uintptr_t>(end_)) {
+    addBlock(size + alignment);
+    address = reinterpret_cast<std::uintptr_t>(current_);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+
+  current_ = reinterpret_cast<std::byte*>(aligned + size);
+  bytes_allocated_ += size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::reset() noexcept {
+  if (blocks_.empty()) {
+    return;
+  }
+  blocks_.resize(1);
+  current_ = blocks_.front().data.get();
+  end_ = current_ + blocks_.front().size;
+  bytes_allocated_ = 0;
+}
+
+void Arena::addBlock(const std::size_t min_size) {
+  const auto size = min_size > block_size_ ? min_size : block_size_;
+  // Not value initialized, the arena only hands out memory it overwrites.
+  blocks_.push_back(
+      Block{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+  current_ = blocks_.back().data.get();
+  end_ = current_ + size;
+}
@@ -0,0 +1,56 @@
+// No copyright.
+// Bump allocator for per compilation unit data.
+
+#ifndef LIB_ARENA_HPP_
+#define LIB_ARENA_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Hands out memory from large blocks and frees all of it at once on reset()
+// or destruction. Destructors of created objects are never run, so only
+// trivially destructible types may be created.
+class Arena final {
+ public:
+  explicit Arena(std::size_t block_size = kDefaultBlockSize);
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() = default;
+
+  void* allocate(std::size_t size, std::size_t alignment);
+
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  // Releases everything allocated so far. The first block is kept for reuse.
+  void reset() noexcept;
+
+  std::size_t bytesAllocated() const noexcept { return bytes_allocated_; }
+
+ private:
+  static constexpr std::size_t kDefaultBlockSize = 64 * 1024;
+
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+
+  void addBlock(std::size_t min_size);
+
+  const std::size_t block_size_;
+  std::vector<Block> blocks_;
+  std::byte* current_ = nullptr;
+  std::byte* end_ = nullptr;
+  std::size_t bytes_allocated_ = 0;
+};
+
+#endif  // LIB_ARENA_HPP_
@@ -0,0 +1,245 @@
+// No copyright.
+// Vectorized Jack character classifier.
+
+#include "CharClassifier.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+enum CharClassBit : unsigned char {
+  kSymbolBit = 1 << 0,
+  kWhitespaceBit = 1 << 1,
+  kQuoteBit = 1 << 2,
+  kIdentifierBit = 1 << 3,
+};
+
+constexpr char kSymbolChars[] = "{}()[].,;+-*/&|<>=~";
+constexpr char kWhitespaceChars[] = " \t\r\n";
+
+constexpr std::array<unsigned char, 256> makeCharClassBits() {
+  std::array<unsigned char, 256> table{};
+  for (const auto c : kSymbolChars) {
+    if (c != '\0') {
+      table[static_cast<unsigned char>(c)] |= kSymbolBit;
+    }
+  }
+  for (const auto c : kWhitespaceChars) {
+    if (c != '\0') {
+      table[static_cast<unsigned char>(c)] |= kWhitespaceBit;
+    }
+  }
+  table['"'] |= kQuoteBit;
+  for (auto c = '0'; c <= '9'; ++c) {
+    table[static_cast<unsigned char>(c)] |= kIdentifierBit;
+  }
+  for (auto c = 'a'; c <= 'z'; ++c) {
+    table[static_cast<unsigned char>(c)] |= kIdentifierBit;
+  }
+  for (auto c = 'A'; c <= 'Z'; ++c) {
+    table[static_cast<unsigned char>(c)] |= kIdentifierBit;
+  }
+  table['_'] |= kIdentifierBit;
+  return table;
+}
+
+constexpr auto kCharClassBits = makeCharClassBits();
+
+#if defined(__AVX2__)
+
+// Symbol, whitespace and quote bytes are recognized with two nibble lookups
+// as in simdjson: class = lo_table[c & 0xf] & hi_table[c >> 4].
+//   bit 0: symbols 0x26, 0x28-0x2f.    bit 1: symbols 0x3b-0x3e, 0x7b-0x7e.
+//   bit 2: symbols 0x5b, 0x5d.         bit 3: space.
+//   bit 4: '\t', '\n', '\r'.           bit 5: quote.
+inline void classify32(const char* data, std::uint32_t* symbol,
+                       std::uint32_t* whitespace, std::uint32_t* quote,
+                       std::uint32_t* identifier) noexcept {
+  const __m256i lo_table =
+      _mm256_setr_epi8(8, 0, 32, 0, 0, 0, 1, 0, 1, 17, 17, 7, 3, 23, 3, 1, 8,
+                       0, 32, 0, 0, 0, 1, 0, 1, 17, 17, 7, 3, 23, 3, 1);
+  const __m256i hi_table =
+      _mm256_setr_epi8(16, 0, 41, 2, 0, 4, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 16,
+                       0, 41, 2, 0, 4, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i low_nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+
+  const __m256i input =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  const __m256i lo = _mm256_and_si256(input, low_nibble_mask);
+  const __m256i hi =
+      _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble_mask);
+  const __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(lo_table, lo),
+                                           _mm256_shuffle_epi8(hi_table, hi));
+
+  const auto not_set = [&](const int bits) {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_and_si256(classes, _mm256_set1_epi8(bits)), zero)));
+  };
+  *symbol = ~not_set(0x07);
+  *whitespace = ~not_set(0x18);
+  *quote = ~not_set(0x20);
+
+  const __m256i lower = _mm256_or_si256(input, _mm256_set1_epi8(0x20));
+  const __m256i alpha =
+      _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+  const __m256i digit =
+      _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('0' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), input));
+  const __m256i underscore =
+      _mm256_cmpeq_epi8(input, _mm256_set1_epi8('_'));
+  *identifier = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_or_si256(alpha, digit), underscore)));
+}
+
+CharClassMasks classify64(const char* data) noexcept {
+  CharClassMasks masks;
+  for (std::size_t offset = 0; offset < kCharBlockSize; offset += 32) {
+    std::uint32_t symbol, whitespace, quote, identifier;
+    classify32(data + offset, &symbol, &whitespace, &quote, &identifier);
+    masks.symbol |= static_cast<std::uint64_t>(symbol) << offset;
+    masks.whitespace |= static_cast<std::uint64_t>(whitespace) << offset;
+    masks.quote |= static_cast<std::uint64_t>(quote) << offset;
+    masks.identifier |= static_cast<std::uint64_t>(identifier) << offset;
+  }
+  return masks;
+}
+
+#elif defined(__SSE2__)
+
+// SSE2 has no byte shuffle, so symbols are matched with one compare each.
+// That is still a fixed cost per 16 bytes, independent of the line layout.
+inline std::uint32_t matchAny16(const __m128i input, const char* chars) {
+  __m128i matched = _mm_setzero_si128();
+  for (; *chars != '\0'; ++chars) {
+    matched =
+        _mm_or_si128(matched, _mm_cmpeq_epi8(input, _mm_set1_epi8(*chars)));
+  }
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(matched));
+}
+
+CharClassMasks classify64(const char* data) noexcept {
+  CharClassMasks masks;
+  for (std::size_t offset = 0; offset < kCharBlockSize; offset += 16) {
+    const __m128i input =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+
+    const __m128i lower = _mm_or_si128(input, _mm_set1_epi8(0x20));
+    const __m128i alpha =
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                      _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    const __m128i digit =
+        _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('0' - 1)),
+                      _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), input));
+    const __m128i underscore = _mm_cmpeq_epi8(input, _mm_set1_epi8('_'));
+    const auto identifier = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(alpha, digit), underscore)));
+
+    masks.symbol |= static_cast<std::uint64_t>(matchAny16(input, kSymbolChars))
+                    << offset;
+    masks.whitespace |=
+        static_cast<std::uint64_t>(matchAny16(input, kWhitespaceChars))
+        << offset;
+    masks.quote |= static_cast<std::uint64_t>(matchAny16(input, "\""))
+                   << offset;
+    masks.identifier |= static_cast<std::uint64_t>(identifier) << offset;
+  }
+  return masks;
+}
+
+#endif
+
+}  // namespace
+
+CharClassMasks classifyBlock(const char* data, std::size_t size) noexcept {
+#if defined(__AVX2__) || defined(__SSE2__)
+  if (size >= kCharBlockSize) {
+    return classify64(data);
+  }
+
+  // NUL bytes belong to no class, so zero padding keeps the high bits clear.
+  char padded[kCharBlockSize] = {};
+  std::memcpy(padded, data, size);
+  return classify64(padded);
+#else
+  return classifyBlockScalar(data, size);
+#endif
+}
+
+CharClassMasks classifyBlockScalar(const char* data,
+                                   std::size_t size) noexcept {
+  if (size > kCharBlockSize) {
+    size = kCharBlockSize;
+  }
+
+  CharClassMasks masks;
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto bits = kCharClassBits[static_cast<unsigned char>(data[i])];
+    const std::uint64_t bit = std::uint64_t{1} << i;
+    if (bits & kSymbolBit) {
+      masks.symbol |= bit;
+    }
+    if (bits & kWhitespaceBit) {
+      masks.whitespace |= bit;
+    }
+    if (bits & kQuoteBit) {
+      masks.quote |= bit;
+    }
+    if (bits & kIdentifierBit) {
+      masks.identifier |= bit;
+    }
+  }
+  return masks;
+}
+
+CharClassifier::CharClassifier(const char* begin, const char* end)
+    : end_(end) {
+  loadBlock(begin);
+}
+
+const char* CharClassifier::skipWhitespace(const char* current) noexcept {
+  return findFirstNot(current, &CharClassMasks::whitespace);
+}
+
+const char* CharClassifier::skipIdentifierChars(
+    const char* current) noexcept {
+  return findFirstNot(current, &CharClassMasks::identifier);
+}
+
+const char* CharClassifier::findFirstNot(
+    const char* current, std::uint64_t CharClassMasks::*mask) noexcept {
+  while (current < end_) {
+    if (current < block_begin_ || current >= block_begin_ + block_size_) {
+      loadBlock(current);
+    }
+
+    const auto offset = static_cast<std::size_t>(current - block_begin_);
+    // Bits past the block size are zero, so inverting marks them as stops;
+    // they are filtered out below so that the next block gets loaded.
+    const std::uint64_t stops = ~(masks_.*mask) >> offset;
+    const auto remaining = block_size_ - offset;
+    if (stops != 0) {
+      const auto distance = static_cast<std::size_t>(__builtin_ctzll(stops));
+      if (distance < remaining) {
+        return current + distance;
+      }
+    }
+    current += remaining;
+  }
+  return end_;
+}
+
+void CharClassifier::loadBlock(const char* block_begin) noexcept {
+  block_begin_ = block_begin;
+  block_size_ = static_cast<std::size_t>(end_ - block_begin);
+  if (block_size_ > kCharBlockSize) {
+    block_size_ = kCharBlockSize;
+  }
+  masks_ = classifyBlock(block_begin_, block_size_);
+}
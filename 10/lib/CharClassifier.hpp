@@ -0,0 +1,50 @@
+// No copyright.
+// Vectorized Jack character classifier.
+
+#ifndef LIB_CHARCLASSIFIER_HPP_
+#define LIB_CHARCLASSIFIER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::size_t kCharBlockSize = 64;
+
+// Bit i of each mask describes byte i of a block. Bits past the classified
+// size are always zero.
+struct CharClassMasks {
+  std::uint64_t symbol = 0;
+  std::uint64_t whitespace = 0;
+  std::uint64_t quote = 0;
+  std::uint64_t identifier = 0;
+};
+
+// Classifies up to kCharBlockSize bytes. Uses AVX2 or SSE2 when the build
+// enables them and falls back to classifyBlockScalar otherwise.
+CharClassMasks classifyBlock(const char* data, std::size_t size) noexcept;
+CharClassMasks classifyBlockScalar(const char* data, std::size_t size) noexcept;
+
+// Walks a buffer block by block, classifying each block once, to find the
+// end of whitespace and identifier runs without per-byte branching.
+class CharClassifier final {
+ public:
+  CharClassifier(const char* begin, const char* end);
+  CharClassifier() = delete;
+  ~CharClassifier() = default;
+
+  // Returns the first position at or after current which is not whitespace.
+  const char* skipWhitespace(const char* current) noexcept;
+  // Returns the first position at or after current which is not [A-Za-z0-9_].
+  const char* skipIdentifierChars(const char* current) noexcept;
+
+ private:
+  const char* findFirstNot(const char* current,
+                           std::uint64_t CharClassMasks::*mask) noexcept;
+  void loadBlock(const char* block_begin) noexcept;
+
+  const char* end_;
+  const char* block_begin_ = nullptr;
+  std::size_t block_size_ = 0;
+  CharClassMasks masks_;
+};
+
+#endif  // LIB_CHARCLASSIFIER_HPP_
@@ -3,166 +3,309 @@
 
 #include "CompilationEngine.hpp"
 
-#include <fstream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <stdexcept>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
-CompilationEngine::CompilationEngine(
-    const std::string& output_filename, std::unique_ptr<ITokens> tokens,
-    std::unique_ptr<IJackDeclarations> class_name_decs,
-    std::unique_ptr<IJackDeclarations> class_var_name_decs,
-    std::unique_ptr<IJackDeclarations> subroutine_name_decs,
-    std::unique_ptr<IJackDeclarations> subroutine_var_name_decs)
+namespace {
+
+template <typename Enum>
+constexpr std::uint32_t bitOf(const Enum value) {
+  return std::uint32_t{1} << static_cast<unsigned>(value);
+}
+
+template <typename Enum>
+constexpr bool contains(const std::uint32_t set, const Enum value) {
+  return (set >> static_cast<unsigned>(value)) & 1u;
+}
+
+static_assert(static_cast<unsigned>(KeyWordType::kFieldSize) <= 32 &&
+                  static_cast<unsigned>(SymbolType::kFieldSize) <= 32,
+              "FIRST sets are 32 bit masks");
+
+// FIRST sets of the grammar rules, so each lookahead test is one bit test.
+constexpr std::uint32_t kOpSymbols =
+    bitOf(SymbolType::kPlus) | bitOf(SymbolType::kMinus) |
+    bitOf(SymbolType::kAsterisk) | bitOf(SymbolType::kSlash) |
+    bitOf(SymbolType::kAmpersand) | bitOf(SymbolType::kVerticalBar) |
+    bitOf(SymbolType::kLessThan) | bitOf(SymbolType::kGreaterThan) |
+    bitOf(SymbolType::kEqual);
+constexpr std::uint32_t kUnaryOpSymbols =
+    bitOf(SymbolType::kMinus) | bitOf(SymbolType::kTilde);
+constexpr std::uint32_t kStatementKeywords =
+    bitOf(KeyWordType::kLet) | bitOf(KeyWordType::kIf) |
+    bitOf(KeyWordType::kWhile) | bitOf(KeyWordType::kDo) |
+    bitOf(KeyWordType::kReturn);
+constexpr std::uint32_t kKeywordConstants =
+    bitOf(KeyWordType::kTrue) | bitOf(KeyWordType::kFalse) |
+    bitOf(KeyWordType::kNull) | bitOf(KeyWordType::kThis);
+constexpr std::uint32_t kPrimitiveTypeKeywords = bitOf(KeyWordType::kInt) |
+                                                 bitOf(KeyWordType::kChar) |
+                                                 bitOf(KeyWordType::kBoolean);
+constexpr std::uint32_t kClassVarDecKeywords =
+    bitOf(KeyWordType::kStatic) | bitOf(KeyWordType::kField);
+constexpr std::uint32_t kSubroutineKeywords =
+    bitOf(KeyWordType::kConstructor) | bitOf(KeyWordType::kFunction) |
+    bitOf(KeyWordType::kMethod);
+
+constexpr std::size_t kNumKeywords =
+    static_cast<std::size_t>(KeyWordType::kFieldSize);
+
+// identifierPool() IDs of the keywords, so that primitive types are named
+// like classes in the SymbolTable.
+const std::array<IdentifierId, kNumKeywords>& keywordIds() {
+  static const auto ids = [] {
+    std::array<IdentifierId, kNumKeywords> ids{};
+    for (std::size_t i = 0; i < kNumKeywords; ++i) {
+      ids[i] = identifierPool().intern(kKeywordNames[i]);
+    }
+    return ids;
+  }();
+  return ids;
+}
+
+// identifierPool() IDs of the OS subroutines code generation calls.
+struct RuntimeIds {
+  IdentifierId memory;
+  IdentifierId alloc;
+};
+
+const RuntimeIds& runtimeIds() {
+  static const RuntimeIds ids{identifierPool().intern("Memory"),
+                              identifierPool().intern("alloc")};
+  return ids;
+}
+
+// The IR operation of an op symbol.
+constexpr IRBinaryOp binaryOpOf(const SymbolType op) {
+  switch (op) {
+    case SymbolType::kPlus:
+      return IRBinaryOp::kAdd;
+    case SymbolType::kMinus:
+      return IRBinaryOp::kSub;
+    case SymbolType::kAsterisk:
+      return IRBinaryOp::kMultiply;
+    case SymbolType::kSlash:
+      return IRBinaryOp::kDivide;
+    case SymbolType::kAmpersand:
+      return IRBinaryOp::kAnd;
+    case SymbolType::kVerticalBar:
+      return IRBinaryOp::kOr;
+    case SymbolType::kLessThan:
+      return IRBinaryOp::kLessThan;
+    case SymbolType::kGreaterThan:
+      return IRBinaryOp::kGreaterThan;
+    default:
+      return IRBinaryOp::kEqual;
+  }
+}
+
+}  // namespace
+
+template <typename TokenSource, typename DeclTable>
+BasicCompilationEngine<TokenSource, DeclTable>::BasicCompilationEngine(
+    const std::string& output_filename, std::unique_ptr<TokenSource> tokens,
+    std::unique_ptr<DeclTable> class_name_decs,
+    std::unique_ptr<DeclTable> subroutine_name_decs)
     : output_filename_(output_filename),
       tokens_(std::move(tokens)),
       class_name_decs_(std::move(class_name_decs)),
-      class_var_name_decs_(std::move(class_var_name_decs)),
-      subroutine_name_decs_(std::move(subroutine_name_decs)),
-      subroutine_var_name_decs_(std::move(subroutine_var_name_decs)) {}
+      subroutine_name_decs_(std::move(subroutine_name_decs)) {}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClass() {
+  ParseEventScope scope(&events_, NodeKind::kClass);
+  compileClassHead();
+
+  // subroutineDec*.
+  compileSubroutineStar();
+
+  compileClassTail();
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassParallel(
+    WorkStealingScheduler* scheduler) {
+  ParseEventScope scope(&events_, NodeKind::kClass);
+  compileClassHead();
+
+  // subroutineDec*.
+  compileSubroutinesParallel(scheduler);
+
+  compileClassTail();
+}
 
-void CompilationEngine::compileClass() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassHead() {
   if (tokens_->keyWord() != KeyWordType::kClass) {
     throw std::runtime_error("should be class");
   }
-  xml_tokens_.emplace_back("<keyword> class </keyword>");
+  events_.addKeyword(KeyWordType::kClass);
   tokens_->advance();
 
   // className
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
-  class_name_decs_->addDeclaration(tokens_->identifier());
+  events_.addIdentifier(tokens_->identifier());
+  class_name_ = tokens_->identifierId();
+  class_name_decs_->addDeclaration(class_name_);
   tokens_->advance();
 
   // '{'.
-  if (tokens_->symbol() != "{") {
+  if (tokens_->symbolType() != SymbolType::kLeftCurlyBracket) {
     throw std::runtime_error("should be {");
   }
-  xml_tokens_.emplace_back("<symbol> { </symbol>");
+  events_.addSymbol(SymbolType::kLeftCurlyBracket);
   tokens_->advance();
 
   // classVarDec*.
   compileClassVarDecStar();
+}
 
-  // subroutineDec*.
-  compileSubroutineStar();
-
-  if (tokens_->symbol() != "}") {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassTail() {
+  if (tokens_->symbolType() != SymbolType::kRightCurlyBracket) {
     throw std::runtime_error("should be }");
   }
-  xml_tokens_.emplace_back("<symbol> } </symbol>");
+  events_.addSymbol(SymbolType::kRightCurlyBracket);
 
   if (tokens_->hasMoreTokens()) {
     throw std::runtime_error("Code still exists after class");
   }
 }
 
-void CompilationEngine::compileClassVarDec() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassVarDec() {
+  ParseEventScope scope(&events_, NodeKind::kClassVarDec);
   if (!isClassVarDec()) {
     throw std::runtime_error("Not a classvardec");
   }
 
   // static field
+  SymbolKind kind;
   if (tokens_->keyWord() == KeyWordType::kStatic) {
-    xml_tokens_.emplace_back("<keyword> static </keyword>");
+    events_.addKeyword(KeyWordType::kStatic);
+    kind = SymbolKind::kStatic;
   } else {
-    xml_tokens_.emplace_back("<keyword> field </keyword>");
+    events_.addKeyword(KeyWordType::kField);
+    kind = SymbolKind::kField;
   }
   tokens_->advance();
 
   // type.
+  const auto type = typeId();
   compileType();
 
   // varName.
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
-  class_var_name_decs_->addDeclaration(tokens_->identifier());
+  events_.addIdentifier(tokens_->identifier());
+  symbols_.define(tokens_->identifierId(), type, kind);
   tokens_->advance();
 
   // (',' varName)*.
-  while (tokens_->tokenType() == TokenType::kSymbol &&
-         tokens_->symbol() == ",") {
-    xml_tokens_.emplace_back("<symbol> , </symbol>");
+  while (isSymbol(SymbolType::kComma)) {
+    events_.addSymbol(SymbolType::kComma);
     tokens_->advance();
 
     // varName.
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
-    class_var_name_decs_->addDeclaration(tokens_->identifier());
+    events_.addIdentifier(tokens_->identifier());
+    symbols_.define(tokens_->identifierId(), type, kind);
     tokens_->advance();
   }
 
   // ';'.
-  if (tokens_->symbol() != ";") {
+  if (tokens_->symbolType() != SymbolType::kSemicolon) {
     throw std::runtime_error("should be ;");
   }
-  xml_tokens_.emplace_back("<symbol> " + tokens_->symbol() + " </symbol>");
+  events_.addSymbol(SymbolType::kSemicolon);
 
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileSubroutine() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutine() {
+  ParseEventScope scope(&events_, NodeKind::kSubroutineDec);
+  compileSubroutineHead();
+  compileSubroutineBody();
+
+  // End of subroutine scope.
+  symbols_.popScope();
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutineHead() {
   if (!isSubroutine()) {
     throw std::runtime_error("Not a subroutine");
   }
 
   // constructor function method.
-  if (tokens_->keyWord() == KeyWordType::kConstructor) {
-    xml_tokens_.emplace_back("<keyword> constructor </keyword>");
-  } else if (tokens_->keyWord() == KeyWordType::kFunction) {
-    xml_tokens_.emplace_back("<keyword> function </keyword>");
+  const auto subroutine_kind = tokens_->keyWord();
+  if (subroutine_kind == KeyWordType::kConstructor) {
+    events_.addKeyword(KeyWordType::kConstructor);
+  } else if (subroutine_kind == KeyWordType::kFunction) {
+    events_.addKeyword(KeyWordType::kFunction);
   } else {
-    xml_tokens_.emplace_back("<keyword> method </keyword>");
+    events_.addKeyword(KeyWordType::kMethod);
   }
   tokens_->advance();
 
   // void type.
   if (tokens_->tokenType() == TokenType::kKeyWord &&
       tokens_->keyWord() == KeyWordType::kVoid) {
-    xml_tokens_.emplace_back("<keyword> void </keyword>");
+    events_.addKeyword(KeyWordType::kVoid);
     tokens_->advance();
   } else {
     compileType();
   }
 
   // subroutineName.
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
-  subroutine_name_decs_->addDeclaration(tokens_->identifier());
+  subroutine_kind_ = subroutine_kind;
+  events_.addIdentifier(tokens_->identifier());
+  const auto subroutine_name = tokens_->identifierId();
+  subroutine_name_decs_->addDeclaration(subroutine_name);
+  if (ir_) {
+    ir_->beginFunction(class_name_, subroutine_name);
+  }
   tokens_->advance();
 
   // Starts new subroutine scope.
-  if (!subroutine_var_name_decs_->isEmpty()) {
+  if (symbols_.scopeDepth() != 0) {
     throw std::runtime_error(
         "Subroutine variable declaratons already exists when it declares a new "
         "subroutine. Illegal");
   }
+  symbols_.pushScope();
+  if (subroutine_kind == KeyWordType::kMethod) {
+    // this.
+    symbols_.reserve(SymbolKind::kArgument);
+  }
 
   // '('.
-  if (tokens_->symbol() != "(") {
+  if (tokens_->symbolType() != SymbolType::kLeftParenthesis) {
     throw std::runtime_error("should be (");
   }
-  xml_tokens_.emplace_back("<symbol> ( </symbol>");
+  events_.addSymbol(SymbolType::kLeftParenthesis);
   tokens_->advance();
 
   // parameterList
   compileParameterList();
 
   // ')'.
-  if (tokens_->symbol() != ")") {
+  if (tokens_->symbolType() != SymbolType::kRightParenthesis) {
     throw std::runtime_error("should be )");
   }
-  xml_tokens_.emplace_back("<symbol> ) </symbol>");
+  events_.addSymbol(SymbolType::kRightParenthesis);
   tokens_->advance();
-
-  compileSubroutineBody();
-
-  // End of subroutine scope.
-  subroutine_var_name_decs_->clear();
 }
 
-void CompilationEngine::compileParameterList() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileParameterList() {
+  ParseEventScope scope(&events_, NodeKind::kParameterList);
   // "?": 0 or 1 time operation.
   // Check if it start with type.
   if (!isType()) {
@@ -170,30 +313,29 @@ void CompilationEngine::compileParameterList() {
   }
 
   // type.
+  auto type = typeId();
   compileType();
 
   // varName.
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
-  subroutine_var_name_decs_->addDeclaration(tokens_->identifier());
+  events_.addIdentifier(tokens_->identifier());
+  symbols_.define(tokens_->identifierId(), type, SymbolKind::kArgument);
 
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 
   // (',' type varName)*.
-  while (tokens_->tokenType() == TokenType::kSymbol &&
-         tokens_->symbol() == ",") {
-    xml_tokens_.emplace_back("<symbol> , </symbol>");
+  while (isSymbol(SymbolType::kComma)) {
+    events_.addSymbol(SymbolType::kComma);
     tokens_->advance();
 
     // type.
+    type = typeId();
     compileType();
 
     // varName.
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
-    subroutine_var_name_decs_->addDeclaration(tokens_->identifier());
+    events_.addIdentifier(tokens_->identifier());
+    symbols_.define(tokens_->identifierId(), type, SymbolKind::kArgument);
 
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
@@ -201,21 +343,23 @@ void CompilationEngine::compileParameterList() {
   }
 }
 
-void CompilationEngine::compileVarDec() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileVarDec() {
+  ParseEventScope scope(&events_, NodeKind::kVarDec);
   // var
   if (tokens_->keyWord() != KeyWordType::kVar) {
     throw std::runtime_error("should be var");
   }
-  xml_tokens_.emplace_back("<keyword> var </keyword>");
+  events_.addKeyword(KeyWordType::kVar);
   tokens_->advance();
 
   // type.
+  const auto type = typeId();
   compileType();
 
   // varName.
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
-  subroutine_var_name_decs_->addDeclaration(tokens_->identifier());
+  events_.addIdentifier(tokens_->identifier());
+  symbols_.define(tokens_->identifierId(), type, SymbolKind::kLocal);
 
   if (!tokens_->hasMoreTokens()) {
     return;
@@ -223,258 +367,323 @@ void CompilationEngine::compileVarDec() {
   tokens_->advance();
 
   // (',' varName)*.
-  while (tokens_->tokenType() == TokenType::kSymbol &&
-         tokens_->symbol() == ",") {
-    xml_tokens_.emplace_back("<symbol> , </symbol>");
+  while (isSymbol(SymbolType::kComma)) {
+    events_.addSymbol(SymbolType::kComma);
     tokens_->advance();
 
     // varName.
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
-    subroutine_var_name_decs_->addDeclaration(tokens_->identifier());
+    events_.addIdentifier(tokens_->identifier());
+    symbols_.define(tokens_->identifierId(), type, SymbolKind::kLocal);
 
     tokens_->advance();
   }
 
   // ';'.
-  if (tokens_->symbol() != ";") {
+  if (tokens_->symbolType() != SymbolType::kSemicolon) {
     throw std::runtime_error("should be ;");
   }
-  xml_tokens_.emplace_back("<symbol> ; </symbol>");
+  events_.addSymbol(SymbolType::kSemicolon);
 
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileStatements() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileStatements() {
+  ParseEventScope scope(&events_, NodeKind::kStatements);
   // "*": 0 or more.
   while (isStatement()) {
     compileStatement();
+    flushEvents();
   }
 }
 
-void CompilationEngine::compileLet() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileLet() {
+  ParseEventScope scope(&events_, NodeKind::kLetStatement);
   if (tokens_->keyWord() != KeyWordType::kLet) {
     throw std::runtime_error("Illegal keyword");
   }
 
   // let.
-  xml_tokens_.emplace_back("<keyword> let </keyword>");
+  events_.addKeyword(KeyWordType::kLet);
   tokens_->advance();
 
   // varName
-  if (!subroutine_var_name_decs_->isDeclared(tokens_->identifier()) &&
-      !class_var_name_decs_->isDeclared(tokens_->identifier())) {
-    throw std::runtime_error("undefined varName");
-  }
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
+  const auto target = checkVarName();
+  events_.addIdentifier(tokens_->identifier());
   tokens_->advance();
 
   // ('[' expression ']')?.
-  if (tokens_->tokenType() == TokenType::kSymbol && tokens_->symbol() == "[") {
+  const auto is_element = isSymbol(SymbolType::kLeftSquareBracket);
+  if (is_element) {
     // '['.
-    xml_tokens_.emplace_back("<symbol> [ </symbol>");
+    events_.addSymbol(SymbolType::kLeftSquareBracket);
     tokens_->advance();
 
     // expression.
+    if (ir_) {
+      ir_->load(target.kind, target.index);
+    }
     compileExpression();
+    if (ir_) {
+      ir_->binary(IRBinaryOp::kAdd);
+    }
 
     // ']'.
-    if (tokens_->symbol() != "]") {
+    if (tokens_->symbolType() != SymbolType::kRightSquareBracket) {
       throw std::runtime_error("Should be ]");
     }
-    xml_tokens_.emplace_back("<symbol> ] </symbol>");
+    events_.addSymbol(SymbolType::kRightSquareBracket);
     tokens_->advance();
   }
 
   // '='.
-  if (tokens_->symbol() != "=") {
+  if (tokens_->symbolType() != SymbolType::kEqual) {
     throw std::runtime_error("should be =");
   }
-  xml_tokens_.emplace_back("<symbol> = </symbol>");
+  events_.addSymbol(SymbolType::kEqual);
   tokens_->advance();
 
   // expression.
   compileExpression();
+  if (ir_ && is_element) {
+    ir_->storeIndirect();
+  } else if (ir_) {
+    ir_->store(target.kind, target.index);
+  }
 
   // ';'.
-  if (tokens_->symbol() != ";") {
+  if (tokens_->symbolType() != SymbolType::kSemicolon) {
     throw std::runtime_error("should be ;");
   }
-  xml_tokens_.emplace_back("<symbol> ; </symbol>");
+  events_.addSymbol(SymbolType::kSemicolon);
 
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileIf() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileIf() {
+  ParseEventScope scope(&events_, NodeKind::kIfStatement);
   if (tokens_->keyWord() != KeyWordType::kIf) {
     throw std::runtime_error("Illegal keyword");
   }
 
   // if.
-  xml_tokens_.emplace_back("<keyword> if </keyword>");
+  events_.addKeyword(KeyWordType::kIf);
   tokens_->advance();
 
   // '('.
-  if (tokens_->symbol() != "(") {
+  if (tokens_->symbolType() != SymbolType::kLeftParenthesis) {
     throw std::runtime_error("should be (");
   }
-  xml_tokens_.emplace_back("<symbol> ( </symbol>");
+  events_.addSymbol(SymbolType::kLeftParenthesis);
   tokens_->advance();
 
   // expression.
   compileExpression();
+  IRBlockId else_block = kNoBlock;
+  if (ir_) {
+    const auto then_block = ir_->newBlock();
+    else_block = ir_->newBlock();
+    ir_->branch(then_block, else_block);
+    ir_->placeBlock(then_block);
+  }
 
   // ')'.
-  if (tokens_->symbol() != ")") {
+  if (tokens_->symbolType() != SymbolType::kRightParenthesis) {
     throw std::runtime_error("should be )");
   }
-  xml_tokens_.emplace_back("<symbol> ) </symbol>");
+  events_.addSymbol(SymbolType::kRightParenthesis);
   tokens_->advance();
 
   // '{'.
-  if (tokens_->symbol() != "{") {
+  if (tokens_->symbolType() != SymbolType::kLeftCurlyBracket) {
     throw std::runtime_error("should be {");
   }
-  xml_tokens_.emplace_back("<symbol> { </symbol>");
+  events_.addSymbol(SymbolType::kLeftCurlyBracket);
   tokens_->advance();
 
   // statements.
   compileStatements();
 
   // '}'.
-  if (tokens_->symbol() != "}") {
+  if (tokens_->symbolType() != SymbolType::kRightCurlyBracket) {
     throw std::runtime_error("should be }");
   }
-  xml_tokens_.emplace_back("<symbol> } </symbol>");
+  events_.addSymbol(SymbolType::kRightCurlyBracket);
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 
   // ('else' '{' statements '}')?
-  if (tokens_->tokenType() == TokenType::kKeyWord &&
-      tokens_->keyWord() == KeyWordType::kElse) {
-    xml_tokens_.emplace_back("<keyword> else </keyword>");
+  const auto has_else = tokens_->tokenType() == TokenType::kKeyWord &&
+                        tokens_->keyWord() == KeyWordType::kElse;
+  IRBlockId end_block = kNoBlock;
+  if (ir_) {
+    if (has_else) {
+      end_block = ir_->newBlock();
+      ir_->jump(end_block);
+    }
+    ir_->placeBlock(else_block);
+  }
+  if (has_else) {
+    events_.addKeyword(KeyWordType::kElse);
     tokens_->advance();
 
     // '{'.
-    if (tokens_->symbol() != "{") {
+    if (tokens_->symbolType() != SymbolType::kLeftCurlyBracket) {
       throw std::runtime_error("should be {");
     }
-    xml_tokens_.emplace_back("<symbol> { </symbol>");
+    events_.addSymbol(SymbolType::kLeftCurlyBracket);
     tokens_->advance();
 
     // statements.
     compileStatements();
 
     // '}'.
-    if (tokens_->symbol() != "}") {
+    if (tokens_->symbolType() != SymbolType::kRightCurlyBracket) {
       throw std::runtime_error("should be }");
     }
-    xml_tokens_.emplace_back("<symbol> } </symbol>");
+    events_.addSymbol(SymbolType::kRightCurlyBracket);
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
     }
+    if (ir_) {
+      ir_->placeBlock(end_block);
+    }
   }
 }
 
-void CompilationEngine::compileWhile() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileWhile() {
+  ParseEventScope scope(&events_, NodeKind::kWhileStatement);
   if (tokens_->keyWord() != KeyWordType::kWhile) {
     throw std::runtime_error("Illegal keyword");
   }
 
   // while.
-  xml_tokens_.emplace_back("<keyword> while </keyword>");
+  events_.addKeyword(KeyWordType::kWhile);
   tokens_->advance();
+  IRBlockId condition_block = kNoBlock;
+  IRBlockId end_block = kNoBlock;
+  if (ir_) {
+    condition_block = ir_->newBlock();
+    end_block = ir_->newBlock();
+    ir_->placeBlock(condition_block);
+  }
 
   // '('.
-  if (tokens_->symbol() != "(") {
+  if (tokens_->symbolType() != SymbolType::kLeftParenthesis) {
     throw std::runtime_error("should be (");
   }
-  xml_tokens_.emplace_back("<symbol> ( </symbol>");
+  events_.addSymbol(SymbolType::kLeftParenthesis);
   tokens_->advance();
 
   // expression.
   compileExpression();
+  if (ir_) {
+    const auto body_block = ir_->newBlock();
+    ir_->branch(body_block, end_block);
+    ir_->placeBlock(body_block);
+  }
 
   // ')'.
-  if (tokens_->symbol() != ")") {
+  if (tokens_->symbolType() != SymbolType::kRightParenthesis) {
     throw std::runtime_error("should be )");
   }
-  xml_tokens_.emplace_back("<symbol> ) </symbol>");
+  events_.addSymbol(SymbolType::kRightParenthesis);
   tokens_->advance();
 
   // '{'.
-  if (tokens_->symbol() != "{") {
+  if (tokens_->symbolType() != SymbolType::kLeftCurlyBracket) {
     throw std::runtime_error("should be {");
   }
-  xml_tokens_.emplace_back("<symbol> { </symbol>");
+  events_.addSymbol(SymbolType::kLeftCurlyBracket);
   tokens_->advance();
 
   // statements.
   compileStatements();
 
   // '}'.
-  if (tokens_->symbol() != "}") {
+  if (tokens_->symbolType() != SymbolType::kRightCurlyBracket) {
     throw std::runtime_error("should be }");
   }
-  xml_tokens_.emplace_back("<symbol> } </symbol>");
+  events_.addSymbol(SymbolType::kRightCurlyBracket);
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
+  if (ir_) {
+    ir_->jump(condition_block);
+    ir_->placeBlock(end_block);
+  }
 }
 
-void CompilationEngine::compileDo() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileDo() {
+  ParseEventScope scope(&events_, NodeKind::kDoStatement);
   if (tokens_->keyWord() != KeyWordType::kDo) {
     throw std::runtime_error("Illegal keyword");
   }
 
   // do.
-  xml_tokens_.emplace_back("<keyword> do </keyword>");
+  events_.addKeyword(KeyWordType::kDo);
   tokens_->advance();
 
   // subroutineCall.
   compileSubroutineCall();
+  if (ir_) {
+    ir_->discard();
+  }
 
   // ';'.
-  if (tokens_->symbol() != ";") {
+  if (tokens_->symbolType() != SymbolType::kSemicolon) {
     throw std::runtime_error("should be ;");
   }
-  xml_tokens_.emplace_back("<symbol> ; </symbol>");
+  events_.addSymbol(SymbolType::kSemicolon);
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileReturn() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileReturn() {
+  ParseEventScope scope(&events_, NodeKind::kReturnStatement);
   if (tokens_->keyWord() != KeyWordType::kReturn) {
     throw std::runtime_error("Illegal keyword");
   }
 
   // return.
-  xml_tokens_.emplace_back("<keyword> return </keyword>");
+  events_.addKeyword(KeyWordType::kReturn);
   tokens_->advance();
 
   // expression?
   if (isExpression()) {
     compileExpression();
+  } else if (ir_) {
+    // void subroutines return 0.
+    ir_->constant(0);
+  }
+  if (ir_) {
+    ir_->ret();
   }
 
   // ';'.
-  if (tokens_->symbol() != ";") {
+  if (tokens_->symbolType() != SymbolType::kSemicolon) {
     throw std::runtime_error("should be ;");
   }
-  xml_tokens_.emplace_back("<symbol> ; </symbol>");
+  events_.addSymbol(SymbolType::kSemicolon);
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileExpression() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileExpression() {
+  ParseEventScope scope(&events_, NodeKind::kExpression);
   if (!isExpression()) {
     throw std::runtime_error("Illegal expression");
   }
@@ -485,36 +694,44 @@ void CompilationEngine::compileExpression() {
   // (op term)*.
   while (isOp()) {
     // op.
+    const auto op = tokens_->symbolType();
     compileOp();
 
     // term.
     compileTerm();
+    if (ir_) {
+      ir_->binary(binaryOpOf(op));
+    }
   }
 }
 
-void CompilationEngine::compileOp() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileOp() {
   if (!isOp()) {
     throw std::runtime_error("Illegal operation");
   }
 
-  xml_tokens_.emplace_back("<symbol> " + tokens_->symbol() + " </symbol>");
+  events_.addSymbol(tokens_->symbolType());
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileUnaryOp() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileUnaryOp() {
   if (!isUnaryOp()) {
     throw std::runtime_error("Illegal unary operation");
   }
 
-  xml_tokens_.emplace_back("<symbol> " + tokens_->symbol() + " </symbol>");
+  events_.addSymbol(tokens_->symbolType());
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::compileTerm() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileTerm() {
+  ParseEventScope scope(&events_, NodeKind::kTerm);
   if (!isTerm()) {
     throw std::runtime_error("Illegal term");
   }
@@ -522,15 +739,20 @@ void CompilationEngine::compileTerm() {
   // integerConstant | stringConstant | keywordConstant | varName | varName '['
   // expression ']' | subroutineCall | '(' expression ')' | unaryOp term.
   if (tokens_->tokenType() == TokenType::kIntConst) {
-    xml_tokens_.emplace_back("<integerConstant> " +
-                             std::to_string(tokens_->intVal()) +
-                             " </integerConstant>");
+    const auto value = tokens_->intVal();
+    events_.addIntegerConstant(value);
+    if (ir_) {
+      // 32768 is -32768 in 16 bits.
+      ir_->constant(value > 32767 ? value - 65536 : value);
+    }
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
     }
   } else if (tokens_->tokenType() == TokenType::kStringConst) {
-    xml_tokens_.emplace_back("<stringConstant> " + tokens_->stringVal() +
-                             " </stringConstant>");
+    events_.addStringConstant(tokens_->stringVal());
+    if (ir_) {
+      ir_->string(tokens_->stringVal());
+    }
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
     }
@@ -540,137 +762,192 @@ void CompilationEngine::compileTerm() {
     compileSubroutineCall();
   } else if (tokens_->tokenType() == TokenType::kIdentifier) {
     // varName.
-    if (!subroutine_var_name_decs_->isDeclared(tokens_->identifier()) &&
-        !class_var_name_decs_->isDeclared(tokens_->identifier())) {
-      throw std::runtime_error("undefined varName");
+    const auto variable = checkVarName();
+    events_.addIdentifier(tokens_->identifier());
+    if (ir_) {
+      ir_->load(variable.kind, variable.index);
     }
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
     }
 
     // '[' expression ']' if exists.
-    if (tokens_->tokenType() == TokenType::kSymbol &&
-        tokens_->symbol() == "[") {
+    if (isSymbol(SymbolType::kLeftSquareBracket)) {
       // '['.
-      xml_tokens_.emplace_back("<symbol> [ </symbol>");
+      events_.addSymbol(SymbolType::kLeftSquareBracket);
       tokens_->advance();
 
       // expression.
       compileExpression();
+      if (ir_) {
+        ir_->binary(IRBinaryOp::kAdd);
+        ir_->loadIndirect();
+      }
 
       // ']'.
-      if (tokens_->symbol() != "]") {
+      if (tokens_->symbolType() != SymbolType::kRightSquareBracket) {
         throw std::runtime_error("should be ]");
       }
-      xml_tokens_.emplace_back("<symbol> ] </symbol>");
+      events_.addSymbol(SymbolType::kRightSquareBracket);
       if (tokens_->hasMoreTokens()) {
         tokens_->advance();
       }
     }
-  } else if (tokens_->tokenType() == TokenType::kSymbol &&
-             tokens_->symbol() == "(") {
+  } else if (isSymbol(SymbolType::kLeftParenthesis)) {
     // '('.
-    xml_tokens_.emplace_back("<symbol> ( </symbol>");
+    events_.addSymbol(SymbolType::kLeftParenthesis);
     tokens_->advance();
 
-    // expressionList.
-    compileExpressionList();
+    // expression.
+    compileExpression();
 
     // ')'.
-    if (tokens_->symbol() != ")") {
+    if (tokens_->symbolType() != SymbolType::kRightParenthesis) {
       throw std::runtime_error("should be )");
     }
-    xml_tokens_.emplace_back("<symbol> ) </symbol>");
+    events_.addSymbol(SymbolType::kRightParenthesis);
     if (tokens_->hasMoreTokens()) {
       tokens_->advance();
     }
   } else if (isUnaryOp()) {
+    const auto op = tokens_->symbolType();
     compileUnaryOp();
     compileTerm();
+    if (ir_) {
+      ir_->unary(op == SymbolType::kMinus ? IRUnaryOp::kNeg : IRUnaryOp::kNot);
+    }
   } else {
     throw std::runtime_error("Illegal term");
   }
 }
 
-void CompilationEngine::compileSubroutineCall() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutineCall() {
   if (!isSubroutineCall()) {
     throw std::runtime_error("Illegal subroutinecall");
   }
 
-  xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                           " </identifier>");
+  // Methods get the object as argument 0.
+  IdentifierId callee_class = class_name_;
+  IdentifierId callee_name = 0;
+  std::uint16_t num_args = 0;
+  const Symbol* object = nullptr;
+  if (ir_) {
+    callee_name = tokens_->identifierId();
+    object = symbols_.find(callee_name);
+  }
+  events_.addIdentifier(tokens_->identifier());
   tokens_->advance();
 
   // If '.', '.' subroutineName '(' expressionList ')'.
   // Else if '(', '(' expressionList ')'.
-  if (tokens_->symbol() == ".") {
-    xml_tokens_.emplace_back("<symbol> . </symbol>");
+  if (tokens_->symbolType() == SymbolType::kPeriod) {
+    events_.addSymbol(SymbolType::kPeriod);
     tokens_->advance();
 
     // subroutineName.
     if (tokens_->tokenType() != TokenType::kIdentifier) {
       throw std::runtime_error("should be identifier");
     }
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
+    if (object != nullptr) {
+      // varName.subroutineName: a method of the variable's class.
+      ir_->load(object->kind, object->index);
+      callee_class = object->type;
+      num_args = 1;
+    } else {
+      // className.subroutineName.
+      callee_class = callee_name;
+    }
+    if (ir_) {
+      callee_name = tokens_->identifierId();
+    }
+    events_.addIdentifier(tokens_->identifier());
     tokens_->advance();
+  } else if (ir_) {
+    // subroutineName: a method of this.
+    ir_->thisPointer();
+    num_args = 1;
   }
 
   // "(".
-  if (tokens_->symbol() != "(") {
+  if (tokens_->symbolType() != SymbolType::kLeftParenthesis) {
     throw std::runtime_error("should be (");
   }
-  xml_tokens_.emplace_back("<symbol> ( </symbol>");
+  events_.addSymbol(SymbolType::kLeftParenthesis);
   tokens_->advance();
 
   // expressionList.
-  compileExpressionList();
+  num_args += countedExpressionList();
 
   // ")".
-  if (tokens_->symbol() != ")") {
+  if (tokens_->symbolType() != SymbolType::kRightParenthesis) {
     throw std::runtime_error("should be )");
   }
-  xml_tokens_.emplace_back("<symbol> ) </symbol>");
+  events_.addSymbol(SymbolType::kRightParenthesis);
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
+  if (ir_) {
+    ir_->call(callee_class, callee_name, num_args);
+  }
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileExpressionList() {
+  countedExpressionList();
 }
 
-void CompilationEngine::compileExpressionList() {
+template <typename TokenSource, typename DeclTable>
+std::uint16_t
+BasicCompilationEngine<TokenSource, DeclTable>::countedExpressionList() {
+  ParseEventScope scope(&events_, NodeKind::kExpressionList);
   // (expression (',' expression)* )?.
   if (!isExpression()) {
-    return;
+    return 0;
   }
 
   // expression.
   compileExpression();
+  std::uint16_t count = 1;
 
   // (',' expression)*.
-  while (tokens_->tokenType() == TokenType::kSymbol &&
-         tokens_->symbol() == ",") {
-    xml_tokens_.emplace_back("<symbol> , </symbol>");
+  while (isSymbol(SymbolType::kComma)) {
+    events_.addSymbol(SymbolType::kComma);
     tokens_->advance();
 
     // expression.
     compileExpression();
+    ++count;
   }
+  return count;
 }
 
-void CompilationEngine::compileKeywordConstant() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileKeywordConstant() {
   switch (tokens_->keyWord()) {
     case KeyWordType::kTrue:
-      xml_tokens_.emplace_back("<keyword> true </keyword>");
+      events_.addKeyword(KeyWordType::kTrue);
+      if (ir_) {
+        ir_->constant(-1);
+      }
       break;
     case KeyWordType::kFalse:
-      xml_tokens_.emplace_back("<keyword> false </keyword>");
+      events_.addKeyword(KeyWordType::kFalse);
+      if (ir_) {
+        ir_->constant(0);
+      }
       break;
     case KeyWordType::kNull:
-      xml_tokens_.emplace_back("<keyword> null </keyword>");
+      events_.addKeyword(KeyWordType::kNull);
+      if (ir_) {
+        ir_->constant(0);
+      }
       break;
     case KeyWordType::kThis:
-      xml_tokens_.emplace_back("<keyword> this </keyword>");
+      events_.addKeyword(KeyWordType::kThis);
+      if (ir_) {
+        ir_->thisPointer();
+      }
       break;
     default:
       throw std::runtime_error("illegal keyword");
@@ -681,94 +958,77 @@ void CompilationEngine::compileKeywordConstant() {
   }
 }
 
-bool CompilationEngine::isTerm() {
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isTerm() {
   if (tokens_->tokenType() == TokenType::kIntConst ||
       tokens_->tokenType() == TokenType::kStringConst || isKeywordConstant() ||
       isSubroutineCall() || tokens_->tokenType() == TokenType::kIdentifier ||
-      (tokens_->tokenType() == TokenType::kSymbol &&
-       tokens_->symbol() == "(") ||
-      isUnaryOp()) {
+      isSymbol(SymbolType::kLeftParenthesis) || isUnaryOp()) {
     return true;
   }
   return false;
 }
 
-bool CompilationEngine::isExpression() { return isTerm(); }
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isExpression() {
+  return isTerm();
+}
 
-bool CompilationEngine::isSubroutineCall() {
-  // subroutineName, className, ClassVarName, SubroutineVarName.
-  // TODO(me): Support className from other classes. Linking?
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isSubroutineCall() {
+  // subroutineName '(' | (className | varName) '.'.
   if (tokens_->tokenType() != TokenType::kIdentifier) {
     return false;
   }
 
-  if (subroutine_name_decs_->isDeclared(tokens_->identifier())) {
-    return true;
-  }
+  const auto next = tokens_->peek(1);
+  return next.isSymbol(SymbolType::kLeftParenthesis) ||
+         next.isSymbol(SymbolType::kPeriod);
+}
 
-  if (class_name_decs_->isDeclared(tokens_->identifier()) ||
-      class_var_name_decs_->isDeclared(tokens_->identifier()) ||
-      subroutine_var_name_decs_->isDeclared(tokens_->identifier())) {
-    // Make sure it uses subroutines.
-    if (!tokens_->hasMoreTokens()) {
-      return false;
-    }
-    tokens_->advance();
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isKeywordConstant() {
+  return isKeywordIn(kKeywordConstants);
+}
 
-    if (tokens_->tokenType() == TokenType::kSymbol &&
-        tokens_->symbol() == ".") {
-      tokens_->recede();
-      return true;
-    }
-    tokens_->recede();
-  }
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isUnaryOp() {
+  return isSymbolIn(kUnaryOpSymbols);
+}
 
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isOp() {
+  return isSymbolIn(kOpSymbols);
 }
 
-bool CompilationEngine::isKeywordConstant() {
-  if (tokens_->tokenType() == TokenType::kKeyWord &&
-      (tokens_->keyWord() == KeyWordType::kTrue ||
-       tokens_->keyWord() == KeyWordType::kFalse ||
-       tokens_->keyWord() == KeyWordType::kNull ||
-       tokens_->keyWord() == KeyWordType::kThis)) {
-    return true;
-  }
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isStatement() {
+  return isKeywordIn(kStatementKeywords);
 }
 
-bool CompilationEngine::isUnaryOp() {
-  if (tokens_->tokenType() == TokenType::kSymbol &&
-      (tokens_->symbol() == "-" || tokens_->symbol() == "~")) {
-    return true;
-  }
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource,
+                            DeclTable>::isSymbol(const SymbolType symbol_type) {
+  return tokens_->tokenType() == TokenType::kSymbol &&
+         tokens_->symbolType() == symbol_type;
 }
 
-bool CompilationEngine::isOp() {
-  if (tokens_->tokenType() == TokenType::kSymbol &&
-      (tokens_->symbol() == "+" || tokens_->symbol() == "-" ||
-       tokens_->symbol() == "*" || tokens_->symbol() == "/" ||
-       tokens_->symbol() == "&" || tokens_->symbol() == "|" ||
-       tokens_->symbol() == "<" || tokens_->symbol() == ">" ||
-       tokens_->symbol() == "=")) {
-    return true;
-  }
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isSymbolIn(
+    const std::uint32_t symbol_set) {
+  return tokens_->tokenType() == TokenType::kSymbol &&
+         contains(symbol_set, tokens_->symbolType());
 }
 
-bool CompilationEngine::isStatement() {
-  if (tokens_->tokenType() == TokenType::kKeyWord) {
-    const auto keyword = tokens_->keyWord();
-    if (keyword == KeyWordType::kLet || keyword == KeyWordType::kIf ||
-        keyword == KeyWordType::kDo || keyword == KeyWordType::kReturn) {
-      return true;
-    }
-  }
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isKeywordIn(
+    const std::uint32_t keyword_set) {
+  return tokens_->tokenType() == TokenType::kKeyWord &&
+         contains(keyword_set, tokens_->keyWord());
 }
 
-void CompilationEngine::compileStatement() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileStatement() {
   switch (tokens_->keyWord()) {
     case KeyWordType::kLet:
       compileLet();
@@ -790,7 +1050,29 @@ void CompilationEngine::compileStatement() {
   }
 }
 
-void CompilationEngine::compileType() {
+template <typename TokenSource, typename DeclTable>
+IdentifierId BasicCompilationEngine<TokenSource, DeclTable>::typeId() {
+  if (tokens_->tokenType() == TokenType::kKeyWord) {
+    return keywordIds()[static_cast<std::size_t>(tokens_->keyWord())];
+  }
+  if (tokens_->tokenType() == TokenType::kIdentifier) {
+    return tokens_->identifierId();
+  }
+  // compileType() reports it.
+  return 0;
+}
+
+template <typename TokenSource, typename DeclTable>
+Symbol BasicCompilationEngine<TokenSource, DeclTable>::checkVarName() {
+  const auto* symbol = symbols_.find(tokens_->identifierId());
+  if (symbol == nullptr) {
+    throw std::runtime_error("undefined varName");
+  }
+  return *symbol;
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileType() {
   if (!isType()) {
     throw std::runtime_error("Invalid type");
   }
@@ -798,17 +1080,16 @@ void CompilationEngine::compileType() {
   if (tokens_->tokenType() == TokenType::kKeyWord) {
     const auto keyword = tokens_->keyWord();
     if (keyword == KeyWordType::kInt) {
-      xml_tokens_.emplace_back("<keyword> int </keyword>");
+      events_.addKeyword(KeyWordType::kInt);
     } else if (keyword == KeyWordType::kChar) {
-      xml_tokens_.emplace_back("<keyword> char </keyword>");
+      events_.addKeyword(KeyWordType::kChar);
     } else if (keyword == KeyWordType::kBoolean) {
-      xml_tokens_.emplace_back("<keyword> boolean </keyword>");
+      events_.addKeyword(KeyWordType::kBoolean);
     } else {
       throw std::runtime_error("Illegal keyword");
     }
   } else if (tokens_->tokenType() == TokenType::kIdentifier) {
-    xml_tokens_.emplace_back("<identifier> " + tokens_->identifier() +
-                             " </identifier>");
+    events_.addIdentifier(tokens_->identifier());
   } else {
     throw std::runtime_error("Invalid type");
   }
@@ -818,65 +1099,183 @@ void CompilationEngine::compileType() {
   }
 }
 
-bool CompilationEngine::isType() {
-  if (tokens_->tokenType() == TokenType::kKeyWord) {
-    const auto keyword = tokens_->keyWord();
-    if (keyword == KeyWordType::kInt || keyword == KeyWordType::kChar ||
-        keyword == KeyWordType::kBoolean) {
-      return true;
-    } else {
-      return false;
-    }
-  } else if (tokens_->tokenType() == TokenType::kIdentifier) {
-    return true;
-  }
-
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isType() {
+  return tokens_->tokenType() == TokenType::kIdentifier ||
+         isKeywordIn(kPrimitiveTypeKeywords);
 }
 
-void CompilationEngine::compileClassVarDecStar() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassVarDecStar() {
   while (isClassVarDec()) {
     compileClassVarDec();
+    flushEvents();
   }
 }
 
-bool CompilationEngine::isClassVarDec() {
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isClassVarDec() {
   // static field
-  if (tokens_->tokenType() == TokenType::kKeyWord) {
-    const auto keyword = tokens_->keyWord();
-    if (keyword == KeyWordType::kStatic || keyword == KeyWordType::kField) {
-      return true;
+  return isKeywordIn(kClassVarDecKeywords);
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutineStar() {
+  while (isSubroutine()) {
+    compileSubroutine();
+    flushEvents();
+  }
+}
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutinesParallel(
+    WorkStealingScheduler* scheduler) {
+  if (backend_) {
+    // The code has to come out in source order as it is generated.
+    compileSubroutineStar();
+    return;
+  }
+  if constexpr (kRandomAccess) {
+    // The subroutines from the current token on, up to the first one whose
+    // braces do not balance.
+    const StructuralIndex index(tokens_->table());
+    std::vector<TokenSpan> spans;
+    auto next = tokens_->position();
+    for (const auto& span : index.subroutineSpans()) {
+      if (span.begin < next) {
+        continue;
+      }
+      if (span.begin != next) {
+        break;
+      }
+      spans.push_back(span);
+      next = span.end;
+    }
+
+    std::vector<ParseEventLog> logs(spans.size());
+    std::vector<std::exception_ptr> errors(spans.size());
+    TaskGroup group;
+    for (std::size_t i = 0; i < spans.size(); ++i) {
+      scheduler->spawn(&group, [this, &spans, &logs, &errors, i] {
+        try {
+          logs[i] = compileSubroutineAt(spans[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
     }
+    scheduler->wait(&group);
+
+    // Merged in source order, so the first error in the source wins.
+    for (std::size_t i = 0; i < spans.size(); ++i) {
+      if (errors[i]) {
+        std::rethrow_exception(errors[i]);
+      }
+      // subroutineName follows the kind and the return type.
+      tokens_->seek(spans[i].begin + 2);
+      subroutine_name_decs_->addDeclaration(tokens_->identifierId());
+      events_.append(logs[i]);
+      logs[i].clear();
+      flushEvents();
+    }
+    if (!spans.empty()) {
+      tokens_->seek(spans.back().end);
+    }
+
+    // Whatever the index could not split, e.g. unbalanced braces, gets the
+    // errors of the sequential parse.
+    compileSubroutineStar();
+  } else {
+    static_cast<void>(scheduler);
+    throw std::runtime_error(kRandomAccessError);
   }
+}
 
-  return false;
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileClassOutline() {
+  if constexpr (kRandomAccess) {
+    ParseEventScope scope(&events_, NodeKind::kClass);
+    compileClassHead();
+
+    const StructuralIndex index(tokens_->table());
+    outlined_subroutines_.clear();
+    // subroutineDec*, each up to its parameter list.
+    while (isSubroutine()) {
+      const auto begin = tokens_->position();
+      {
+        ParseEventScope subroutine_scope(&events_, NodeKind::kSubroutineDec);
+        compileSubroutineHead();
+        auto end = index.matching(tokens_->position());
+        if (!isSymbol(SymbolType::kLeftCurlyBracket) ||
+            end == StructuralIndex::kNoMatch) {
+          // Unbalanced, the parse reports where.
+          compileSubroutineBody();
+          end = tokens_->position();
+        } else if (++end < tokens_->table().size()) {
+          tokens_->seek(end);
+        } else {
+          // The body's '}' is the last token, so the class's is missing,
+          // possibly after a body that was never closed.
+          throw std::runtime_error("should be }");
+        }
+        symbols_.popScope();
+        outlined_subroutines_.push_back(TokenSpan{begin, end});
+      }
+      flushEvents();
+    }
+
+    compileClassTail();
+  } else {
+    throw std::runtime_error(kRandomAccessError);
+  }
 }
 
-void CompilationEngine::compileSubroutineStar() {
-  while (isSubroutine()) {
-    compileSubroutine();
+template <typename TokenSource, typename DeclTable>
+ParseEventLog
+BasicCompilationEngine<TokenSource, DeclTable>::compileOutlinedSubroutine(
+    const std::size_t subroutine) const {
+  if (subroutine >= outlined_subroutines_.size()) {
+    throw std::runtime_error("No such outlined subroutine");
   }
+  return compileSubroutineAt(outlined_subroutines_[subroutine]);
 }
 
-bool CompilationEngine::isSubroutine() {
-  // constructor function method.
-  if (tokens_->tokenType() == TokenType::kKeyWord) {
-    const auto keyword = tokens_->keyWord();
-    if (keyword == KeyWordType::kConstructor ||
-        keyword == KeyWordType::kFunction || keyword == KeyWordType::kMethod) {
-      return true;
+template <typename TokenSource, typename DeclTable>
+ParseEventLog
+BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutineAt(
+    const TokenSpan& span) const {
+  if constexpr (kRandomAccess) {
+    // A subroutine only sees class level declarations besides its own, so it
+    // gets an engine of its own over its slice of the tokens.
+    BasicCompilationEngine engine(
+        output_filename_,
+        std::make_unique<Tokens>(tokens_->slice(span.begin, span.end)));
+    engine.symbols_ = symbols_;
+    engine.compileSubroutine();
+    if (engine.tokens_->hasMoreTokens()) {
+      throw std::runtime_error("Code still exists after subroutine");
     }
+    return std::move(engine.events_);
+  } else {
+    static_cast<void>(span);
+    throw std::runtime_error(kRandomAccessError);
   }
+}
 
-  return false;
+template <typename TokenSource, typename DeclTable>
+bool BasicCompilationEngine<TokenSource, DeclTable>::isSubroutine() {
+  // constructor function method.
+  return isKeywordIn(kSubroutineKeywords);
 }
 
-void CompilationEngine::compileSubroutineBody() {
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::compileSubroutineBody() {
+  ParseEventScope scope(&events_, NodeKind::kSubroutineBody);
   // '{'.
-  if (tokens_->symbol() != "{") {
+  if (tokens_->symbolType() != SymbolType::kLeftCurlyBracket) {
     throw std::runtime_error("should be {");
   }
-  xml_tokens_.emplace_back("<symbol> { </symbol>");
+  events_.addSymbol(SymbolType::kLeftCurlyBracket);
   tokens_->advance();
 
   // varDec*.
@@ -884,33 +1283,69 @@ void CompilationEngine::compileSubroutineBody() {
          tokens_->keyWord() == KeyWordType::kVar) {
     compileVarDec();
   }
+  if (ir_ && subroutine_kind_ == KeyWordType::kConstructor) {
+    ir_->constant(symbols_.count(SymbolKind::kField));
+    ir_->call(runtimeIds().memory, runtimeIds().alloc, 1);
+    ir_->setThis();
+  } else if (ir_ && subroutine_kind_ == KeyWordType::kMethod) {
+    ir_->load(SymbolKind::kArgument, 0);
+    ir_->setThis();
+  }
 
   // statements.
   compileStatements();
 
   // '}'.
-  if (tokens_->symbol() != "}") {
+  if (tokens_->symbolType() != SymbolType::kRightCurlyBracket) {
     throw std::runtime_error("should be }");
   }
-  xml_tokens_.emplace_back("<symbol> } </symbol>");
+  events_.addSymbol(SymbolType::kRightCurlyBracket);
+  if (ir_) {
+    backend_->lower(ir_->endFunction(symbols_.count(SymbolKind::kLocal)));
+  }
 
   if (tokens_->hasMoreTokens()) {
     tokens_->advance();
   }
 }
 
-void CompilationEngine::initializeXML() {
-  xml_tokens_.clear();
-  xml_tokens_.emplace_back("<tokens>");
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::writeXMLTokens() const {
+  BufferedFileSink output(output_filename_);
+  ::writeXMLTokens(events_, &output);
+  output.flush();
+}
+
+template <typename TokenSource, typename DeclTable>
+const SyntaxNode&
+BasicCompilationEngine<TokenSource, DeclTable>::syntaxTree() {
+  arena_.reset();
+  return buildSyntaxTree(events_, &arena_);
+}
 
-  // Should always start with class.
-  xml_tokens_.emplace_back("<class>");
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::streamTo(
+    XMLRenderer* renderer) {
+  renderer_ = renderer;
 }
 
-void CompilationEngine::writeXMLTokens() const noexcept {
-  std::ofstream output(output_filename_);
-  for (const auto& token : xml_tokens_) {
-    output << token << std::endl;
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::flushEvents() {
+  if (renderer_ != nullptr) {
+    renderer_->render(events_);
+    events_.clear();
+  } else if (backend_ != nullptr) {
+    events_.clear();
   }
-  output.close();
 }
+
+template <typename TokenSource, typename DeclTable>
+void BasicCompilationEngine<TokenSource, DeclTable>::generateTo(
+    IIRBackend* backend) {
+  backend_ = backend;
+  ir_ = backend == nullptr ? nullptr : std::make_unique<IRBuilder>();
+}
+
+template class BasicCompilationEngine<ITokens, IJackDeclarations>;
+template class BasicCompilationEngine<Tokens, JackDeclarations>;
+template class BasicCompilationEngine<StreamingTokens, JackDeclarations>;
@@ -4,13 +4,25 @@
 #ifndef LIB_COMPILATIONENGINE_HPP_
 #define LIB_COMPILATIONENGINE_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
+#include "Arena.hpp"
+#include "IR.hpp"
 #include "JackDeclarations.hpp"
+#include "OutputSink.hpp"
+#include "ParseEvents.hpp"
+#include "StreamingTokens.hpp"
+#include "StructuralIndex.hpp"
+#include "SymbolTable.hpp"
+#include "SyntaxTree.hpp"
 #include "Tokens.hpp"
+#include "WorkStealingScheduler.hpp"
 
 // TODO(me): ClassCompilationEngine
 class ICompilationEngine {
@@ -32,20 +44,25 @@ class ICompilationEngine {
   virtual void compileExpressionList() = 0;
 };
 
-class CompilationEngine : public ICompilationEngine {
+// TokenSource and DeclTable are either the ITokens and IJackDeclarations
+// interfaces, which the tests mock, or the final Tokens and JackDeclarations
+// classes so that every token access is a direct, inlinable call. The
+// DeclTables hold class and subroutine names; variables go to symbols().
+template <typename TokenSource, typename DeclTable>
+class BasicCompilationEngine : public ICompilationEngine {
+  using DefaultDeclTable =
+      std::conditional_t<std::is_abstract_v<DeclTable>, JackDeclarations,
+                         DeclTable>;
+
+
  public:
-  // TODO(me): use shared_ptr.
-  CompilationEngine(
-      const std::string& output_filename, std::unique_ptr<ITokens> tokens,
-      std::unique_ptr<IJackDeclarations> class_name_decs =
-          std::make_unique<JackDeclarations>(),
-      std::unique_ptr<IJackDeclarations> class_var_name_decs =
-          std::make_unique<JackDeclarations>(),
-      std::unique_ptr<IJackDeclarations> subroutine_name_decs =
-          std::make_unique<JackDeclarations>(),
-      std::unique_ptr<IJackDeclarations> subroutine_var_name_decs =
-          std::make_unique<JackDeclarations>());
-  ~CompilationEngine() = default;
+  BasicCompilationEngine(
+      const std::string& output_filename, std::unique_ptr<TokenSource> tokens,
+      std::unique_ptr<DeclTable> class_name_decs =
+          std::make_unique<DefaultDeclTable>(),
+      std::unique_ptr<DeclTable> subroutine_name_decs =
+          std::make_unique<DefaultDeclTable>());
+  ~BasicCompilationEngine() = default;
 
   void compileClass();
   void compileClassVarDec();
@@ -72,9 +89,68 @@ class CompilationEngine : public ICompilationEngine {
   void compileSubroutineStar();
   void compileSubroutineBody();
 
-  void writeXMLTokens() const noexcept;
+  // Same result as compileClass(), but subroutines are parsed concurrently
+  // on scheduler, each by an engine of its own, and merged in source order.
+  // Only for a Tokens source and a concrete DeclTable.
+  void compileClassParallel(WorkStealingScheduler* scheduler);
+
+  // Declarations only: like compileClass(), but subroutineDecs end after
+  // their parameter list and bodies are skipped by bracket matching. Only
+  // for a Tokens source and a concrete DeclTable.
+  void compileClassOutline();
+  // The subroutines compileClassOutline() skipped, in source order.
+  const std::vector<TokenSpan>& outlinedSubroutines() const noexcept {
+    return outlined_subroutines_;
+  }
+  // Parses the whole subroutineDec of an outlined subroutine.
+  ParseEventLog compileOutlinedSubroutine(std::size_t subroutine) const;
+
+  // Writes one line per terminal to output_filename, "-" for stdout.
+  void writeXMLTokens() const;
+
+  // Renders the log into renderer and clears it after every statement and
+  // class member, so that it holds one statement at a time instead of the
+  // whole class. parseEvents() and syntaxTree() then only see what is left.
+  void streamTo(XMLRenderer* renderer);
+  // Renders what is left in the log. No-op unless streaming.
+  void flushEvents();
+
+  // Builds the IR of every subroutine compileClass() parses from now on
+  // and hands it to backend at the end of the subroutine. The log is then
+  // dropped like when streaming. Not owned. compileClassParallel() falls
+  // back to parsing in order, and compileClassOutline() generates nothing.
+  void generateTo(IIRBackend* backend);
+
+  // Everything compiled so far, rendering nothing.
+  const ParseEventLog& parseEvents() const noexcept { return events_; }
+  // Builds a tree of everything compiled so far under a NodeKind::kFragment
+  // root. It stays valid until the next call.
+  const SyntaxNode& syntaxTree();
+
+  // Variables declared so far. Class level ones stay after compileClass(),
+  // a subroutine's are dropped at its end.
+  SymbolTable& symbols() noexcept { return symbols_; }
+  const SymbolTable& symbols() const noexcept { return symbols_; }
 
  private:
+  static constexpr bool kRandomAccess =
+      std::is_same_v<TokenSource, Tokens> && !std::is_abstract_v<DeclTable>;
+  static constexpr char kRandomAccessError[] =
+      "Needs a Tokens source and a concrete DeclTable";
+
+  void compileClassHead();
+  void compileClassTail();
+  void compileSubroutineHead();
+  // identifierPool() ID of the type at the cursor, without consuming it.
+  IdentifierId typeId();
+  // Throws unless the identifier at the cursor is a declared variable.
+  Symbol checkVarName();
+  // Returns how many expressions it compiled.
+  std::uint16_t countedExpressionList();
+  void compileSubroutinesParallel(WorkStealingScheduler* scheduler);
+  // The subroutineDec span on its own, with the class level declarations.
+  ParseEventLog compileSubroutineAt(const TokenSpan& span) const;
+
   bool isTerm();
   bool isExpression();
   bool isKeywordConstant();
@@ -85,20 +161,44 @@ class CompilationEngine : public ICompilationEngine {
   bool isType();
   bool isClassVarDec();
   bool isSubroutine();
-
-  void initializeXML();
+  bool isSymbol(SymbolType symbol_type);
+  bool isSymbolIn(std::uint32_t symbol_set);
+  bool isKeywordIn(std::uint32_t keyword_set);
 
   const std::string output_filename_;
 
-  std::shared_ptr<ITokens> tokens_;
+  // Events point into the token source, which outlives them.
+  ParseEventLog events_;
+  // Backs syntaxTree().
+  Arena arena_;
+  // Not owned. nullptr unless streaming.
+  XMLRenderer* renderer_ = nullptr;
+  // Not owned. nullptr unless generating code.
+  IIRBackend* backend_ = nullptr;
+  // Set with backend_.
+  std::unique_ptr<IRBuilder> ir_;
+  IdentifierId class_name_ = 0;
+  KeyWordType subroutine_kind_ = KeyWordType::kFunction;
+  std::vector<TokenSpan> outlined_subroutines_;
 
-  // TODO(me): class_decs_
-  std::shared_ptr<IJackDeclarations> class_name_decs_;
-  std::shared_ptr<IJackDeclarations> class_var_name_decs_;
-  std::shared_ptr<IJackDeclarations> subroutine_name_decs_;
-  std::shared_ptr<IJackDeclarations> subroutine_var_name_decs_;
+  std::unique_ptr<TokenSource> tokens_;
 
-  std::vector<std::string> xml_tokens_;
+  // TODO(me): class_decs_
+  std::unique_ptr<DeclTable> class_name_decs_;
+  std::unique_ptr<DeclTable> subroutine_name_decs_;
+  // The class scope, and the subroutine scope while compiling one.
+  SymbolTable symbols_;
 };
 
+extern template class BasicCompilationEngine<ITokens, IJackDeclarations>;
+extern template class BasicCompilationEngine<Tokens, JackDeclarations>;
+extern template class BasicCompilationEngine<StreamingTokens,
+                                             JackDeclarations>;
+
+using CompilationEngine = BasicCompilationEngine<ITokens, IJackDeclarations>;
+using ConcreteCompilationEngine =
+    BasicCompilationEngine<Tokens, JackDeclarations>;
+using StreamingCompilationEngine =
+    BasicCompilationEngine<StreamingTokens, JackDeclarations>;
+
 #endif  // LIB_COMPILATIONENGINE_HPP_
@@ -0,0 +1,445 @@
+// No copyright.
+// Lowers the intermediate representation to Hack assembly.
+
+#include "HackBackend.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <stdexcept>
+
+#include "StringInterner.hpp"
+
+namespace {
+
+void appendNumber(const std::uint32_t number, IOutputSink* sink) {
+  char digits[16];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+  sink->append(std::string_view(digits, result.ptr - digits));
+}
+
+// The register holding the base address of each kind of variable but
+// statics, which are assembler symbols.
+std::string_view baseOf(const std::uint8_t kind) {
+  switch (static_cast<SymbolKind>(kind)) {
+    case SymbolKind::kField:
+      return "THIS";
+    case SymbolKind::kArgument:
+      return "ARG";
+    case SymbolKind::kLocal:
+      return "LCL";
+    default:
+      throw std::runtime_error("Invalid symbol kind");
+  }
+}
+
+// The jump on D that is taken when condition holds for D and 0.
+std::string_view jumpOf(const IRCondition condition) {
+  switch (condition) {
+    case IRCondition::kNotEqual:
+      return "D;JNE\n";
+    case IRCondition::kEqual:
+      return "D;JEQ\n";
+    case IRCondition::kLess:
+      return "D;JLT\n";
+    case IRCondition::kGreater:
+      return "D;JGT\n";
+    case IRCondition::kLessOrEqual:
+      return "D;JLE\n";
+    case IRCondition::kGreaterOrEqual:
+      return "D;JGE\n";
+  }
+  throw std::runtime_error("Invalid condition");
+}
+
+}  // namespace
+
+HackBackend::HackBackend(IOutputSink* sink) : sink_(sink) {}
+
+void HackBackend::lower(const IRFunction& function) {
+  auto& pool = identifierPool();
+  class_name_ = pool.text(function.class_name);
+  function_name_.assign(class_name_);
+  function_name_ += '.';
+  function_name_ += pool.text(function.name);
+  label_count_ = 0;
+
+  sink_->append("(");
+  sink_->append(function_name_);
+  sink_->append(")\n");
+  for (std::uint16_t i = 0; i < function.num_locals; ++i) {
+    sink_->append("@SP\nAM=M+1\nA=A-1\nM=0\n");
+  }
+
+  const auto layout = layoutOf(function);
+  for (IRBlockId id = 0; id < function.blocks.size(); ++id) {
+    if (!layout.reachable[id]) {
+      continue;
+    }
+    if (layout.labeled[id]) {
+      appendLabel("L", id);
+    }
+    const auto& block = function.blocks[id];
+    for (std::uint32_t i = 0; i < block.size; ++i) {
+      lowerInstruction(block.instructions[i]);
+    }
+
+    const auto next = id + 1;
+    switch (block.terminator) {
+      case IRTerminator::kFallthrough:
+        break;
+      case IRTerminator::kJump:
+        if (block.target != next) {
+          appendLabelAt("L", block.target);
+          sink_->append("0;JMP\n");
+        }
+        break;
+      case IRTerminator::kBranch:
+        // D compares to 0 as value does to rhs.
+        if (block.rhs == kNoTemp) {
+          popD();
+        } else if (block.condition == IRCondition::kEqual ||
+                   block.condition == IRCondition::kNotEqual) {
+          sink_->append("@SP\nAM=M-1\nD=M\nA=A-1\nD=M-D\n@SP\nM=M-1\n");
+        } else {
+          popOrdered();
+        }
+        if (block.target == next) {
+          appendLabelAt("L", block.other);
+          sink_->append(jumpOf(inverseOf(block.condition)));
+        } else {
+          appendLabelAt("L", block.target);
+          sink_->append(jumpOf(block.condition));
+          if (block.other != next) {
+            appendLabelAt("L", block.other);
+            sink_->append("0;JMP\n");
+          }
+        }
+        break;
+      case IRTerminator::kReturn:
+        lowerReturn();
+        break;
+    }
+  }
+}
+
+void HackBackend::lowerInstruction(const IRInstruction& instruction) {
+  auto& pool = identifierPool();
+  switch (instruction.opcode) {
+    case IROpcode::kConstant: {
+      const auto value = instruction.value;
+      if (value >= -1 && value <= 1) {
+        sink_->append("@SP\nAM=M+1\nA=A-1\n");
+        sink_->append(value == 0 ? "M=0\n" : value == 1 ? "M=1\n" : "M=-1\n");
+        break;
+      }
+      if (value >= 0) {
+        appendAt(static_cast<std::uint32_t>(value));
+        sink_->append("D=A\n");
+      } else {
+        // ~value fits in an A instruction, -value does not for -32768.
+        appendAt(static_cast<std::uint32_t>(~value));
+        sink_->append("D=!A\n");
+      }
+      pushD();
+      break;
+    }
+    case IROpcode::kString:
+      appendAt(instruction.count);
+      sink_->append("D=A\n");
+      pushD();
+      lowerCall("String", "new", 1);
+      for (std::size_t i = 0; i < instruction.count; ++i) {
+        appendAt(static_cast<unsigned char>(instruction.text[i]));
+        sink_->append("D=A\n");
+        pushD();
+        lowerCall("String", "appendChar", 2);
+      }
+      break;
+    case IROpcode::kThis:
+      sink_->append("@THIS\nD=M\n");
+      pushD();
+      break;
+    case IROpcode::kLoad:
+      lowerAddress(instruction.op, instruction.count);
+      sink_->append("D=M\n");
+      pushD();
+      break;
+    case IROpcode::kStore:
+      if (static_cast<SymbolKind>(instruction.op) == SymbolKind::kStatic ||
+          instruction.count <= 1) {
+        popD();
+        lowerAddress(instruction.op, instruction.count);
+      } else {
+        lowerAddress(instruction.op, instruction.count);
+        sink_->append("D=A\n@R13\nM=D\n");
+        popD();
+        sink_->append("@R13\nA=M\n");
+      }
+      sink_->append("M=D\n");
+      break;
+    case IROpcode::kLoadIndirect:
+      sink_->append("@SP\nA=M-1\nA=M\nD=M\n@SP\nA=M-1\nM=D\n");
+      break;
+    case IROpcode::kStoreIndirect:
+      popD();
+      sink_->append("@SP\nAM=M-1\nA=M\nM=D\n");
+      break;
+    case IROpcode::kUnary:
+      switch (static_cast<IRUnaryOp>(instruction.op)) {
+        case IRUnaryOp::kNeg:
+          sink_->append("@SP\nA=M-1\nM=-M\n");
+          break;
+        case IRUnaryOp::kNot:
+          sink_->append("@SP\nA=M-1\nM=!M\n");
+          break;
+        case IRUnaryOp::kMultiplyByPowerOf2:
+          sink_->append("@SP\nA=M-1\n");
+          for (auto i = instruction.value; i > 0; --i) {
+            sink_->append("D=M\nM=D+M\n");
+          }
+          break;
+        case IRUnaryOp::kDivideByPowerOf2:
+          lowerDivideByPowerOf2(instruction.value);
+          break;
+        default:
+          throw std::runtime_error("Invalid unary operation");
+      }
+      break;
+    case IROpcode::kBinary:
+      switch (static_cast<IRBinaryOp>(instruction.op)) {
+        case IRBinaryOp::kAdd:
+          popD();
+          sink_->append("A=A-1\nM=D+M\n");
+          break;
+        case IRBinaryOp::kSub:
+          popD();
+          sink_->append("A=A-1\nM=M-D\n");
+          break;
+        case IRBinaryOp::kMultiply:
+          lowerCall("Math", "multiply", 2);
+          break;
+        case IRBinaryOp::kDivide:
+          lowerCall("Math", "divide", 2);
+          break;
+        case IRBinaryOp::kAnd:
+          popD();
+          sink_->append("A=A-1\nM=D&M\n");
+          break;
+        case IRBinaryOp::kOr:
+          popD();
+          sink_->append("A=A-1\nM=D|M\n");
+          break;
+        case IRBinaryOp::kLessThan:
+          lowerComparison(IRCondition::kLess);
+          break;
+        case IRBinaryOp::kGreaterThan:
+          lowerComparison(IRCondition::kGreater);
+          break;
+        case IRBinaryOp::kEqual:
+          lowerComparison(IRCondition::kEqual);
+          break;
+        default:
+          throw std::runtime_error("Invalid binary operation");
+      }
+      break;
+    case IROpcode::kCall:
+      lowerCall(pool.text(instruction.callee_class),
+                pool.text(instruction.callee_name), instruction.count);
+      break;
+    case IROpcode::kSetThis:
+      popD();
+      sink_->append("@THIS\nM=D\n");
+      break;
+    case IROpcode::kDiscard:
+      sink_->append("@SP\nM=M-1\n");
+      break;
+  }
+}
+
+void HackBackend::lowerCall(const std::string_view class_name,
+                            const std::string_view subroutine,
+                            const std::uint16_t num_args) {
+  const auto return_label = label_count_++;
+  appendLabelAt("ret.", return_label);
+  sink_->append("D=A\n");
+  pushD();
+  for (const auto* saved : {"@LCL\n", "@ARG\n", "@THIS\n", "@THAT\n"}) {
+    sink_->append(saved);
+    sink_->append("D=M\n");
+    pushD();
+  }
+  // ARG = SP - num_args - 5, LCL = SP.
+  sink_->append("@SP\nD=M\n");
+  appendAt(num_args + 5u);
+  sink_->append("D=D-A\n@ARG\nM=D\n@SP\nD=M\n@LCL\nM=D\n@");
+  sink_->append(class_name);
+  sink_->append(".");
+  sink_->append(subroutine);
+  sink_->append("\n0;JMP\n");
+  appendLabel("ret.", return_label);
+}
+
+void HackBackend::lowerReturn() {
+  // R13 = frame, R14 = return address, read before the return value may
+  // overwrite it when there are no arguments.
+  sink_->append(
+      "@LCL\nD=M\n@R13\nM=D\n@5\nA=D-A\nD=M\n@R14\nM=D\n"
+      "@SP\nAM=M-1\nD=M\n@ARG\nA=M\nM=D\n"
+      "@ARG\nD=M+1\n@SP\nM=D\n"
+      "@R13\nAM=M-1\nD=M\n@THAT\nM=D\n"
+      "@R13\nAM=M-1\nD=M\n@THIS\nM=D\n"
+      "@R13\nAM=M-1\nD=M\n@ARG\nM=D\n"
+      "@R13\nAM=M-1\nD=M\n@LCL\nM=D\n"
+      "@R14\nA=M\n0;JMP\n");
+}
+
+void HackBackend::lowerComparison(const IRCondition condition) {
+  if (condition == IRCondition::kEqual) {
+    // lhs - rhs is 0 exactly when they are equal, overflow or not.
+    popD();
+    sink_->append("A=A-1\nD=M-D\nM=-1\n");
+  } else {
+    popOrdered();
+    sink_->append("@SP\nAM=M+1\nA=A-1\nM=-1\n");
+  }
+  const auto label = label_count_++;
+  appendLabelAt("cmp.", label);
+  sink_->append(jumpOf(condition));
+  sink_->append("@SP\nA=M-1\nM=0\n");
+  appendLabel("cmp.", label);
+}
+
+void HackBackend::popOrdered() {
+  const auto rhs_negative = label_count_++;
+  const auto same_sign = label_count_++;
+  const auto done = label_count_++;
+  sink_->append("@SP\nAM=M-1\nD=M\n");
+  appendLabelAt("cmp.", rhs_negative);
+  sink_->append("D;JLT\n@SP\nAM=M-1\nD=M\n");
+  // lhs < 0 <= rhs, and D = lhs says so.
+  appendLabelAt("cmp.", done);
+  sink_->append("D;JLT\n");
+  // Only operands of the same sign subtract without overflow. rhs is just
+  // past SP.
+  appendLabel("cmp.", same_sign);
+  sink_->append("@SP\nA=M+1\nD=D-M\n");
+  appendLabelAt("cmp.", done);
+  sink_->append("0;JMP\n");
+  appendLabel("cmp.", rhs_negative);
+  sink_->append("@SP\nAM=M-1\nD=M\n");
+  appendLabelAt("cmp.", same_sign);
+  // Else rhs < 0 <= lhs.
+  sink_->append("D;JLT\nD=1\n");
+  appendLabel("cmp.", done);
+}
+
+void HackBackend::lowerDivideByPowerOf2(const std::int32_t exponent) {
+  // R13 = x, plus 2^exponent - 1 if negative so that shifting it right
+  // rounds toward 0.
+  const auto biased = label_count_++;
+  sink_->append("@SP\nA=M-1\nD=M\n@R13\nM=D\n");
+  appendLabelAt("div.", biased);
+  sink_->append("D;JGE\n");
+  appendAt((1u << exponent) - 1);
+  sink_->append("D=A\n@R13\nM=D+M\n");
+  appendLabel("div.", biased);
+
+  // Hack cannot shift, so the result is built bit by bit. Bit 15 is the
+  // sign, tested with JGE as 32768 does not fit in an A instruction.
+  sink_->append("@SP\nA=M-1\nM=0\n");
+  for (std::int32_t bit = exponent; bit < 16; ++bit) {
+    const auto skip = label_count_++;
+    sink_->append("@R13\nD=M\n");
+    if (bit < 15) {
+      appendAt(1u << bit);
+      sink_->append("D=D&A\n");
+      appendLabelAt("div.", skip);
+      sink_->append("D;JEQ\n");
+      appendAt(1u << (bit - exponent));
+      sink_->append("D=A\n");
+    } else {
+      appendLabelAt("div.", skip);
+      sink_->append("D;JGE\n");
+      // The sign extends into every bit from 15 - exponent up.
+      appendAt((1u << (15 - exponent)) - 1);
+      sink_->append("D=!A\n");
+    }
+    sink_->append("@SP\nA=M-1\nM=D|M\n");
+    appendLabel("div.", skip);
+  }
+}
+
+void HackBackend::lowerAddress(const std::uint8_t kind,
+                               const std::uint16_t index) {
+  if (static_cast<SymbolKind>(kind) == SymbolKind::kStatic) {
+    appendStatic(index);
+    return;
+  }
+  const auto base = baseOf(kind);
+  if (index <= 1) {
+    appendAt(base);
+    sink_->append(index == 0 ? "A=M\n" : "A=M+1\n");
+    return;
+  }
+  appendAt(index);
+  sink_->append("D=A\n");
+  appendAt(base);
+  sink_->append("A=D+M\n");
+}
+
+void HackBackend::appendAt(const std::string_view symbol) {
+  sink_->append("@");
+  sink_->append(symbol);
+  sink_->append("\n");
+}
+
+void HackBackend::appendAt(const std::uint32_t value) {
+  sink_->append("@");
+  appendNumber(value, sink_);
+  sink_->append("\n");
+}
+
+void HackBackend::appendLabel(const std::string_view suffix,
+                              const std::uint32_t number) {
+  sink_->append("(");
+  sink_->append(function_name_);
+  sink_->append("$");
+  sink_->append(suffix);
+  appendNumber(number, sink_);
+  sink_->append(")\n");
+}
+
+void HackBackend::appendLabelAt(const std::string_view suffix,
+                                const std::uint32_t number) {
+  sink_->append("@");
+  sink_->append(function_name_);
+  sink_->append("$");
+  sink_->append(suffix);
+  appendNumber(number, sink_);
+  sink_->append("\n");
+}
+
+void HackBackend::appendStatic(const std::uint16_t index) {
+  sink_->append("@");
+  sink_->append(class_name_);
+  sink_->append(".");
+  appendNumber(index, sink_);
+  sink_->append("\n");
+}
+
+void HackBackend::pushD() { sink_->append("@SP\nAM=M+1\nA=A-1\nM=D\n"); }
+
+void HackBackend::popD() { sink_->append("@SP\nAM=M-1\nD=M\n"); }
+
+void writeHackBootstrap(IOutputSink* sink) {
+  sink->append(
+      "@256\nD=A\n@SP\nM=D\n"
+      "@Bootstrap$ret\nD=A\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@LCL\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@ARG\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@THIS\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@THAT\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@SP\nD=M\n@5\nD=D-A\n@ARG\nM=D\n@SP\nD=M\n@LCL\nM=D\n"
+      "@Sys.init\n0;JMP\n"
+      "(Bootstrap$ret)\n");
+}
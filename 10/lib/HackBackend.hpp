@@ -0,0 +1,62 @@
+// No copyright.
+// Lowers the intermediate representation to Hack assembly.
+
+#ifndef LIB_HACKBACKEND_HPP_
+#define LIB_HACKBACKEND_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "IR.hpp"
+#include "OutputSink.hpp"
+
+// Follows the calling convention of the VM, stack at SP and frames through
+// LCL, ARG, THIS and THAT, so code from either backend and the OS link
+// together. Temporaries map to the stack, as for VMBackend. Labels are
+// prefixed with Class.subroutine$ so that the output of several classes
+// can be concatenated, after writeHackBootstrap().
+class HackBackend final : public IIRBackend {
+ public:
+  explicit HackBackend(IOutputSink* sink);
+  HackBackend() = delete;
+  ~HackBackend() = default;
+
+  void lower(const IRFunction& function) override;
+
+ private:
+  void lowerInstruction(const IRInstruction& instruction);
+  void lowerCall(std::string_view class_name, std::string_view subroutine,
+                 std::uint16_t num_args);
+  void lowerReturn();
+  // result = lhs op rhs for eq, gt and lt, which hold as condition does.
+  void lowerComparison(IRCondition condition);
+  // Pops rhs, then lhs, leaving D negative, 0 or positive as lhs is less
+  // than, equal to or greater than rhs. D = lhs - rhs would be wrong when
+  // the subtraction overflows, e.g. for 20000 and -20000.
+  void popOrdered();
+  // Replaces the top of the stack x with x / 2^exponent inline.
+  void lowerDivideByPowerOf2(std::int32_t exponent);
+  // Points A at a variable. Clobbers D for indices above 1.
+  void lowerAddress(std::uint8_t kind, std::uint16_t index);
+
+  void appendAt(std::string_view symbol);
+  void appendAt(std::uint32_t value);
+  void appendLabel(std::string_view suffix, std::uint32_t number);
+  void appendLabelAt(std::string_view suffix, std::uint32_t number);
+  void appendStatic(std::uint16_t index);
+  void pushD();
+  void popD();
+
+  IOutputSink* sink_;
+  // Class.subroutine of the function being lowered.
+  std::string function_name_;
+  std::string_view class_name_;
+  // Numbers the labels lowering adds, e.g. return addresses.
+  std::uint32_t label_count_ = 0;
+};
+
+// Sets SP to 256 and calls Sys.init, as the VM does before any code.
+void writeHackBootstrap(IOutputSink* sink);
+
+#endif  // LIB_HACKBACKEND_HPP_
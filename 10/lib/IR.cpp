@@ -0,0 +1,287 @@
+// No copyright.
+// Three-address intermediate representation of a subroutine.
+
+#include "IR.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+IRCondition inverseOf(const IRCondition condition) {
+  switch (condition) {
+    case IRCondition::kNotEqual:
+      return IRCondition::kEqual;
+    case IRCondition::kEqual:
+      return IRCondition::kNotEqual;
+    case IRCondition::kLess:
+      return IRCondition::kGreaterOrEqual;
+    case IRCondition::kGreater:
+      return IRCondition::kLessOrEqual;
+    case IRCondition::kLessOrEqual:
+      return IRCondition::kGreater;
+    case IRCondition::kGreaterOrEqual:
+      return IRCondition::kLess;
+  }
+  throw std::runtime_error("Invalid condition");
+}
+
+IRLayout layoutOf(const IRFunction& function) {
+  const auto num_blocks = function.blocks.size();
+  IRLayout layout{std::vector<bool>(num_blocks),
+                  std::vector<bool>(num_blocks)};
+  if (num_blocks == 0) {
+    return layout;
+  }
+  const auto jump_to = [&](const IRBlockId from, const IRBlockId to) {
+    if (to != from + 1) {
+      layout.labeled[to] = true;
+    }
+  };
+
+  std::vector<IRBlockId> pending{0};
+  layout.reachable[0] = true;
+  const auto reach = [&](const IRBlockId block) {
+    if (block < num_blocks && !layout.reachable[block]) {
+      layout.reachable[block] = true;
+      pending.push_back(block);
+    }
+  };
+  while (!pending.empty()) {
+    const auto id = pending.back();
+    pending.pop_back();
+    const auto& block = function.blocks[id];
+    switch (block.terminator) {
+      case IRTerminator::kFallthrough:
+        reach(id + 1);
+        break;
+      case IRTerminator::kJump:
+        jump_to(id, block.target);
+        reach(block.target);
+        break;
+      case IRTerminator::kBranch:
+        // One of the two may be fallen into, never both.
+        if (block.target == id + 1) {
+          layout.labeled[block.other] = true;
+        } else {
+          layout.labeled[block.target] = true;
+          jump_to(id, block.other);
+        }
+        reach(block.target);
+        reach(block.other);
+        break;
+      case IRTerminator::kReturn:
+        break;
+    }
+  }
+  return layout;
+}
+
+IRBuilder::IRBuilder() : arena_(16 * 1024) {}
+
+void IRBuilder::beginFunction(const IdentifierId class_name,
+                              const IdentifierId name) {
+  function_.class_name = class_name;
+  function_.name = name;
+  function_.num_locals = 0;
+  function_.num_temps = 0;
+  function_.blocks.clear();
+  arena_.reset();
+  stack_.clear();
+  instructions_.clear();
+  positions_.clear();
+  current_ = kNoBlock;
+}
+
+const IRFunction& IRBuilder::endFunction(const std::uint16_t num_locals) {
+  if (current_ != kNoBlock) {
+    terminate(IRTerminator::kFallthrough, kNoTemp, kNoBlock, kNoBlock);
+  }
+  for (auto& block : function_.blocks) {
+    if (block.terminator != IRTerminator::kJump &&
+        block.terminator != IRTerminator::kBranch) {
+      continue;
+    }
+    block.target = positions_[block.target];
+    if (block.terminator == IRTerminator::kBranch) {
+      block.other = positions_[block.other];
+      if (block.other == kNoBlock) {
+        throw std::runtime_error("Jump to a block never placed");
+      }
+    }
+    if (block.target == kNoBlock) {
+      throw std::runtime_error("Jump to a block never placed");
+    }
+  }
+  function_.num_locals = num_locals;
+  return function_;
+}
+
+IRBlockId IRBuilder::newBlock() {
+  positions_.push_back(kNoBlock);
+  return static_cast<IRBlockId>(positions_.size() - 1);
+}
+
+void IRBuilder::placeBlock(const IRBlockId block) {
+  if (block >= positions_.size() || positions_[block] != kNoBlock) {
+    throw std::runtime_error("Block placed twice");
+  }
+  if (current_ != kNoBlock) {
+    terminate(IRTerminator::kFallthrough, kNoTemp, kNoBlock, kNoBlock);
+  }
+  current_ = static_cast<IRBlockId>(function_.blocks.size());
+  positions_[block] = current_;
+  function_.blocks.push_back(IRBlock{nullptr, 0, IRTerminator::kFallthrough,
+                                     kNoTemp, kNoBlock, kNoBlock});
+}
+
+void IRBuilder::constant(const std::int32_t value) {
+  if (value < -32768 || value > 32767) {
+    throw std::runtime_error("Constant out of range");
+  }
+  auto& instruction = append(IROpcode::kConstant);
+  instruction.value = value;
+  instruction.result = push();
+}
+
+void IRBuilder::string(const std::string_view text) {
+  if (text.size() > 32767) {
+    throw std::runtime_error("String constant too long");
+  }
+  auto& instruction = append(IROpcode::kString);
+  instruction.count = static_cast<std::uint16_t>(text.size());
+  instruction.text = text.data();
+  instruction.result = push();
+}
+
+void IRBuilder::thisPointer() { append(IROpcode::kThis).result = push(); }
+
+void IRBuilder::load(const SymbolKind kind, const std::uint16_t index) {
+  auto& instruction = append(IROpcode::kLoad);
+  instruction.op = static_cast<std::uint8_t>(kind);
+  instruction.count = index;
+  instruction.result = push();
+}
+
+void IRBuilder::store(const SymbolKind kind, const std::uint16_t index) {
+  auto& instruction = append(IROpcode::kStore);
+  instruction.op = static_cast<std::uint8_t>(kind);
+  instruction.count = index;
+  instruction.lhs = pop();
+}
+
+void IRBuilder::loadIndirect() {
+  auto& instruction = append(IROpcode::kLoadIndirect);
+  instruction.lhs = pop();
+  instruction.result = push();
+}
+
+void IRBuilder::storeIndirect() {
+  auto& instruction = append(IROpcode::kStoreIndirect);
+  instruction.rhs = pop();
+  instruction.lhs = pop();
+}
+
+void IRBuilder::unary(const IRUnaryOp op) {
+  auto& instruction = append(IROpcode::kUnary);
+  instruction.op = static_cast<std::uint8_t>(op);
+  instruction.lhs = pop();
+  instruction.result = push();
+}
+
+void IRBuilder::binary(const IRBinaryOp op) {
+  auto& instruction = append(IROpcode::kBinary);
+  instruction.op = static_cast<std::uint8_t>(op);
+  instruction.rhs = pop();
+  instruction.lhs = pop();
+  instruction.result = push();
+}
+
+void IRBuilder::call(const IdentifierId callee_class,
+                     const IdentifierId callee_name,
+                     const std::uint16_t num_args) {
+  if (num_args > stack_.size()) {
+    throw std::runtime_error("Missing call arguments");
+  }
+  auto* arguments = static_cast<IRTemp*>(
+      arena_.allocate(num_args * sizeof(IRTemp), alignof(IRTemp)));
+  std::copy(stack_.end() - num_args, stack_.end(), arguments);
+  stack_.resize(stack_.size() - num_args);
+
+  auto& instruction = append(IROpcode::kCall);
+  instruction.count = num_args;
+  instruction.callee_class = callee_class;
+  instruction.callee_name = callee_name;
+  instruction.arguments = arguments;
+  instruction.result = push();
+}
+
+void IRBuilder::setThis() { append(IROpcode::kSetThis).lhs = pop(); }
+
+void IRBuilder::discard() { append(IROpcode::kDiscard).lhs = pop(); }
+
+void IRBuilder::jump(const IRBlockId target) {
+  if (current_ == kNoBlock) {
+    placeBlock(newBlock());
+  }
+  terminate(IRTerminator::kJump, kNoTemp, target, kNoBlock);
+}
+
+void IRBuilder::branch(const IRBlockId target, const IRBlockId other) {
+  if (current_ == kNoBlock) {
+    placeBlock(newBlock());
+  }
+  const auto condition = pop();
+  terminate(IRTerminator::kBranch, condition, target, other);
+}
+
+void IRBuilder::ret() {
+  if (current_ == kNoBlock) {
+    placeBlock(newBlock());
+  }
+  const auto value = pop();
+  terminate(IRTerminator::kReturn, value, kNoBlock, kNoBlock);
+}
+
+IRTemp IRBuilder::pop() {
+  if (stack_.empty()) {
+    throw std::runtime_error("Missing operand");
+  }
+  const auto temp = stack_.back();
+  stack_.pop_back();
+  return temp;
+}
+
+IRTemp IRBuilder::push() {
+  const auto temp = function_.num_temps++;
+  stack_.push_back(temp);
+  return temp;
+}
+
+// Code after a return or a jump gets a block of its own, which nothing
+// reaches.
+IRInstruction& IRBuilder::append(const IROpcode opcode) {
+  if (current_ == kNoBlock) {
+    placeBlock(newBlock());
+  }
+  instructions_.push_back(IRInstruction{opcode});
+  return instructions_.back();
+}
+
+void IRBuilder::terminate(const IRTerminator terminator, const IRTemp value,
+                          const IRBlockId target, const IRBlockId other) {
+  if (!stack_.empty()) {
+    throw std::runtime_error("Unused temporaries at the end of a block");
+  }
+  auto* instructions = static_cast<IRInstruction*>(
+      arena_.allocate(instructions_.size() * sizeof(IRInstruction),
+                      alignof(IRInstruction)));
+  if (!instructions_.empty()) {
+    std::memcpy(instructions, instructions_.data(),
+                instructions_.size() * sizeof(IRInstruction));
+  }
+  function_.blocks[current_] =
+      IRBlock{instructions, static_cast<std::uint32_t>(instructions_.size()),
+              terminator, value, target, other};
+  instructions_.clear();
+  current_ = kNoBlock;
+}
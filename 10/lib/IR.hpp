@@ -0,0 +1,222 @@
+// No copyright.
+// Three-address intermediate representation of a subroutine.
+
+#ifndef LIB_IR_HPP_
+#define LIB_IR_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "Arena.hpp"
+#include "StringInterner.hpp"
+#include "SymbolTable.hpp"
+
+// Virtual temporaries are numbered from 0 in each function.
+using IRTemp = std::uint32_t;
+// Blocks are numbered in layout order from 0, the entry.
+using IRBlockId = std::uint32_t;
+
+constexpr IRTemp kNoTemp = std::numeric_limits<IRTemp>::max();
+constexpr IRBlockId kNoBlock = std::numeric_limits<IRBlockId>::max();
+
+enum class IROpcode : std::uint8_t {
+  // result = value.
+  kConstant = 0,
+  // result = new String of text.
+  kString,
+  // result = this.
+  kThis,
+  // result = variable op[count].
+  kLoad,
+  // variable op[count] = lhs.
+  kStore,
+  // result = memory[lhs].
+  kLoadIndirect,
+  // memory[lhs] = rhs.
+  kStoreIndirect,
+  // result = op lhs.
+  kUnary,
+  // result = lhs op rhs.
+  kBinary,
+  // result = callee_class.callee_name(arguments).
+  kCall,
+  // this = lhs.
+  kSetThis,
+  // lhs is computed for its side effects only.
+  kDiscard,
+};
+
+enum class IRUnaryOp : std::uint8_t {
+  kNeg = 0,
+  kNot,
+  // lhs * 2^value, value from 1 to 15. Only passes introduce these two.
+  kMultiplyByPowerOf2,
+  // lhs / 2^value rounded toward 0 like Math.divide(), value from 1 to 14.
+  kDivideByPowerOf2,
+};
+
+enum class IRBinaryOp : std::uint8_t {
+  kAdd = 0,
+  kSub,
+  kMultiply,
+  kDivide,
+  kAnd,
+  kOr,
+  kLessThan,
+  kGreaterThan,
+  kEqual,
+};
+
+// Values are 16 bit two's complement, true is -1 and false 0.
+struct IRInstruction {
+  IROpcode opcode;
+  // IRUnaryOp, IRBinaryOp, or the SymbolKind of kLoad and kStore.
+  std::uint8_t op = 0;
+  // Variable index of kLoad and kStore, number of arguments of kCall, length
+  // of the text of kString.
+  std::uint16_t count = 0;
+  IRTemp result = kNoTemp;
+  IRTemp lhs = kNoTemp;
+  IRTemp rhs = kNoTemp;
+  // kConstant, from -32768 to 32767, or the exponent of a power of 2.
+  std::int32_t value = 0;
+  // identifierPool() IDs of kCall.
+  IdentifierId callee_class = 0;
+  IdentifierId callee_name = 0;
+  // count temporaries of kCall, in the function's arena.
+  const IRTemp* arguments = nullptr;
+  // count characters of kString, pointing into the source.
+  const char* text = nullptr;
+};
+
+enum class IRTerminator : std::uint8_t {
+  // Into the next block in layout, or out of the function after the last.
+  kFallthrough = 0,
+  // To target.
+  kJump,
+  // To target if value compares to rhs as condition says, else to other.
+  kBranch,
+  // Returns value.
+  kReturn,
+};
+
+// Signed comparisons of a kBranch. The builder only makes kNotEqual to 0;
+// passes fuse comparisons into branches so backends can jump on them
+// directly.
+enum class IRCondition : std::uint8_t {
+  kNotEqual = 0,
+  kEqual,
+  kLess,
+  kGreater,
+  kLessOrEqual,
+  kGreaterOrEqual,
+};
+
+// Holds exactly when condition does not.
+IRCondition inverseOf(IRCondition condition);
+
+struct IRBlock {
+  const IRInstruction* instructions;
+  std::uint32_t size;
+  IRTerminator terminator;
+  IRTemp value;
+  IRBlockId target;
+  IRBlockId other;
+  IRCondition condition = IRCondition::kNotEqual;
+  // What kBranch compares value to, used after it, or kNoTemp for 0.
+  IRTemp rhs = kNoTemp;
+};
+
+// One subroutine. The temporaries are defined once each and, as the parser
+// produces them, used once each in stack order: every instruction uses the
+// most recently defined temporaries that are still unused, lhs before rhs.
+// Backends for stack machines rely on it; passes that break it must say so.
+struct IRFunction {
+  IdentifierId class_name = 0;
+  IdentifierId name = 0;
+  std::uint16_t num_locals = 0;
+  IRTemp num_temps = 0;
+  std::vector<IRBlock> blocks;
+};
+
+// What a backend needs to lay out the blocks of a function in order.
+struct IRLayout {
+  // Whether anything jumps or falls through to each block from the entry.
+  std::vector<bool> reachable;
+  // Whether a reachable block jumps to each block other than by falling
+  // through, so that it needs a label.
+  std::vector<bool> labeled;
+};
+
+IRLayout layoutOf(const IRFunction& function);
+
+// Lowers functions to some target as they are built.
+class IIRBackend {
+ public:
+  virtual ~IIRBackend() = default;
+  virtual void lower(const IRFunction& function) = 0;
+};
+
+// Builds one function at a time like a stack machine would run it: each
+// instruction takes its operands from the temporaries the previous ones
+// left and leaves its result for the next. Memory for a function is reused
+// by the next one, so a function returned by endFunction() is valid until
+// then. Methods taking operands throw if one is missing, and those ending a
+// block throw if it leaves unused temporaries.
+class IRBuilder final {
+ public:
+  IRBuilder();
+  IRBuilder(const IRBuilder&) = delete;
+  IRBuilder& operator=(const IRBuilder&) = delete;
+  ~IRBuilder() = default;
+
+  void beginFunction(IdentifierId class_name, IdentifierId name);
+  // Throws if a jump targets a block that was never placed.
+  const IRFunction& endFunction(std::uint16_t num_locals);
+
+  // A block to jump to, laid out where placeBlock() is called. IDs are
+  // renumbered in layout order by endFunction().
+  IRBlockId newBlock();
+  // Ends the current block, falling through into block.
+  void placeBlock(IRBlockId block);
+
+  void constant(std::int32_t value);
+  void string(std::string_view text);
+  void thisPointer();
+  void load(SymbolKind kind, std::uint16_t index);
+  void store(SymbolKind kind, std::uint16_t index);
+  void loadIndirect();
+  // Takes the address, then the value.
+  void storeIndirect();
+  void unary(IRUnaryOp op);
+  void binary(IRBinaryOp op);
+  void call(IdentifierId callee_class, IdentifierId callee_name,
+            std::uint16_t num_args);
+  void setThis();
+  void discard();
+
+  void jump(IRBlockId target);
+  void branch(IRBlockId target, IRBlockId other);
+  void ret();
+
+ private:
+  IRTemp pop();
+  IRTemp push();
+  IRInstruction& append(IROpcode opcode);
+  void terminate(IRTerminator terminator, IRTemp value, IRBlockId target,
+                 IRBlockId other);
+
+  IRFunction function_;
+  Arena arena_;
+  // Temporaries not used yet.
+  std::vector<IRTemp> stack_;
+  // Of the open block, copied to the arena when it ends.
+  std::vector<IRInstruction> instructions_;
+  // Block IDs as handed out, mapped to layout position on placement.
+  std::vector<IRBlockId> positions_;
+  IRBlockId current_ = kNoBlock;
+};
+
+#endif  // LIB_IR_HPP_
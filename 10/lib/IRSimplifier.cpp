@@ -0,0 +1,645 @@
+// No copyright.
+// Folds constants and simplifies expressions in the intermediate
+// representation.
+
+#include "IRSimplifier.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Jack integers are 16 bit two's complement.
+std::int32_t wrap(const std::int32_t value) {
+  return static_cast<std::int16_t>(static_cast<std::uint16_t>(value));
+}
+
+bool isAdditive(const IRBinaryOp op) {
+  return op == IRBinaryOp::kAdd || op == IRBinaryOp::kSub;
+}
+
+bool isCommutative(const IRBinaryOp op) {
+  return op == IRBinaryOp::kAdd || op == IRBinaryOp::kMultiply ||
+         op == IRBinaryOp::kAnd || op == IRBinaryOp::kOr ||
+         op == IRBinaryOp::kEqual;
+}
+
+bool isComparison(const IRInstruction& instruction) {
+  const auto op = static_cast<IRBinaryOp>(instruction.op);
+  return instruction.opcode == IROpcode::kBinary &&
+         (op == IRBinaryOp::kLessThan || op == IRBinaryOp::kGreaterThan ||
+          op == IRBinaryOp::kEqual);
+}
+
+// Computes lhs op rhs like the VM and Math would. Returns false if that
+// fails at run time instead.
+bool fold(const IRBinaryOp op, const std::int32_t lhs, const std::int32_t rhs,
+          std::int32_t* result) {
+  switch (op) {
+    case IRBinaryOp::kAdd:
+      *result = wrap(lhs + rhs);
+      return true;
+    case IRBinaryOp::kSub:
+      *result = wrap(lhs - rhs);
+      return true;
+    case IRBinaryOp::kMultiply:
+      *result = wrap(lhs * rhs);
+      return true;
+    case IRBinaryOp::kDivide:
+      // Math.divide() reports division by 0, and -32768 / -1 overflows.
+      if (rhs == 0 || (lhs == -32768 && rhs == -1)) {
+        return false;
+      }
+      *result = lhs / rhs;
+      return true;
+    case IRBinaryOp::kAnd:
+      *result = lhs & rhs;
+      return true;
+    case IRBinaryOp::kOr:
+      *result = lhs | rhs;
+      return true;
+    case IRBinaryOp::kLessThan:
+      *result = lhs < rhs ? -1 : 0;
+      return true;
+    case IRBinaryOp::kGreaterThan:
+      *result = lhs > rhs ? -1 : 0;
+      return true;
+    case IRBinaryOp::kEqual:
+      *result = lhs == rhs ? -1 : 0;
+      return true;
+  }
+  return false;
+}
+
+std::int32_t foldUnary(const IRUnaryOp op, const std::int32_t operand,
+                       const std::int32_t exponent) {
+  switch (op) {
+    case IRUnaryOp::kNeg:
+      return wrap(-operand);
+    case IRUnaryOp::kNot:
+      return ~operand;
+    case IRUnaryOp::kMultiplyByPowerOf2:
+      return wrap(operand * (1 << exponent));
+    case IRUnaryOp::kDivideByPowerOf2:
+      return operand / (1 << exponent);
+  }
+  throw std::runtime_error("Invalid unary operation");
+}
+
+// The k for which value is 2^k, or -1 if there is none.
+std::int32_t exponentOf(const std::int32_t value) {
+  for (std::int32_t k = 0; k < 16; ++k) {
+    if (value == 1 << k) {
+      return k;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+IRSimplifier::IRSimplifier(IIRBackend* next)
+    : next_(next), arena_(16 * 1024) {}
+
+void IRSimplifier::lower(const IRFunction& function) {
+  arena_.reset();
+  function_.class_name = function.class_name;
+  function_.name = function.name;
+  function_.num_locals = function.num_locals;
+  function_.num_temps = function.num_temps;
+  function_.blocks.resize(function.blocks.size());
+  for (std::size_t id = 0; id < function.blocks.size(); ++id) {
+    simplifyBlock(function.blocks[id], &function_.blocks[id]);
+  }
+  duplicateLoopTests();
+  next_->lower(function_);
+}
+
+void IRSimplifier::simplifyBlock(const IRBlock& block, IRBlock* result) {
+  out_.clear();
+  stack_.clear();
+  for (std::uint32_t i = 0; i < block.size; ++i) {
+    const auto& instruction = block.instructions[i];
+    auto copy = instruction;
+    switch (instruction.opcode) {
+      case IROpcode::kConstant:
+        pushConstant(out_.size(), instruction.result, instruction.value);
+        break;
+      case IROpcode::kString:
+        // Allocates, which is worth keeping even if the string is unused.
+        emit(copy, out_.size(), false);
+        break;
+      case IROpcode::kThis:
+      case IROpcode::kLoad:
+        emit(copy, out_.size(), true);
+        break;
+      case IROpcode::kStore:
+      case IROpcode::kSetThis:
+        copy.lhs = pop(instruction.lhs).temp;
+        emit(copy, out_.size(), false);
+        break;
+      case IROpcode::kLoadIndirect: {
+        const auto address = pop(instruction.lhs);
+        copy.lhs = address.temp;
+        emit(copy, address.begin, address.pure);
+        break;
+      }
+      case IROpcode::kStoreIndirect:
+        copy.rhs = pop(instruction.rhs).temp;
+        copy.lhs = pop(instruction.lhs).temp;
+        emit(copy, out_.size(), false);
+        break;
+      case IROpcode::kUnary:
+        simplifyUnary(instruction);
+        break;
+      case IROpcode::kBinary:
+        simplifyBinary(instruction);
+        break;
+      case IROpcode::kCall: {
+        auto* arguments = static_cast<IRTemp*>(arena_.allocate(
+            instruction.count * sizeof(IRTemp), alignof(IRTemp)));
+        auto begin = out_.size();
+        for (auto j = instruction.count; j > 0; --j) {
+          const auto argument = pop(instruction.arguments[j - 1]);
+          arguments[j - 1] = argument.temp;
+          begin = argument.begin;
+        }
+        copy.arguments = arguments;
+        emit(copy, begin, false);
+        break;
+      }
+      case IROpcode::kDiscard: {
+        const auto value = pop(instruction.lhs);
+        if (value.pure) {
+          out_.resize(value.begin);
+        } else {
+          copy.lhs = value.temp;
+          emit(copy, out_.size(), false);
+        }
+        break;
+      }
+    }
+    // Whatever computes the result now, later instructions still name it
+    // by its old temporary.
+    if (instruction.result != kNoTemp) {
+      stack_.back().source = instruction.result;
+    }
+  }
+
+  *result = block;
+  switch (block.terminator) {
+    case IRTerminator::kFallthrough:
+    case IRTerminator::kJump:
+      break;
+    case IRTerminator::kBranch: {
+      if (block.rhs != kNoTemp) {
+        result->rhs = pop(block.rhs).temp;
+        result->value = pop(block.value).temp;
+        break;
+      }
+      const auto condition = pop(block.value);
+      if (condition.known && block.condition == IRCondition::kNotEqual) {
+        out_.resize(condition.begin);
+        result->terminator = IRTerminator::kJump;
+        result->value = kNoTemp;
+        result->target = condition.constant != 0 ? block.target : block.other;
+        result->other = kNoBlock;
+      } else {
+        result->value = condition.temp;
+        fuseCondition(result);
+      }
+      break;
+    }
+    case IRTerminator::kReturn:
+      result->value = pop(block.value).temp;
+      break;
+  }
+  if (!stack_.empty()) {
+    throw std::runtime_error("Unused temporaries at the end of a block");
+  }
+
+  auto* instructions = static_cast<IRInstruction*>(arena_.allocate(
+      out_.size() * sizeof(IRInstruction), alignof(IRInstruction)));
+  if (!out_.empty()) {
+    std::memcpy(instructions, out_.data(),
+                out_.size() * sizeof(IRInstruction));
+  }
+  result->instructions = instructions;
+  result->size = static_cast<std::uint32_t>(out_.size());
+}
+
+void IRSimplifier::fuseCondition(IRBlock* block) {
+  if (block->condition != IRCondition::kNotEqual || out_.empty() ||
+      out_.back().result != block->value) {
+    return;
+  }
+  // ~ of a comparison, which is 0 or -1, holds when the comparison does
+  // not. Of anything else it tests for -1.
+  auto condition = IRCondition::kNotEqual;
+  if (out_.back().opcode == IROpcode::kUnary &&
+      static_cast<IRUnaryOp>(out_.back().op) == IRUnaryOp::kNot &&
+      out_.size() >= 2 && isComparison(out_[out_.size() - 2]) &&
+      out_[out_.size() - 2].result == out_.back().lhs) {
+    out_.pop_back();
+    condition = IRCondition::kEqual;
+  }
+  const auto& comparison = out_.back();
+  if (!isComparison(comparison)) {
+    return;
+  }
+  switch (static_cast<IRBinaryOp>(comparison.op)) {
+    case IRBinaryOp::kLessThan:
+      condition = condition == IRCondition::kEqual
+                      ? IRCondition::kGreaterOrEqual
+                      : IRCondition::kLess;
+      break;
+    case IRBinaryOp::kGreaterThan:
+      condition = condition == IRCondition::kEqual
+                      ? IRCondition::kLessOrEqual
+                      : IRCondition::kGreater;
+      break;
+    case IRBinaryOp::kEqual:
+      condition = condition == IRCondition::kEqual ? IRCondition::kNotEqual
+                                                   : IRCondition::kEqual;
+      break;
+    default:
+      return;
+  }
+  block->condition = condition;
+  block->value = comparison.lhs;
+  block->rhs = comparison.rhs;
+  out_.pop_back();
+
+  // Against 0, x < 1 and x > -1, Hack needs no subtraction.
+  const auto& constant = out_.back();
+  if (constant.opcode != IROpcode::kConstant ||
+      constant.result != block->rhs) {
+    return;
+  }
+  if (constant.value == 1 && condition == IRCondition::kLess) {
+    block->condition = IRCondition::kLessOrEqual;
+  } else if (constant.value == -1 && condition == IRCondition::kGreater) {
+    block->condition = IRCondition::kGreaterOrEqual;
+  } else if (constant.value != 0) {
+    return;
+  }
+  block->rhs = kNoTemp;
+  out_.pop_back();
+}
+
+void IRSimplifier::duplicateLoopTests() {
+  for (auto& block : function_.blocks) {
+    if (block.terminator != IRTerminator::kJump) {
+      continue;
+    }
+    const auto& test = function_.blocks[block.target];
+    if (&test == &block || test.terminator != IRTerminator::kBranch ||
+        test.size > kMaxDuplicatedTest) {
+      continue;
+    }
+
+    // The copy computes its own temporaries.
+    renamed_.assign(function_.num_temps, kNoTemp);
+    const auto rename = [&](const IRTemp temp) {
+      return temp == kNoTemp ? kNoTemp : renamed_[temp];
+    };
+    auto* instructions = static_cast<IRInstruction*>(
+        arena_.allocate((block.size + test.size) * sizeof(IRInstruction),
+                        alignof(IRInstruction)));
+    if (block.size != 0) {
+      std::memcpy(instructions, block.instructions,
+                  block.size * sizeof(IRInstruction));
+    }
+    for (std::uint32_t i = 0; i < test.size; ++i) {
+      auto copy = test.instructions[i];
+      copy.lhs = rename(copy.lhs);
+      copy.rhs = rename(copy.rhs);
+      if (copy.opcode == IROpcode::kCall) {
+        auto* arguments = static_cast<IRTemp*>(arena_.allocate(
+            copy.count * sizeof(IRTemp), alignof(IRTemp)));
+        for (std::uint16_t j = 0; j < copy.count; ++j) {
+          arguments[j] = rename(copy.arguments[j]);
+        }
+        copy.arguments = arguments;
+      }
+      if (copy.result != kNoTemp) {
+        renamed_[copy.result] = function_.num_temps;
+        copy.result = function_.num_temps++;
+      }
+      instructions[block.size + i] = copy;
+    }
+
+    block.instructions = instructions;
+    block.size += test.size;
+    block.terminator = IRTerminator::kBranch;
+    block.value = rename(test.value);
+    block.rhs = rename(test.rhs);
+    block.condition = test.condition;
+    block.target = test.target;
+    block.other = test.other;
+  }
+}
+
+void IRSimplifier::simplifyUnary(const IRInstruction& instruction) {
+  const auto operand = pop(instruction.lhs);
+  const auto op = static_cast<IRUnaryOp>(instruction.op);
+  if (operand.known) {
+    pushConstant(operand.begin, instruction.result,
+                 foldUnary(op, operand.constant, instruction.value));
+    return;
+  }
+
+  // Computes the operand, which is not a constant.
+  auto& last = out_.back();
+  if ((op == IRUnaryOp::kNeg || op == IRUnaryOp::kNot) &&
+      last.opcode == IROpcode::kUnary && last.op == instruction.op) {
+    // ~(~x) and -(-x) are x.
+    const auto inner = last.lhs;
+    out_.pop_back();
+    stack_.push_back(
+        Value{operand.begin, inner, inner, false, 0, operand.pure});
+    return;
+  }
+  if (op == IRUnaryOp::kNot && last.opcode == IROpcode::kBinary) {
+    auto& constant = out_[out_.size() - 2];
+    const auto comparison = static_cast<IRBinaryOp>(last.op);
+    if (constant.opcode == IROpcode::kConstant &&
+        constant.result == last.rhs) {
+      if (comparison == IRBinaryOp::kLessThan && constant.value > -32768) {
+        constant.value -= 1;
+        last.op = static_cast<std::uint8_t>(IRBinaryOp::kGreaterThan);
+        stack_.push_back(operand);
+        return;
+      }
+      if (comparison == IRBinaryOp::kGreaterThan && constant.value < 32767) {
+        constant.value += 1;
+        last.op = static_cast<std::uint8_t>(IRBinaryOp::kLessThan);
+        stack_.push_back(operand);
+        return;
+      }
+    }
+  }
+
+  auto copy = instruction;
+  copy.lhs = operand.temp;
+  emit(copy, operand.begin, operand.pure);
+}
+
+void IRSimplifier::simplifyBinary(const IRInstruction& instruction) {
+  auto rhs = pop(instruction.rhs);
+  auto lhs = pop(instruction.lhs);
+  auto op = static_cast<IRBinaryOp>(instruction.op);
+  IRInstruction negate{IROpcode::kUnary};
+  negate.op = static_cast<std::uint8_t>(IRUnaryOp::kNeg);
+  negate.result = instruction.result;
+
+  if (lhs.known && rhs.known) {
+    std::int32_t value;
+    if (fold(op, lhs.constant, rhs.constant, &value)) {
+      pushConstant(lhs.begin, instruction.result, value);
+      return;
+    }
+  } else if (lhs.known) {
+    if (op == IRBinaryOp::kSub && lhs.constant == 0) {
+      // 0 - x is -x.
+      out_.erase(out_.begin() + lhs.begin);
+      negate.lhs = rhs.temp;
+      stack_.push_back(
+          Value{lhs.begin, rhs.temp, rhs.temp, false, 0, rhs.pure});
+      simplifyUnary(negate);
+      return;
+    }
+    if (isCommutative(op) || op == IRBinaryOp::kLessThan ||
+        op == IRBinaryOp::kGreaterThan) {
+      // Evaluating a constant has no effects, so it can go last.
+      std::rotate(out_.begin() + lhs.begin, out_.begin() + lhs.begin + 1,
+                  out_.end());
+      const Value constant{out_.size() - 1, lhs.temp,     lhs.source,
+                           true,            lhs.constant, true};
+      const auto begin = lhs.begin;
+      lhs = rhs;
+      lhs.begin = begin;
+      rhs = constant;
+      if (op == IRBinaryOp::kLessThan) {
+        op = IRBinaryOp::kGreaterThan;
+      } else if (op == IRBinaryOp::kGreaterThan) {
+        op = IRBinaryOp::kLessThan;
+      }
+    }
+  }
+
+  if (rhs.known && !lhs.known) {
+    const auto constant = rhs.constant;
+    if ((constant == 0 && (isAdditive(op) || op == IRBinaryOp::kOr)) ||
+        (constant == 1 &&
+         (op == IRBinaryOp::kMultiply || op == IRBinaryOp::kDivide)) ||
+        (constant == -1 && op == IRBinaryOp::kAnd)) {
+      out_.resize(rhs.begin);
+      stack_.push_back(lhs);
+      return;
+    }
+    if (lhs.pure && ((constant == 0 && (op == IRBinaryOp::kMultiply ||
+                                        op == IRBinaryOp::kAnd)) ||
+                     (constant == -1 && op == IRBinaryOp::kOr))) {
+      pushConstant(lhs.begin, instruction.result, constant);
+      return;
+    }
+    if (constant == -1 && op == IRBinaryOp::kMultiply) {
+      out_.resize(rhs.begin);
+      negate.lhs = lhs.temp;
+      lhs.source = lhs.temp;
+      stack_.push_back(lhs);
+      simplifyUnary(negate);
+      return;
+    }
+    if (reassociate(op, lhs, rhs) ||
+        reduceStrength(op, lhs, rhs, instruction.result)) {
+      return;
+    }
+    if (isAdditive(op) && constant < 0 && constant != -32768) {
+      // x + -c is x - c, which needs no negation of the constant.
+      out_.back().value = -constant;
+      op = op == IRBinaryOp::kAdd ? IRBinaryOp::kSub : IRBinaryOp::kAdd;
+    }
+  }
+
+  auto copy = instruction;
+  copy.op = static_cast<std::uint8_t>(op);
+  copy.lhs = lhs.temp;
+  copy.rhs = rhs.temp;
+  // Math.divide() may fail.
+  emit(copy, lhs.begin,
+       lhs.pure && rhs.pure && op != IRBinaryOp::kDivide);
+}
+
+bool IRSimplifier::reassociate(const IRBinaryOp op, const Value& lhs,
+                               const Value& rhs) {
+  if (rhs.begin < lhs.begin + 2) {
+    return false;
+  }
+  auto& inner = out_[rhs.begin - 1];
+  auto& constant = out_[rhs.begin - 2];
+  if (inner.opcode != IROpcode::kBinary ||
+      constant.opcode != IROpcode::kConstant ||
+      constant.result != inner.rhs) {
+    return false;
+  }
+  const auto inner_op = static_cast<IRBinaryOp>(inner.op);
+  if (isAdditive(op) && isAdditive(inner_op)) {
+    // (x + c1) - c2 is x + (c1 - c2), and so on.
+    const auto value =
+        wrap((inner_op == IRBinaryOp::kAdd ? constant.value
+                                           : -constant.value) +
+             (op == IRBinaryOp::kAdd ? rhs.constant : -rhs.constant));
+    if (value == 0) {
+      const auto x = inner.lhs;
+      out_.resize(rhs.begin - 2);
+      stack_.push_back(Value{lhs.begin, x, x, false, 0, lhs.pure});
+      return true;
+    }
+    const auto subtract = value < 0 && value != -32768;
+    inner.op = static_cast<std::uint8_t>(subtract ? IRBinaryOp::kSub
+                                                  : IRBinaryOp::kAdd);
+    constant.value = subtract ? -value : value;
+  } else if (op == IRBinaryOp::kMultiply &&
+             inner_op == IRBinaryOp::kMultiply) {
+    constant.value = wrap(constant.value * rhs.constant);
+  } else {
+    return false;
+  }
+  out_.resize(rhs.begin);
+  stack_.push_back(lhs);
+  return true;
+}
+
+bool IRSimplifier::reduceStrength(const IRBinaryOp op, const Value& lhs,
+                                  const Value& rhs, const IRTemp result) {
+  // -32768 is 2^15 modulo 2^16.
+  const auto negative = rhs.constant < 0 && rhs.constant != -32768;
+  const auto magnitude = negative ? -rhs.constant : rhs.constant & 0xffff;
+  const auto exponent = exponentOf(magnitude);
+  // Of x op magnitude, negated into result if the constant is negative.
+  // Its temporary is allocated only once the rewrite is certain.
+  const auto positive = [&] {
+    return negative ? function_.num_temps++ : result;
+  };
+
+  if (op == IRBinaryOp::kDivide) {
+    if (exponent < 1 || exponent > 14) {
+      return false;
+    }
+    out_.resize(rhs.begin);
+    emitUnary(IRUnaryOp::kDivideByPowerOf2, exponent, lhs, positive());
+  } else if (op != IRBinaryOp::kMultiply) {
+    return false;
+  } else if (exponent >= 1) {
+    out_.resize(rhs.begin);
+    auto& last = out_.back();
+    if (last.opcode == IROpcode::kUnary &&
+        static_cast<IRUnaryOp>(last.op) == IRUnaryOp::kMultiplyByPowerOf2 &&
+        last.value + exponent <= 15) {
+      // (x * 4) * 8 is x * 32.
+      last.value += exponent;
+      stack_.push_back(lhs);
+    } else {
+      emitUnary(IRUnaryOp::kMultiplyByPowerOf2, exponent, lhs, positive());
+    }
+  } else if (!multiplyBySumOfPowers(lhs, rhs, magnitude,
+                                    negative ? kNoTemp : result)) {
+    return false;
+  }
+
+  if (negative) {
+    const auto value = stack_.back();
+    stack_.pop_back();
+    emitUnary(IRUnaryOp::kNeg, 0, value, result);
+  }
+  return true;
+}
+
+bool IRSimplifier::multiplyBySumOfPowers(const Value& lhs, const Value& rhs,
+                                         const std::int32_t magnitude,
+                                         const IRTemp result) {
+  // x must be cheap to compute twice and the same both times.
+  if (rhs.begin != lhs.begin + 1 ||
+      (out_[lhs.begin].opcode != IROpcode::kLoad &&
+       out_[lhs.begin].opcode != IROpcode::kThis)) {
+    return false;
+  }
+  for (std::int32_t high = 1; high < 16; ++high) {
+    for (std::int32_t low = 0; low < high; ++low) {
+      const auto sum = (1 << high) + (1 << low) == magnitude;
+      if (!sum && (1 << high) - (1 << low) != magnitude) {
+        continue;
+      }
+      // x * 10 is (x * 8) + (x * 2), x * 7 is (x * 8) - x.
+      const auto load = out_[lhs.begin];
+      out_.resize(rhs.begin);
+      emitUnary(IRUnaryOp::kMultiplyByPowerOf2, high, lhs,
+                function_.num_temps++);
+      const auto first = stack_.back();
+      stack_.pop_back();
+
+      auto reload = load;
+      reload.result = function_.num_temps++;
+      emit(reload, out_.size(), true);
+      auto second = stack_.back();
+      if (low > 0) {
+        stack_.pop_back();
+        emitUnary(IRUnaryOp::kMultiplyByPowerOf2, low, second,
+                  function_.num_temps++);
+        second = stack_.back();
+      }
+      stack_.pop_back();
+
+      IRInstruction combine{IROpcode::kBinary};
+      combine.op = static_cast<std::uint8_t>(sum ? IRBinaryOp::kAdd
+                                                 : IRBinaryOp::kSub);
+      combine.lhs = first.temp;
+      combine.rhs = second.temp;
+      combine.result = result == kNoTemp ? function_.num_temps++ : result;
+      emit(combine, lhs.begin, true);
+      return true;
+    }
+  }
+  return false;
+}
+
+void IRSimplifier::emitUnary(const IRUnaryOp op, const std::int32_t value,
+                             const Value& operand, const IRTemp result) {
+  IRInstruction instruction{IROpcode::kUnary};
+  instruction.op = static_cast<std::uint8_t>(op);
+  instruction.value = value;
+  instruction.lhs = operand.temp;
+  instruction.result = result;
+  emit(instruction, operand.begin, operand.pure);
+}
+
+void IRSimplifier::pushConstant(const std::size_t begin, const IRTemp temp,
+                                const std::int32_t value) {
+  out_.resize(begin);
+  IRInstruction instruction{IROpcode::kConstant};
+  instruction.value = value;
+  instruction.result = temp;
+  out_.push_back(instruction);
+  stack_.push_back(Value{begin, temp, temp, true, value, true});
+}
+
+void IRSimplifier::emit(const IRInstruction& instruction,
+                        const std::size_t begin, const bool pure) {
+  out_.push_back(instruction);
+  if (instruction.result != kNoTemp) {
+    stack_.push_back(Value{begin, instruction.result, instruction.result,
+                           false, 0, pure});
+  }
+}
+
+IRSimplifier::Value IRSimplifier::pop(const IRTemp source) {
+  if (stack_.empty() || stack_.back().source != source) {
+    throw std::runtime_error("Temporaries out of stack order");
+  }
+  const auto value = stack_.back();
+  stack_.pop_back();
+  return value;
+}
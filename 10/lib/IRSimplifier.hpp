@@ -0,0 +1,104 @@
+// No copyright.
+// Folds constants and simplifies expressions in the intermediate
+// representation.
+
+#ifndef LIB_IRSIMPLIFIER_HPP_
+#define LIB_IRSIMPLIFIER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Arena.hpp"
+#include "IR.hpp"
+
+// A pass in front of another backend. Each function is rewritten into
+// memory of the simplifier's own, then lowered by next:
+// - Operations on constants are folded, e.g. 16 * 32 becomes 512, unless
+//   they would fail at run time like a division by 0.
+// - Identities are dropped, e.g. x + 0, x * 1, ~(~x) and -(-x), and so are
+//   operands of x * 0, x & 0 and x | -1 that have no side effects.
+// - Constants move to the right of commutative operations and comparisons,
+//   5 < x becoming x > 5, and chains like (x + 2) - 7 become x - 5.
+// - ~(x < c) and ~(x > c) become x > c - 1 and x < c + 1.
+// - Multiplications by constants become shifts, IRUnaryOp::
+//   kMultiplyByPowerOf2, when the constant is a power of 2, or of a variable
+//   by the sum or difference of two, like x * 10 into (x * 8) + (x * 2).
+//   Divisions by powers of 2 become IRUnaryOp::kDivideByPowerOf2. Either
+//   is negated after for negative constants.
+// - Branches on constants become jumps. Branches on a comparison, or on ~
+//   of one, compare instead, as IRCondition allows, and against 0 when the
+//   comparison is to 0, or x < 1 or x > -1.
+// - Jumps to a block of at most kMaxDuplicatedTest instructions that ends
+//   in a branch copy it instead, so the end of a while loop tests and
+//   branches back to the body rather than jumping to the test at the top.
+// The result keeps temporaries in stack order, numbered as before with
+// gaps where instructions were dropped.
+class IRSimplifier final : public IIRBackend {
+ public:
+  explicit IRSimplifier(IIRBackend* next);
+  IRSimplifier() = delete;
+  IRSimplifier(const IRSimplifier&) = delete;
+  IRSimplifier& operator=(const IRSimplifier&) = delete;
+  ~IRSimplifier() = default;
+
+  void lower(const IRFunction& function) override;
+
+ private:
+  // What a temporary on the stack was computed by: the instructions in
+  // out_ from begin up to the next value.
+  struct Value {
+    std::size_t begin;
+    IRTemp temp;
+    // The temporary the input function computed it in.
+    IRTemp source;
+    // Whether the instructions are a single kConstant.
+    bool known;
+    std::int32_t constant;
+    // Whether they could be dropped without changing what the program does.
+    bool pure;
+  };
+
+  static constexpr std::uint32_t kMaxDuplicatedTest = 16;
+
+  void simplifyBlock(const IRBlock& block, IRBlock* result);
+  // Folds the comparison that computes the value of a kBranch, at the end
+  // of out_, into its condition.
+  void fuseCondition(IRBlock* block);
+  void duplicateLoopTests();
+  void simplifyUnary(const IRInstruction& instruction);
+  void simplifyBinary(const IRInstruction& instruction);
+  // Rewrites lhs op rhs, rhs a constant, when lhs is itself x op2 c.
+  // Returns false if it is not.
+  bool reassociate(IRBinaryOp op, const Value& lhs, const Value& rhs);
+  // Rewrites lhs op rhs, rhs a constant, into shifts and additions if op
+  // is a multiplication or division it can do without. Returns false if
+  // it cannot.
+  bool reduceStrength(IRBinaryOp op, const Value& lhs, const Value& rhs,
+                      IRTemp result);
+  // Computes lhs * magnitude into result, or a new temporary if it is
+  // kNoTemp, as 2^a + 2^b or 2^a - 2^b times lhs, if magnitude is either and
+  // lhs a variable. Returns false if not, allocating nothing.
+  bool multiplyBySumOfPowers(const Value& lhs, const Value& rhs,
+                             std::int32_t magnitude, IRTemp result);
+  // Appends result = op(value) operand.
+  void emitUnary(IRUnaryOp op, std::int32_t value, const Value& operand,
+                 IRTemp result);
+  void pushConstant(std::size_t begin, IRTemp temp, std::int32_t value);
+  // Appends instruction, pushing its result if any.
+  void emit(const IRInstruction& instruction, std::size_t begin, bool pure);
+  // Throws unless the top of the stack is what the input computed in
+  // source.
+  Value pop(IRTemp source);
+
+  IIRBackend* next_;
+  IRFunction function_;
+  Arena arena_;
+  // Instructions of the block being simplified.
+  std::vector<IRInstruction> out_;
+  std::vector<Value> stack_;
+  // Temporaries of a duplicated test, indexed by the originals.
+  std::vector<IRTemp> renamed_;
+};
+
+#endif  // LIB_IRSIMPLIFIER_HPP_
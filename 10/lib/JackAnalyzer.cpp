@@ -3,18 +3,172 @@
 
 #include "JackAnalyzer.hpp"
 
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#include "HackBackend.hpp"
+#include "IR.hpp"
+#include "IRSimplifier.hpp"
 #include "JackTokenizer.hpp"
+#include "MappedFile.hpp"
+#include "OutputSink.hpp"
+#include "ParseEvents.hpp"
+#include "StreamingTokens.hpp"
 #include "Tokens.hpp"
+#include "VMBackend.hpp"
+#include "VMWriter.hpp"
 
 JackAnalyzer::JackAnalyzer(const std::string& source,
-                           const std::string& output_filename)
-    : source_(source), output_filename_(output_filename) {}
+                           const std::string& output_filename,
+                           WorkStealingScheduler* scheduler)
+    : source_(source),
+      output_filename_(output_filename),
+      scheduler_(scheduler) {}
 
 void JackAnalyzer::compileToXML() {
-  JackTokenizer jack_tokenizer(source_);
+  JackTokenizer jack_tokenizer(source_, LexMode::kSinglePass);
   auto tokens = jack_tokenizer.parseInputFile();
-  CompilationEngine compilation_engine(output_filename_,
-                                       std::make_unique<Tokens>(tokens));
-  compilation_engine.compileClass();
+  ConcreteCompilationEngine compilation_engine(
+      output_filename_, std::make_unique<Tokens>(std::move(tokens)));
+  compileClass(&compilation_engine);
   compilation_engine.writeXMLTokens();
 }
+
+void JackAnalyzer::compileToTokensAndTreeXML() {
+  JackTokenizer jack_tokenizer(source_, LexMode::kSinglePass);
+  auto tokens = jack_tokenizer.parseInputFile();
+  ConcreteCompilationEngine compilation_engine(
+      output_filename_, std::make_unique<Tokens>(std::move(tokens)));
+  compileClass(&compilation_engine);
+
+  // Both renderers only read the event log.
+  const auto& events = compilation_engine.parseEvents();
+  const auto tokens_filename = tokensFilenameFor(output_filename_);
+  std::exception_ptr tokens_error;
+  std::thread tokens_writer([&] {
+    try {
+      BufferedFileSink output(tokens_filename);
+      writeTokensXML(events, &output);
+      output.flush();
+    } catch (...) {
+      tokens_error = std::current_exception();
+    }
+  });
+
+  try {
+    BufferedFileSink output(output_filename_);
+    writeTreeXML(events, &output);
+    output.flush();
+  } catch (...) {
+    tokens_writer.join();
+    throw;
+  }
+  tokens_writer.join();
+  if (tokens_error) {
+    std::rethrow_exception(tokens_error);
+  }
+}
+
+void JackAnalyzer::compileToTreeXMLStreaming() {
+  auto mapped_file = std::make_shared<const MappedFile>(source_);
+  // One write, so that lines of concurrent analyzers do not interleave.
+  std::cerr << "Read input file: " + source_ + "\n";
+  const std::string_view source(mapped_file->data(), mapped_file->size());
+  StreamingCompilationEngine compilation_engine(
+      output_filename_,
+      std::make_unique<StreamingTokens>(std::move(mapped_file), source));
+
+  BufferedFileSink output(output_filename_);
+  XMLRenderer renderer(XMLFormat::kTree, &output);
+  compilation_engine.streamTo(&renderer);
+  compilation_engine.compileClass();
+  compilation_engine.flushEvents();
+  renderer.finish();
+  output.flush();
+}
+
+void JackAnalyzer::compileToOutlineXML() {
+  JackTokenizer jack_tokenizer(source_, LexMode::kSinglePass);
+  auto tokens = jack_tokenizer.parseInputFile();
+  ConcreteCompilationEngine compilation_engine(
+      output_filename_, std::make_unique<Tokens>(std::move(tokens)));
+  compilation_engine.compileClassOutline();
+
+  BufferedFileSink output(output_filename_);
+  writeTreeXML(compilation_engine.parseEvents(), &output);
+  output.flush();
+}
+
+void JackAnalyzer::compileToVM() {
+  BufferedFileSink output(output_filename_);
+  VMWriter writer(&output);
+  VMBackend backend(&writer);
+  IRSimplifier simplifier(&backend);
+  generate(&simplifier);
+  output.flush();
+}
+
+void JackAnalyzer::compileToHackAssembly() {
+  BufferedFileSink output(output_filename_);
+  HackBackend backend(&output);
+  IRSimplifier simplifier(&backend);
+  generate(&simplifier);
+  output.flush();
+}
+
+void JackAnalyzer::compile(const AnalyzerOutput output) {
+  switch (output) {
+    case AnalyzerOutput::kXMLTokens:
+      compileToXML();
+      break;
+    case AnalyzerOutput::kTokensAndTreeXML:
+      compileToTokensAndTreeXML();
+      break;
+    case AnalyzerOutput::kStreamingTreeXML:
+      compileToTreeXMLStreaming();
+      break;
+    case AnalyzerOutput::kOutlineXML:
+      compileToOutlineXML();
+      break;
+    case AnalyzerOutput::kVMCode:
+      compileToVM();
+      break;
+    case AnalyzerOutput::kHackAssembly:
+      compileToHackAssembly();
+      break;
+  }
+}
+
+std::string JackAnalyzer::tokensFilenameFor(const std::string& tree_filename) {
+  constexpr char kExtension[] = ".xml";
+  constexpr std::size_t kExtensionSize = sizeof(kExtension) - 1;
+  if (tree_filename.size() >= kExtensionSize &&
+      tree_filename.compare(tree_filename.size() - kExtensionSize,
+                            kExtensionSize, kExtension) == 0) {
+    return tree_filename.substr(0, tree_filename.size() - kExtensionSize) +
+           "T" + kExtension;
+  }
+  return tree_filename + "T.xml";
+}
+
+void JackAnalyzer::generate(IIRBackend* backend) {
+  auto mapped_file = std::make_shared<const MappedFile>(source_);
+  std::cerr << "Read input file: " + source_ + "\n";
+  const std::string_view source(mapped_file->data(), mapped_file->size());
+  StreamingCompilationEngine compilation_engine(
+      output_filename_,
+      std::make_unique<StreamingTokens>(std::move(mapped_file), source));
+  compilation_engine.generateTo(backend);
+  compilation_engine.compileClass();
+}
+
+void JackAnalyzer::compileClass(
+    ConcreteCompilationEngine* compilation_engine) {
+  if (scheduler_ != nullptr) {
+    compilation_engine->compileClassParallel(scheduler_);
+  } else {
+    compilation_engine->compileClass();
+  }
+}
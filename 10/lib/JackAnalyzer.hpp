@@ -4,23 +4,71 @@
 #ifndef LIB_JACKANALYZER_HPP_
 #define LIB_JACKANALYZER_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 #include "CompilationEngine.hpp"
 #include "JackTokenizer.hpp"
+#include "WorkStealingScheduler.hpp"
+
+enum class AnalyzerOutput : std::uint8_t {
+  // compileToXML().
+  kXMLTokens = 0,
+  // compileToTokensAndTreeXML().
+  kTokensAndTreeXML,
+  // compileToTreeXMLStreaming().
+  kStreamingTreeXML,
+  // compileToOutlineXML().
+  kOutlineXML,
+  // compileToVM().
+  kVMCode,
+  // compileToHackAssembly().
+  kHackAssembly,
+};
 
 class JackAnalyzer {
  public:
+  // With a scheduler, the subroutines of the class are parsed concurrently
+  // on it, except in streaming mode.
   explicit JackAnalyzer(const std::string& source,
-                        const std::string& output_filename);
+                        const std::string& output_filename,
+                        WorkStealingScheduler* scheduler = nullptr);
   ~JackAnalyzer() = default;
 
   void compileToXML();
+  // Writes the parse tree to output_filename and the token listing next to
+  // it, e.g. Main.xml and MainT.xml, from a single parse. The two files are
+  // written concurrently.
+  void compileToTokensAndTreeXML();
+  // Writes the parse tree to output_filename while parsing. Tokens are lexed
+  // on demand and the tree is written one statement or class member at a
+  // time, so memory use does not grow with the length of the source.
+  void compileToTreeXMLStreaming();
+  // Writes the parse tree of the declarations to output_filename: class
+  // variables and subroutine signatures, without subroutine bodies.
+  void compileToOutlineXML();
+  // Writes VM code to output_filename while parsing, in bounded memory like
+  // compileToTreeXMLStreaming(). Never parallel: the code is written in
+  // source order as the parse goes. Expressions are simplified first, see
+  // IRSimplifier.
+  void compileToVM();
+  // Like compileToVM(), but writes Hack assembly that follows the calling
+  // convention of the VM. A program is the concatenation of the
+  // writeHackBootstrap() code and the assembly of its classes and the OS.
+  void compileToHackAssembly();
+  void compile(AnalyzerOutput output);
+
+  static std::string tokensFilenameFor(const std::string& tree_filename);
 
  private:
+  void compileClass(ConcreteCompilationEngine* compilation_engine);
+  // Streams the source through the compilation engine into backend.
+  void generate(IIRBackend* backend);
+
   const std::string source_;
   const std::string output_filename_;
+  WorkStealingScheduler* scheduler_;
 };
 
 #endif  // LIB_JACKANALYZER_HPP_
@@ -0,0 +1,107 @@
+// No copyright.
+// Compiles many Jack sources in one process.
+
+#include "JackBatch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "WorkStealingScheduler.hpp"
+
+namespace fs = std::filesystem;
+
+std::vector<CompileJob> compileJobsFor(const std::vector<std::string>& sources,
+                                       const std::string& output_dir,
+                                       const std::string& extension) {
+  std::vector<fs::path> source_files;
+  for (const auto& source : sources) {
+    if (!fs::is_directory(source)) {
+      source_files.emplace_back(source);
+      continue;
+    }
+    for (const auto& entry : fs::directory_iterator(source)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".jack") {
+        source_files.push_back(entry.path());
+      }
+    }
+  }
+
+  std::vector<CompileJob> jobs;
+  jobs.reserve(source_files.size());
+  for (const auto& source_file : source_files) {
+    auto output_filename = fs::path(output_dir) / source_file.stem();
+    output_filename += extension;
+    jobs.push_back(CompileJob{source_file.string(), output_filename.string()});
+  }
+
+  std::sort(jobs.begin(), jobs.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.output_filename < rhs.output_filename;
+  });
+  const auto duplicate = std::adjacent_find(
+      jobs.begin(), jobs.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.output_filename == rhs.output_filename;
+      });
+  if (duplicate != jobs.end()) {
+    throw std::runtime_error("Sources share the output file " +
+                             duplicate->output_filename);
+  }
+  return jobs;
+}
+
+std::vector<CompileFailure> compileAll(const std::vector<CompileJob>& jobs,
+                                       const AnalyzerOutput output,
+                                       const std::size_t num_threads) {
+  for (const auto& job : jobs) {
+    const auto output_dir = fs::path(job.output_filename).parent_path();
+    if (!output_dir.empty()) {
+      fs::create_directories(output_dir);
+    }
+  }
+
+  // Jobs are spawned smallest first. Workers run their own deque newest
+  // first, so each starts on its largest file, and thieves take the small
+  // ones from the other end to fill the gaps at the end. Each job spawns
+  // its subroutines in turn, so a single large file is shared out too.
+  std::vector<std::pair<std::uintmax_t, std::size_t>> by_size;
+  by_size.reserve(jobs.size());
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    std::error_code error;
+    const auto size = fs::file_size(jobs[i].source, error);
+    by_size.emplace_back(error ? 0 : size, i);
+  }
+  std::sort(by_size.begin(), by_size.end());
+
+  // Each task writes only its own slot.
+  std::vector<std::optional<std::string>> messages(jobs.size());
+  {
+    WorkStealingScheduler scheduler(
+        WorkStealingScheduler::threadCountFor(num_threads));
+    TaskGroup group;
+    for (const auto& [size, i] : by_size) {
+      scheduler.spawn(&group, [&, i = i] {
+        try {
+          JackAnalyzer analyzer(jobs[i].source, jobs[i].output_filename,
+                                &scheduler);
+          analyzer.compile(output);
+        } catch (const std::exception& e) {
+          messages[i] = e.what();
+        }
+      });
+    }
+    scheduler.wait(&group);
+  }
+
+  std::vector<CompileFailure> failures;
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    if (messages[i]) {
+      failures.push_back(CompileFailure{jobs[i].source, *messages[i]});
+    }
+  }
+  return failures;
+}
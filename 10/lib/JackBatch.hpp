@@ -0,0 +1,39 @@
+// No copyright.
+// Compiles many Jack sources in one process.
+
+#ifndef LIB_JACKBATCH_HPP_
+#define LIB_JACKBATCH_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "JackAnalyzer.hpp"
+
+struct CompileJob {
+  std::string source;
+  std::string output_filename;
+};
+
+struct CompileFailure {
+  std::string source;
+  std::string message;
+};
+
+// One job per source, X.jack being written to output_dir/X followed by
+// extension, e.g. X.xml. Directories contribute the .jack files directly
+// inside them. Jobs are sorted by output filename so that runs are
+// reproducible; two sources with the same name are an error.
+std::vector<CompileJob> compileJobsFor(const std::vector<std::string>& sources,
+                                       const std::string& output_dir,
+                                       const std::string& extension = ".xml");
+
+// Compiles every job with its own JackAnalyzer on a WorkStealingScheduler
+// with num_threads workers, 0 meaning one per hardware thread, and creates
+// output directories as needed. A failing job does not stop the others;
+// failures are returned in job order.
+std::vector<CompileFailure> compileAll(const std::vector<CompileJob>& jobs,
+                                       AnalyzerOutput output,
+                                       std::size_t num_threads);
+
+#endif  // LIB_JACKBATCH_HPP_
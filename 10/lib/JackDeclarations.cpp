@@ -3,20 +3,64 @@
 
 #include "JackDeclarations.hpp"
 
-#include <iostream>
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <utility>
 
-void JackDeclarations::addDeclaration(const std::string& new_declaration) {
-  if (isDeclared(new_declaration)) {
-    throw std::runtime_error("Cannot declare twice: " + new_declaration);
+JackDeclarations::JackDeclarations()
+    : slots_(kInitialCapacity, kEmptySlot) {}
+
+void JackDeclarations::addDeclaration(const IdentifierId new_declaration) {
+  if (new_declaration == kEmptySlot) {
+    throw std::runtime_error("Invalid identifier id");
+  }
+  auto slot = slotOf(new_declaration);
+  if (slots_[slot] == new_declaration) {
+    throw std::runtime_error(
+        "Cannot declare twice: " +
+        std::string(identifierPool().text(new_declaration)));
+  }
+  if (2 * (size_ + 1) > slots_.size()) {
+    grow();
+    slot = slotOf(new_declaration);
+  }
+  slots_[slot] = new_declaration;
+  ++size_;
+}
+
+bool JackDeclarations::isDeclared(const IdentifierId name) {
+  return slots_[slotOf(name)] == name;
+}
+
+bool JackDeclarations::isEmpty() { return size_ == 0; }
+
+void JackDeclarations::clear() {
+  if (size_ == 0) {
+    return;
   }
-  declarations_.insert(new_declaration);
+  std::fill(slots_.begin(), slots_.end(), kEmptySlot);
+  size_ = 0;
 }
 
-bool JackDeclarations::isDeclared(const std::string& name) {
-  return declarations_.find(name) != declarations_.end();
+// The slot holding name, or the empty slot where it would go.
+std::size_t JackDeclarations::slotOf(const IdentifierId name) const noexcept {
+  const auto mask = slots_.size() - 1;
+  // Multiplying by an odd constant permutes the slots, so names interned one
+  // after another still get distinct slots, just not adjacent ones.
+  auto slot = static_cast<std::size_t>(name * 0x9e3779b9u) & mask;
+  while (slots_[slot] != name && slots_[slot] != kEmptySlot) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
 }
 
-bool JackDeclarations::isEmpty() { return declarations_.empty(); }
-void JackDeclarations::clear() { declarations_.clear(); }
+void JackDeclarations::grow() {
+  std::vector<IdentifierId> old_slots(2 * slots_.size(), kEmptySlot);
+  std::swap(old_slots, slots_);
+  for (const auto name : old_slots) {
+    if (name != kEmptySlot) {
+      slots_[slotOf(name)] = name;
+    }
+  }
+}
@@ -4,31 +4,45 @@
 #ifndef LIB_JACKDECLARATIONS_HPP_
 #define LIB_JACKDECLARATIONS_HPP_
 
-#include <string>
-#include <unordered_set>
+#include <cstddef>
+#include <vector>
 
+#include "StringInterner.hpp"
+
+// Names are identifierPool() IDs, as returned by ITokens::identifierId().
 class IJackDeclarations {
  public:
   virtual ~IJackDeclarations() = default;
-  virtual void addDeclaration(const std::string& class_variable_name) = 0;
-  virtual bool isDeclared(const std::string& class_variable_name) = 0;
+  virtual void addDeclaration(IdentifierId class_variable_name) = 0;
+  virtual bool isDeclared(IdentifierId class_variable_name) = 0;
   virtual bool isEmpty() = 0;
   virtual void clear() = 0;
 };
 
+// Open addressing set of IDs with linear probing. A scope holds a handful
+// of names, so the slots fit in a cache line or two and a lookup is a
+// multiply and a short scan.
 class JackDeclarations final : public IJackDeclarations {
  public:
-  JackDeclarations() = default;
+  JackDeclarations();
   ~JackDeclarations() = default;
 
-  void addDeclaration(const std::string& class_variable_name);
-  bool isDeclared(const std::string& class_variable_name);
+  void addDeclaration(IdentifierId class_variable_name);
+  bool isDeclared(IdentifierId class_variable_name);
   // TODO(me): remove the below.
   bool isEmpty();
   void clear();
 
  private:
-  std::unordered_set<std::string> declarations_;
+  static constexpr IdentifierId kEmptySlot = ~IdentifierId{0};
+  static constexpr std::size_t kInitialCapacity = 16;
+
+  std::size_t slotOf(IdentifierId name) const noexcept;
+  void grow();
+
+  // Capacity is a power of two and at most half of it is used.
+  std::vector<IdentifierId> slots_;
+  std::size_t size_ = 0;
 };
 
 #endif  // LIB_JACKDECLARATIONS_HPP_
@@ -0,0 +1,174 @@
+// No copyright.
+// Single pass Jack lexer.
+
+#include "JackLexer.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+enum class CharClass : unsigned char {
+  kOther = 0,
+  kWhitespace,
+  kNewline,
+  kSymbol,
+  kSlash,
+  kStar,
+  kDigit,
+  kIdentifier,
+  kQuote,
+};
+
+constexpr std::array<CharClass, 256> makeCharClassTable() {
+  std::array<CharClass, 256> table{};
+  table[' '] = CharClass::kWhitespace;
+  table['\t'] = CharClass::kWhitespace;
+  table['\r'] = CharClass::kWhitespace;
+  table['\n'] = CharClass::kNewline;
+  for (const auto c : "{}()[].,;+-&|<>=~") {
+    if (c != '\0') {
+      table[static_cast<unsigned char>(c)] = CharClass::kSymbol;
+    }
+  }
+  table['/'] = CharClass::kSlash;
+  table['*'] = CharClass::kStar;
+  for (auto c = '0'; c <= '9'; ++c) {
+    table[static_cast<unsigned char>(c)] = CharClass::kDigit;
+  }
+  for (auto c = 'a'; c <= 'z'; ++c) {
+    table[static_cast<unsigned char>(c)] = CharClass::kIdentifier;
+  }
+  for (auto c = 'A'; c <= 'Z'; ++c) {
+    table[static_cast<unsigned char>(c)] = CharClass::kIdentifier;
+  }
+  table['_'] = CharClass::kIdentifier;
+  table['"'] = CharClass::kQuote;
+  return table;
+}
+
+constexpr auto kCharClasses = makeCharClassTable();
+
+inline CharClass classOf(const char c) {
+  return kCharClasses[static_cast<unsigned char>(c)];
+}
+
+// Handles a lexeme starting with '/': a line comment, a block comment or the
+// division symbol. Returns the position just past it, which is current + 1
+// only for the division symbol.
+const char* skipCommentOrSlash(const char* current, const char* end) {
+  const char* next = current + 1;
+  if (next != end && *next == '/') {
+    const auto* newline =
+        static_cast<const char*>(std::memchr(next, '\n', end - next));
+    return newline == nullptr ? end : newline + 1;
+  }
+
+  if (next != end && *next == '*') {
+    // Search from past the opening "/*" so that "/*/" does not close it.
+    const char* search = next + 1;
+    while (search < end) {
+      const auto* star =
+          static_cast<const char*>(std::memchr(search, '*', end - search));
+      if (star == nullptr || star + 1 == end) {
+        break;
+      }
+      if (star[1] == '/') {
+        return star + 2;
+      }
+      search = star + 1;
+    }
+    throw std::runtime_error("Unterminated comment");
+  }
+
+  return next;
+}
+
+}  // namespace
+
+JackLexer::JackLexer(const char* begin, const char* end)
+    : end_(end), current_(begin), classifier_(begin, end) {}
+
+bool JackLexer::next(Lexeme* lexeme) {
+  const auto produce = [lexeme](const TokenType type,
+                                const std::uint16_t subtype,
+                                const char* token_begin,
+                                const char* token_end) {
+    *lexeme = Lexeme{type, subtype, token_begin, token_end};
+    return true;
+  };
+
+  // The first character of each lexeme picks the transition, and the rest of
+  // the lexeme is consumed as a run: whitespace and identifier runs through
+  // the block classifier, strings and comments through memchr.
+  while (current_ != end_) {
+    const char* current = current_;
+    switch (classOf(*current)) {
+      case CharClass::kWhitespace:
+      case CharClass::kNewline:
+        current_ = classifier_.skipWhitespace(current);
+        break;
+      case CharClass::kSymbol:
+      case CharClass::kStar:
+        current_ = current + 1;
+        return produce(TokenType::kSymbol,
+                       static_cast<std::uint16_t>(symbolTypeOf(*current)),
+                       current, current_);
+      case CharClass::kSlash:
+        current_ = skipCommentOrSlash(current, end_);
+        if (current_ == current + 1) {
+          return produce(TokenType::kSymbol,
+                         static_cast<std::uint16_t>(SymbolType::kSlash),
+                         current, current_);
+        }
+        break;
+      case CharClass::kDigit: {
+        const char* token_end = classifier_.skipIdentifierChars(current);
+        // More than 5 digits is out of bound anyway, avoid overflowing.
+        long value = 0;
+        for (const char* digit = current; digit != token_end; ++digit) {
+          if (classOf(*digit) != CharClass::kDigit) {
+            throw std::runtime_error(
+                "Identifier should not start with integer");
+          }
+          if (digit - current < 6) {
+            value = value * 10 + (*digit - '0');
+          }
+        }
+        if (token_end - current > 6 || value > 32768) {
+          throw std::runtime_error("Interger out of bound.");
+        }
+        current_ = token_end;
+        return produce(TokenType::kIntConst,
+                       static_cast<std::uint16_t>(value), current, token_end);
+      }
+      case CharClass::kIdentifier: {
+        const char* token_end = classifier_.skipIdentifierChars(current);
+        current_ = token_end;
+        const auto keyword =
+            keywordTypeOf(std::string_view(current, token_end - current));
+        if (keyword == KeyWordType::kFieldSize) {
+          return produce(TokenType::kIdentifier, 0, current, token_end);
+        }
+        return produce(TokenType::kKeyWord,
+                       static_cast<std::uint16_t>(keyword), current,
+                       token_end);
+      }
+      case CharClass::kQuote: {
+        const auto* closing = static_cast<const char*>(
+            std::memchr(current + 1, '"', end_ - current - 1));
+        if (closing == nullptr ||
+            std::memchr(current + 1, '\n', closing - current - 1) != nullptr) {
+          throw std::runtime_error("Unterminated string constant");
+        }
+        current_ = closing + 1;
+        return produce(TokenType::kStringConst, 0, current, current_);
+      }
+      default:
+        throw std::runtime_error("Invalid character in source");
+    }
+  }
+  return false;
+}
@@ -0,0 +1,39 @@
+// No copyright.
+// Single pass Jack lexer.
+
+#ifndef LIB_JACKLEXER_HPP_
+#define LIB_JACKLEXER_HPP_
+
+#include <cstdint>
+
+#include "CharClassifier.hpp"
+#include "Tokens.hpp"
+
+// A classified token as [begin, end) of the lexed buffer. subtype is
+// interpreted as in TokenTable.
+struct Lexeme {
+  TokenType type = TokenType::kFieldSize;
+  std::uint16_t subtype = 0;
+  const char* begin = nullptr;
+  const char* end = nullptr;
+};
+
+// Walks a buffer once with a character class state machine, producing one
+// token per call so callers decide how many tokens to keep around.
+class JackLexer final {
+ public:
+  JackLexer(const char* begin, const char* end);
+  JackLexer() = delete;
+  ~JackLexer() = default;
+
+  // Stores the next token in lexeme and returns true, or returns false once
+  // the input is exhausted. Throws std::runtime_error on malformed input.
+  bool next(Lexeme* lexeme);
+
+ private:
+  const char* const end_;
+  const char* current_;
+  CharClassifier classifier_;
+};
+
+#endif  // LIB_JACKLEXER_HPP_
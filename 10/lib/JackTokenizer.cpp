@@ -4,25 +4,63 @@
 #include "JackTokenizer.hpp"
 
 #include <algorithm>
+#include <memory>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
 
-JackTokenizer::JackTokenizer(const std::string& input_filename)
-    : input_filename_(input_filename) {}
+#include "CharClassifier.hpp"
+#include "JackLexer.hpp"
+#include "MappedFile.hpp"
+#include "StringInterner.hpp"
 
-Tokens JackTokenizer::parseInputFile() noexcept {
+JackTokenizer::JackTokenizer(const std::string& input_filename,
+                             LexMode lex_mode)
+    : input_filename_(input_filename), lex_mode_(lex_mode) {}
+
+Tokens JackTokenizer::parseInputFile() {
+  if (lex_mode_ == LexMode::kSinglePass) {
+    return getTokensFromMappedFile();
+  }
   return Tokens(getTokensFromCodeLines(getCodeLinesFromFile()));
 }
 
+Tokens JackTokenizer::getTokensFromMappedFile() {
+  auto mapped_file = std::make_shared<const MappedFile>(input_filename_);
+  std::cerr << "Read input file: " + input_filename_ + "\n";
+
+  const std::string_view source(mapped_file->data(), mapped_file->size());
+  auto table = scanTokens(source.data(), source.data() + source.size());
+  return Tokens(std::move(mapped_file), source, std::move(table));
+}
+
+TokenTable JackTokenizer::scanTokens(const char* begin, const char* end) {
+  TokenTable tokens;
+  // The lexer already knows each token's class, so tokens are stored
+  // classified and Tokens never inspects their text again.
+  JackLexer lexer(begin, end);
+  Lexeme lexeme;
+  // Identifiers are interned here so that the parser only compares IDs.
+  InternCache ids(&identifierPool());
+  while (lexer.next(&lexeme)) {
+    const std::string_view text(lexeme.begin, lexeme.end - lexeme.begin);
+    tokens.push(lexeme.type, lexeme.subtype,
+                static_cast<std::uint32_t>(lexeme.begin - begin),
+                static_cast<std::uint32_t>(text.size()),
+                lexeme.type == TokenType::kIdentifier ? ids.intern(text) : 0);
+  }
+
+  return tokens;
+}
+
 std::vector<std::string> JackTokenizer::getCodeLinesFromFile() {
   std::ifstream input_stream(input_filename_);
   if (!input_stream) {
     throw std::runtime_error("Fail to read input file");
   }
-  std::cout << "Read input file: " << input_filename_ << std::endl;
+  std::cerr << "Read input file: " + input_filename_ + "\n";
 
   std::vector<std::string> code_lines;
   std::string line;
@@ -147,17 +185,17 @@ std::vector<std::string> JackTokenizer::separateCodeLineBySpace(
 
 std::vector<std::size_t> JackTokenizer::findSymbolIndices(
     const std::string& line) const noexcept {
+  // One classification per block, symbol bits come out already sorted.
   std::vector<std::size_t> indices;
-  for (const auto& symbol : kSymbols) {
-    auto index = line.find(symbol);
-    while (index != std::string::npos) {
-      indices.emplace_back(static_cast<size_t>(index));
-
-      index = line.find(symbol, index + 1);
+  for (std::size_t block = 0; block < line.size(); block += kCharBlockSize) {
+    auto symbol_mask =
+        classifyBlock(line.data() + block, line.size() - block).symbol;
+    while (symbol_mask != 0) {
+      indices.emplace_back(
+          block + static_cast<std::size_t>(__builtin_ctzll(symbol_mask)));
+      symbol_mask &= symbol_mask - 1;
     }
   }
 
-  std::sort(std::begin(indices), std::end(indices));
-
   return indices;
 }
@@ -10,6 +10,13 @@
 
 #include "lib/Tokens.hpp"
 
+// kLineByLine is the original getline based tokenizer, kSinglePass maps the
+// whole file and walks it once with a character class state machine.
+enum class LexMode {
+  kLineByLine = 0,
+  kSinglePass,
+};
+
 class IJackTokenizer {
  public:
   virtual ~IJackTokenizer() = default;
@@ -18,13 +25,17 @@ class IJackTokenizer {
 
 class JackTokenizer final : public IJackTokenizer {
  public:
-  explicit JackTokenizer(const std::string& input_filename);
+  explicit JackTokenizer(const std::string& input_filename,
+                         LexMode lex_mode = LexMode::kLineByLine);
   JackTokenizer() = delete;
   ~JackTokenizer() = default;
 
-  Tokens parseInputFile() noexcept;
+  Tokens parseInputFile();
 
  private:
+  Tokens getTokensFromMappedFile();
+  TokenTable scanTokens(const char* begin, const char* end);
+
   std::vector<std::string> getCodeLinesFromFile();
   std::vector<std::string> getTokensFromCodeLines(
       std::vector<std::string> code_lines);
@@ -39,6 +50,7 @@ class JackTokenizer final : public IJackTokenizer {
       const std::string& line) const noexcept;
 
   std::string input_filename_;
+  LexMode lex_mode_;
 };
 
 #endif  // LIB_JACKTOKENIZER_HPP_
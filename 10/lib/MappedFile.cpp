@@ -0,0 +1,46 @@
+// No copyright.
+// Read-only memory mapped source file.
+
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+MappedFile::MappedFile(const std::string& filename) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Fail to read input file");
+  }
+
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Fail to stat input file");
+  }
+  size_ = static_cast<std::size_t>(file_stat.st_size);
+
+  // mmap rejects zero length mappings, an empty file is just an empty buffer.
+  if (size_ == 0) {
+    ::close(fd);
+    return;
+  }
+
+  void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Fail to map input file");
+  }
+  ::madvise(mapped, size_, MADV_SEQUENTIAL);
+
+  data_ = static_cast<const char*>(mapped);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
@@ -0,0 +1,26 @@
+// No copyright.
+// Read-only memory mapped source file.
+
+#ifndef LIB_MAPPEDFILE_HPP_
+#define LIB_MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+class MappedFile final {
+ public:
+  explicit MappedFile(const std::string& filename);
+  MappedFile() = delete;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  const char* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+#endif  // LIB_MAPPEDFILE_HPP_
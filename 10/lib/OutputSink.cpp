@@ -0,0 +1,69 @@
+// No copyright.
+// Buffered output file.
+
+#include "OutputSink.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+BufferedFileSink::BufferedFileSink(const std::string& output_filename,
+                                   const std::size_t capacity)
+    : buffer_(new char[capacity]), capacity_(capacity) {
+  if (output_filename == "-") {
+    fd_ = STDOUT_FILENO;
+    return;
+  }
+
+  fd_ = ::open(output_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Fail to open output file");
+  }
+  owns_fd_ = true;
+}
+
+BufferedFileSink::~BufferedFileSink() {
+  try {
+    flush();
+  } catch (const std::runtime_error&) {
+  }
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+}
+
+void BufferedFileSink::append(const std::string_view fragment) {
+  if (size_ + fragment.size() > capacity_) {
+    flush();
+    // Too large to be worth copying, hand it to the kernel directly.
+    if (fragment.size() > capacity_) {
+      writeAll(fragment.data(), fragment.size());
+      return;
+    }
+  }
+  std::memcpy(buffer_.get() + size_, fragment.data(), fragment.size());
+  size_ += fragment.size();
+}
+
+void BufferedFileSink::flush() {
+  const auto size = size_;
+  size_ = 0;
+  writeAll(buffer_.get(), size);
+}
+
+void BufferedFileSink::writeAll(const char* data, std::size_t size) {
+  while (size > 0) {
+    const auto written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Fail to write output file");
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
@@ -0,0 +1,47 @@
+// No copyright.
+// Buffered output file.
+
+#ifndef LIB_OUTPUTSINK_HPP_
+#define LIB_OUTPUTSINK_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class IOutputSink {
+ public:
+  virtual ~IOutputSink() = default;
+  virtual void append(std::string_view fragment) = 0;
+  virtual void flush() = 0;
+};
+
+// Collects fragments in one contiguous buffer and hands it to write(2) when
+// full, so a whole output file usually costs a handful of system calls.
+// The filename "-" writes to stdout, which may be a pipe.
+class BufferedFileSink final : public IOutputSink {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 256 * 1024;
+
+  explicit BufferedFileSink(const std::string& output_filename,
+                            std::size_t capacity = kDefaultCapacity);
+  BufferedFileSink() = delete;
+  BufferedFileSink(const BufferedFileSink&) = delete;
+  BufferedFileSink& operator=(const BufferedFileSink&) = delete;
+  // Flushes what is left, ignoring errors. Call flush() to see them.
+  ~BufferedFileSink();
+
+  void append(std::string_view fragment);
+  void flush();
+
+ private:
+  void writeAll(const char* data, std::size_t size);
+
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  std::unique_ptr<char[]> buffer_;
+  const std::size_t capacity_;
+  std::size_t size_ = 0;
+};
+
+#endif  // LIB_OUTPUTSINK_HPP_
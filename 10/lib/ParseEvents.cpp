@@ -0,0 +1,355 @@
+// No copyright.
+// Compact log of what the compilation engine parsed.
+
+#include "ParseEvents.hpp"
+
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t kNumTerminalTypes =
+    static_cast<std::size_t>(TokenType::kFieldSize);
+
+// Indexed by TokenType.
+constexpr std::array<std::string_view, kNumTerminalTypes> kTerminalTags{
+    "keyword", "symbol", "identifier", "integerConstant", "stringConstant",
+};
+constexpr std::array<std::string_view, kNumTerminalTypes> kOpenTags{
+    "<keyword> ",         "<symbol> ",         "<identifier> ",
+    "<integerConstant> ", "<stringConstant> ",
+};
+constexpr std::array<std::string_view, kNumTerminalTypes> kCloseTags{
+    " </keyword>\n",         " </symbol>\n",         " </identifier>\n",
+    " </integerConstant>\n", " </stringConstant>\n",
+};
+
+std::size_t terminalIndex(const ParseEvent& event) {
+  const auto type = static_cast<std::size_t>(event.tag);
+  if (type >= kNumTerminalTypes) {
+    throw std::runtime_error("Invalid terminal");
+  }
+  return type;
+}
+
+void appendInteger(const std::uint16_t value, IOutputSink* sink) {
+  char digits[8];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  sink->append(std::string_view(digits, result.ptr - digits));
+}
+
+// Like kSymbols, with the characters XML reserves escaped.
+constexpr std::array<std::string_view, kSymbols.size()> makeEscapedSymbols() {
+  auto escaped = kSymbols;
+  escaped[static_cast<std::size_t>(SymbolType::kLessThan)] = "&lt;";
+  escaped[static_cast<std::size_t>(SymbolType::kGreaterThan)] = "&gt;";
+  escaped[static_cast<std::size_t>(SymbolType::kAmpersand)] = "&amp;";
+  return escaped;
+}
+
+constexpr auto kEscapedSymbols = makeEscapedSymbols();
+
+void appendXMLText(const std::string_view text, IOutputSink* sink) {
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    std::string_view entity;
+    switch (text[i]) {
+      case '<':
+        entity = "&lt;";
+        break;
+      case '>':
+        entity = "&gt;";
+        break;
+      case '&':
+        entity = "&amp;";
+        break;
+      case '"':
+        entity = "&quot;";
+        break;
+      default:
+        continue;
+    }
+    sink->append(text.substr(begin, i - begin));
+    sink->append(entity);
+    begin = i + 1;
+  }
+  sink->append(text.substr(begin));
+}
+
+void appendEscapedTerminal(const ParseEventLog& log, const ParseEvent& event,
+                           IOutputSink* sink) {
+  const auto type = terminalIndex(event);
+  sink->append(kOpenTags[type]);
+  switch (event.tokenType()) {
+    case TokenType::kIntConst:
+      appendInteger(event.subtype, sink);
+      break;
+    case TokenType::kSymbol:
+      sink->append(kEscapedSymbols[event.subtype]);
+      break;
+    case TokenType::kKeyWord:
+      sink->append(log.text(event));
+      break;
+    default:
+      appendXMLText(log.text(event), sink);
+      break;
+  }
+  sink->append(kCloseTags[type]);
+}
+
+void appendIndent(const std::size_t depth, IOutputSink* sink) {
+  static constexpr std::string_view kSpaces =
+      "                                                                ";
+  auto remaining = 2 * depth;
+  while (remaining > 0) {
+    const auto chunk = remaining < kSpaces.size() ? remaining : kSpaces.size();
+    sink->append(kSpaces.substr(0, chunk));
+    remaining -= chunk;
+  }
+}
+
+void appendJSONString(const std::string_view text, IOutputSink* sink) {
+  sink->append("\"");
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (c != '"' && c != '\\' && c >= 0x20) {
+      continue;
+    }
+    sink->append(text.substr(begin, i - begin));
+    if (c == '"' || c == '\\') {
+      const char escaped[] = {'\\', static_cast<char>(c)};
+      sink->append(std::string_view(escaped, sizeof(escaped)));
+    } else {
+      constexpr char kHex[] = "0123456789abcdef";
+      const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+      sink->append(std::string_view(escaped, sizeof(escaped)));
+    }
+    begin = i + 1;
+  }
+  sink->append(text.substr(begin));
+  sink->append("\"");
+}
+
+}  // namespace
+
+void ParseEventLog::beginNode(const NodeKind kind) {
+  events_.push_back(ParseEvent{ParseEventKind::kBeginNode,
+                               static_cast<std::uint8_t>(kind), 0, 0});
+}
+
+void ParseEventLog::endNode(const NodeKind kind) {
+  events_.push_back(ParseEvent{ParseEventKind::kEndNode,
+                               static_cast<std::uint8_t>(kind), 0, 0});
+}
+
+void ParseEventLog::addKeyword(const KeyWordType keyword) {
+  addTerminal(TokenType::kKeyWord, static_cast<std::uint16_t>(keyword));
+}
+
+void ParseEventLog::addSymbol(const SymbolType symbol_type) {
+  addTerminal(TokenType::kSymbol, static_cast<std::uint16_t>(symbol_type));
+}
+
+void ParseEventLog::addIdentifier(const std::string_view identifier) {
+  addTerminal(TokenType::kIdentifier, 0,
+              static_cast<std::uint32_t>(texts_.size()));
+  texts_.push_back(identifier);
+}
+
+void ParseEventLog::addIntegerConstant(const int value) {
+  addTerminal(TokenType::kIntConst, static_cast<std::uint16_t>(value));
+}
+
+void ParseEventLog::addStringConstant(const std::string_view value) {
+  addTerminal(TokenType::kStringConst, 0,
+              static_cast<std::uint32_t>(texts_.size()));
+  texts_.push_back(value);
+}
+
+std::string_view ParseEventLog::text(const ParseEvent& event) const noexcept {
+  switch (event.tokenType()) {
+    case TokenType::kKeyWord:
+      return kKeywordNames[event.subtype];
+    case TokenType::kSymbol:
+      return kSymbols[event.subtype];
+    case TokenType::kIdentifier:
+    case TokenType::kStringConst:
+      return texts_[event.text_index];
+    default:
+      return {};
+  }
+}
+
+void ParseEventLog::append(const ParseEventLog& other) {
+  const auto text_offset = static_cast<std::uint32_t>(texts_.size());
+  for (auto event : other.events_) {
+    if (event.kind == ParseEventKind::kTerminal &&
+        (event.tokenType() == TokenType::kIdentifier ||
+         event.tokenType() == TokenType::kStringConst)) {
+      event.text_index += text_offset;
+    }
+    events_.push_back(event);
+  }
+  texts_.insert(texts_.end(), other.texts_.begin(), other.texts_.end());
+}
+
+void ParseEventLog::clear() noexcept {
+  events_.clear();
+  texts_.clear();
+}
+
+void ParseEventLog::addTerminal(const TokenType token_type,
+                                const std::uint16_t subtype,
+                                const std::uint32_t text_index) {
+  events_.push_back(ParseEvent{ParseEventKind::kTerminal,
+                               static_cast<std::uint8_t>(token_type), subtype,
+                               text_index});
+}
+
+XMLRenderer::XMLRenderer(const XMLFormat format, IOutputSink* sink)
+    : format_(format), sink_(sink) {}
+
+void XMLRenderer::render(const ParseEventLog& log) {
+  start();
+  for (const auto& event : log.events()) {
+    switch (event.kind) {
+      case ParseEventKind::kBeginNode:
+        if (format_ == XMLFormat::kTree) {
+          appendIndent(depth_, sink_);
+          sink_->append("<");
+          sink_->append(kNodeKindNames[event.tag]);
+          sink_->append(">\n");
+          ++depth_;
+        }
+        break;
+      case ParseEventKind::kEndNode:
+        if (format_ == XMLFormat::kTree) {
+          --depth_;
+          appendIndent(depth_, sink_);
+          sink_->append("</");
+          sink_->append(kNodeKindNames[event.tag]);
+          sink_->append(">\n");
+        }
+        break;
+      case ParseEventKind::kTerminal:
+        renderTerminal(log, event);
+        break;
+    }
+  }
+}
+
+void XMLRenderer::finish() {
+  start();
+  if (format_ == XMLFormat::kTokens) {
+    sink_->append("</tokens>\n");
+  }
+}
+
+void XMLRenderer::start() {
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  if (format_ == XMLFormat::kTokens) {
+    sink_->append("<tokens>\n");
+  }
+}
+
+void XMLRenderer::renderTerminal(const ParseEventLog& log,
+                                 const ParseEvent& event) {
+  if (format_ == XMLFormat::kTree) {
+    appendIndent(depth_, sink_);
+  }
+  if (format_ != XMLFormat::kTerminals) {
+    appendEscapedTerminal(log, event, sink_);
+    return;
+  }
+
+  const auto type = terminalIndex(event);
+  sink_->append(kOpenTags[type]);
+  if (event.tokenType() == TokenType::kIntConst) {
+    appendInteger(event.subtype, sink_);
+  } else {
+    sink_->append(log.text(event));
+  }
+  sink_->append(kCloseTags[type]);
+}
+
+void writeXMLTokens(const ParseEventLog& log, IOutputSink* sink) {
+  XMLRenderer renderer(XMLFormat::kTerminals, sink);
+  renderer.render(log);
+  renderer.finish();
+}
+
+void writeTokensXML(const ParseEventLog& log, IOutputSink* sink) {
+  XMLRenderer renderer(XMLFormat::kTokens, sink);
+  renderer.render(log);
+  renderer.finish();
+}
+
+void writeTreeXML(const ParseEventLog& log, IOutputSink* sink) {
+  XMLRenderer renderer(XMLFormat::kTree, sink);
+  renderer.render(log);
+  renderer.finish();
+}
+
+void writeJSON(const ParseEventLog& log, IOutputSink* sink) {
+  sink->append("{\"kind\":\"fragment\",\"children\":[");
+  // Whether the innermost open array still has no element.
+  std::vector<bool> first_child{true};
+  const auto separate = [&] {
+    if (!first_child.back()) {
+      sink->append(",");
+    }
+    first_child.back() = false;
+  };
+
+  for (const auto& event : log.events()) {
+    switch (event.kind) {
+      case ParseEventKind::kBeginNode:
+        separate();
+        sink->append("{\"kind\":\"");
+        sink->append(kNodeKindNames[event.tag]);
+        sink->append("\",\"children\":[");
+        first_child.push_back(true);
+        break;
+      case ParseEventKind::kEndNode:
+        sink->append("]}");
+        first_child.pop_back();
+        break;
+      case ParseEventKind::kTerminal:
+        separate();
+        sink->append("{\"");
+        sink->append(kTerminalTags[terminalIndex(event)]);
+        sink->append("\":");
+        if (event.tokenType() == TokenType::kIntConst) {
+          appendInteger(event.subtype, sink);
+        } else {
+          appendJSONString(log.text(event), sink);
+        }
+        sink->append("}");
+        break;
+    }
+  }
+  sink->append("]}\n");
+}
+
+const SyntaxNode& buildSyntaxTree(const ParseEventLog& log, Arena* arena) {
+  SyntaxTreeBuilder builder(arena);
+  for (const auto& event : log.events()) {
+    switch (event.kind) {
+      case ParseEventKind::kBeginNode:
+        builder.beginNode(event.nodeKind());
+        break;
+      case ParseEventKind::kEndNode:
+        builder.endNode();
+        break;
+      case ParseEventKind::kTerminal:
+        builder.addTerminal(event.tokenType(), event.subtype, log.text(event));
+        break;
+    }
+  }
+  return builder.root();
+}
@@ -0,0 +1,131 @@
+// No copyright.
+// Compact log of what the compilation engine parsed.
+
+#ifndef LIB_PARSEEVENTS_HPP_
+#define LIB_PARSEEVENTS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Arena.hpp"
+#include "OutputSink.hpp"
+#include "SyntaxTree.hpp"
+#include "Tokens.hpp"
+
+enum class ParseEventKind : std::uint8_t {
+  kBeginNode = 0,
+  kEndNode,
+  kTerminal,
+};
+
+// tag is the NodeKind of kBeginNode and kEndNode events and the TokenType of
+// terminals. subtype is interpreted as in TokenTable. text_index points into
+// ParseEventLog's text pool for identifiers and string constants.
+struct ParseEvent {
+  ParseEventKind kind;
+  std::uint8_t tag;
+  std::uint16_t subtype;
+  std::uint32_t text_index;
+
+  NodeKind nodeKind() const noexcept { return static_cast<NodeKind>(tag); }
+  TokenType tokenType() const noexcept { return static_cast<TokenType>(tag); }
+};
+static_assert(sizeof(ParseEvent) == 8, "ParseEvent should stay 8 bytes");
+
+// Records the parse as a flat sequence of events. Keywords, symbols and
+// integers need no text of their own; identifiers and string constants keep
+// a view of the token source, which must outlive the log.
+class ParseEventLog final {
+ public:
+  ParseEventLog() = default;
+  ~ParseEventLog() = default;
+
+  void beginNode(NodeKind kind);
+  void endNode(NodeKind kind);
+  void addKeyword(KeyWordType keyword);
+  void addSymbol(SymbolType symbol_type);
+  void addIdentifier(std::string_view identifier);
+  void addIntegerConstant(int value);
+  void addStringConstant(std::string_view value);
+
+  // Text shown in the output for a terminal, empty for integer constants.
+  std::string_view text(const ParseEvent& event) const noexcept;
+
+  const std::vector<ParseEvent>& events() const noexcept { return events_; }
+  // Appends the events of other as if they had been recorded here.
+  void append(const ParseEventLog& other);
+  void clear() noexcept;
+
+ private:
+  void addTerminal(TokenType token_type, std::uint16_t subtype,
+                   std::uint32_t text_index = 0);
+
+  std::vector<ParseEvent> events_;
+  std::vector<std::string_view> texts_;
+};
+
+// Keeps a nonterminal open for the lifetime of the scope.
+class ParseEventScope final {
+ public:
+  ParseEventScope(ParseEventLog* log, NodeKind kind) : log_(log), kind_(kind) {
+    log_->beginNode(kind_);
+  }
+  ParseEventScope(const ParseEventScope&) = delete;
+  ParseEventScope& operator=(const ParseEventScope&) = delete;
+  ~ParseEventScope() { log_->endNode(kind_); }
+
+ private:
+  ParseEventLog* log_;
+  const NodeKind kind_;
+};
+
+// Renderers. Nothing is formatted until one of these runs.
+
+enum class XMLFormat : std::uint8_t {
+  // One "<tag> value </tag>" line per terminal, unescaped.
+  kTerminals = 0,
+  // Escaped terminal lines inside a <tokens> element.
+  kTokens,
+  // Nonterminal elements indented by two spaces per level.
+  kTree,
+};
+
+// Renders a log that arrives in pieces: render() may be called on successive
+// contents of a log cleared in between, and finish() closes the document.
+// Output is the same as rendering the concatenated log at once.
+class XMLRenderer final {
+ public:
+  XMLRenderer(XMLFormat format, IOutputSink* sink);
+  XMLRenderer() = delete;
+  ~XMLRenderer() = default;
+
+  void render(const ParseEventLog& log);
+  void finish();
+
+ private:
+  void start();
+  void renderTerminal(const ParseEventLog& log, const ParseEvent& event);
+
+  const XMLFormat format_;
+  IOutputSink* sink_;
+  std::size_t depth_ = 0;
+  bool started_ = false;
+};
+
+// One "<tag> value </tag>" line per terminal, in source order.
+void writeXMLTokens(const ParseEventLog& log, IOutputSink* sink);
+// The reference token listing: terminal lines escaped for XML inside a
+// <tokens> element.
+void writeTokensXML(const ParseEventLog& log, IOutputSink* sink);
+// The reference parse tree: nonterminal elements indented by two spaces per
+// level, with the same escaped terminal lines.
+void writeTreeXML(const ParseEventLog& log, IOutputSink* sink);
+// A single JSON document, nonterminals as {"kind": ..., "children": [...]}
+// and terminals as {"<token type>": "<text>"}.
+void writeJSON(const ParseEventLog& log, IOutputSink* sink);
+// Builds a tree under a NodeKind::kFragment root, allocated from arena.
+const SyntaxNode& buildSyntaxTree(const ParseEventLog& log, Arena* arena);
+
+#endif  // LIB_PARSEEVENTS_HPP_
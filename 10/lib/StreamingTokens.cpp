@@ -0,0 +1,27 @@
+// No copyright.
+// Jack tokens lexed on demand.
+
+#include "StreamingTokens.hpp"
+
+#include <utility>
+
+StreamingTokens::StreamingTokens(std::shared_ptr<const void> source_owner,
+                                 std::string_view source)
+    : source_owner_(std::move(source_owner)),
+      lexer_(source.data(), source.data() + source.size()),
+      ids_cache_(&identifierPool()) {
+  refill();
+}
+
+void StreamingTokens::refill() {
+  Lexeme lexeme;
+  while (count_ < kRingSize && lexer_.next(&lexeme)) {
+    const auto slot = (head_ + count_) & (kRingSize - 1);
+    const std::string_view text(lexeme.begin, lexeme.end - lexeme.begin);
+    ring_[slot] = Token{lexeme.type, lexeme.subtype, text};
+    ids_[slot] = lexeme.type == TokenType::kIdentifier
+                     ? ids_cache_.intern(text)
+                     : 0;
+    ++count_;
+  }
+}
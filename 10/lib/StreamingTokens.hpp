@@ -0,0 +1,144 @@
+// No copyright.
+// Jack tokens lexed on demand.
+
+#ifndef LIB_STREAMINGTOKENS_HPP_
+#define LIB_STREAMINGTOKENS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#include "JackLexer.hpp"
+#include "Tokens.hpp"
+
+// Same accessors as Tokens, but tokens are lexed only when the cursor gets
+// close to them. A ring buffer holds the current token and up to
+// kMaxLookahead tokens after it, so memory does not grow with the source.
+class StreamingTokens final : public ITokens {
+ public:
+  static constexpr std::size_t kMaxLookahead = 3;
+
+  // source_owner keeps the memory behind source alive.
+  StreamingTokens(std::shared_ptr<const void> source_owner,
+                  std::string_view source);
+  StreamingTokens() = delete;
+  ~StreamingTokens() = default;
+
+  bool hasMoreTokens() const;
+  void advance();
+  TokenType tokenType() const;
+  KeyWordType keyWord() const;
+  std::string_view symbol() const;
+  SymbolType symbolType() const;
+  int intVal() const;
+  std::string_view stringVal() const;
+  std::string_view identifier() const;
+  IdentifierId identifierId() const;
+
+  // n must not exceed kMaxLookahead.
+  Token peek(std::size_t n) const noexcept;
+
+ private:
+  static constexpr std::size_t kRingSize = kMaxLookahead + 1;
+  static_assert((kRingSize & (kRingSize - 1)) == 0,
+                "kRingSize should be a power of two");
+
+  const Token& current() const;
+  void refill();
+
+  std::shared_ptr<const void> source_owner_;
+  JackLexer lexer_;
+  // Grows with the number of distinct names, not with the source.
+  InternCache ids_cache_;
+  std::array<Token, kRingSize> ring_;
+  // identifierPool() IDs, parallel to ring_.
+  std::array<IdentifierId, kRingSize> ids_{};
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
+};
+
+inline bool StreamingTokens::hasMoreTokens() const { return count_ > 1; }
+
+inline void StreamingTokens::advance() {
+  if (!hasMoreTokens()) {
+    throw std::runtime_error("No more tokens exists.");
+  }
+  head_ = (head_ + 1) & (kRingSize - 1);
+  --count_;
+  refill();
+}
+
+inline TokenType StreamingTokens::tokenType() const { return current().type; }
+
+inline KeyWordType StreamingTokens::keyWord() const {
+  const auto& token = current();
+  if (token.type != TokenType::kKeyWord) {
+    tokens_internal::throwUnexpectedType(TokenType::kKeyWord);
+  }
+  return static_cast<KeyWordType>(token.subtype);
+}
+
+inline std::string_view StreamingTokens::symbol() const {
+  const auto& token = current();
+  if (token.type != TokenType::kSymbol) {
+    tokens_internal::throwUnexpectedType(TokenType::kSymbol);
+  }
+  return token.text;
+}
+
+inline SymbolType StreamingTokens::symbolType() const {
+  const auto& token = current();
+  if (token.type != TokenType::kSymbol) {
+    tokens_internal::throwUnexpectedType(TokenType::kSymbol);
+  }
+  return static_cast<SymbolType>(token.subtype);
+}
+
+inline int StreamingTokens::intVal() const {
+  const auto& token = current();
+  if (token.type != TokenType::kIntConst) {
+    tokens_internal::throwUnexpectedType(TokenType::kIntConst);
+  }
+  return token.subtype;
+}
+
+inline std::string_view StreamingTokens::stringVal() const {
+  const auto& token = current();
+  if (token.type != TokenType::kStringConst) {
+    tokens_internal::throwUnexpectedType(TokenType::kStringConst);
+  }
+  return token.text.substr(1, token.text.size() - 2);
+}
+
+inline std::string_view StreamingTokens::identifier() const {
+  const auto& token = current();
+  if (token.type != TokenType::kIdentifier) {
+    tokens_internal::throwUnexpectedType(TokenType::kIdentifier);
+  }
+  return token.text;
+}
+
+inline IdentifierId StreamingTokens::identifierId() const {
+  if (current().type != TokenType::kIdentifier) {
+    tokens_internal::throwUnexpectedType(TokenType::kIdentifier);
+  }
+  return ids_[head_];
+}
+
+inline Token StreamingTokens::peek(const std::size_t n) const noexcept {
+  if (n >= count_) {
+    return Token{};
+  }
+  return ring_[(head_ + n) & (kRingSize - 1)];
+}
+
+inline const Token& StreamingTokens::current() const {
+  if (count_ == 0) {
+    throw std::runtime_error("No more tokens exists.");
+  }
+  return ring_[head_];
+}
+
+#endif  // LIB_STREAMINGTOKENS_HPP_
@@ -0,0 +1,80 @@
+// No copyright.
+// Dense integer IDs for identifier names.
+
+#include "StringInterner.hpp"
+
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+IdentifierId StringInterner::intern(const std::string_view text) {
+  const auto hash = std::hash<std::string_view>{}(text);
+  auto& shard = shards_[hash % kNumShards];
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  const auto found = shard.ids.find(text);
+  if (found != shard.ids.end()) {
+    return found->second;
+  }
+
+  auto* copy = static_cast<char*>(shard.texts.allocate(text.size(), 1));
+  std::memcpy(copy, text.data(), text.size());
+  const std::string_view stored(copy, text.size());
+
+  IdentifierId id;
+  {
+    std::lock_guard<std::mutex> texts_lock(texts_mutex_);
+    if (texts_.size() > std::numeric_limits<IdentifierId>::max()) {
+      throw std::runtime_error("Too many identifiers");
+    }
+    id = static_cast<IdentifierId>(texts_.size());
+    texts_.push_back(stored);
+  }
+  shard.ids.emplace(stored, id);
+  return id;
+}
+
+std::string_view StringInterner::text(const IdentifierId id) const {
+  std::lock_guard<std::mutex> lock(texts_mutex_);
+  if (id >= texts_.size()) {
+    throw std::runtime_error("Unknown identifier id");
+  }
+  return texts_[id];
+}
+
+std::size_t StringInterner::size() const {
+  std::lock_guard<std::mutex> lock(texts_mutex_);
+  return texts_.size();
+}
+
+InternCache::InternCache(StringInterner* interner)
+    : interner_(interner), slots_(256) {}
+
+// Out of line, the first sight of a name is the rare case.
+IdentifierId InternCache::insert(const std::size_t slot,
+                                 const std::string_view text) {
+  const auto id = interner_->intern(text);
+  slots_[slot] = Slot{text.data(), static_cast<std::uint32_t>(text.size()), id};
+  if (2 * ++size_ > slots_.size()) {
+    std::vector<Slot> old_slots(2 * slots_.size());
+    std::swap(old_slots, slots_);
+    const auto mask = slots_.size() - 1;
+    for (const auto& entry : old_slots) {
+      if (entry.data == nullptr) {
+        continue;
+      }
+      auto index = hashOf(std::string_view(entry.data, entry.size)) & mask;
+      while (slots_[index].data != nullptr) {
+        index = (index + 1) & mask;
+      }
+      slots_[index] = entry;
+    }
+  }
+  return id;
+}
+
+StringInterner& identifierPool() {
+  static StringInterner pool;
+  return pool;
+}
@@ -0,0 +1,113 @@
+// No copyright.
+// Dense integer IDs for identifier names.
+
+#ifndef LIB_STRINGINTERNER_HPP_
+#define LIB_STRINGINTERNER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Arena.hpp"
+
+// IDs are handed out in order 0, 1, 2, ... so tables indexed by them stay
+// small.
+using IdentifierId = std::uint32_t;
+
+// Maps each distinct string to an IdentifierId that never changes for the
+// lifetime of the interner. Texts are copied in, so callers need not keep
+// theirs alive. Safe to use from several threads: lookups lock one of
+// kNumShards shards picked by hash, so threads tokenizing different files
+// rarely wait on each other.
+class StringInterner final {
+ public:
+  StringInterner() = default;
+  StringInterner(const StringInterner&) = delete;
+  StringInterner& operator=(const StringInterner&) = delete;
+  ~StringInterner() = default;
+
+  IdentifierId intern(std::string_view text);
+  // id must have been returned by intern().
+  std::string_view text(IdentifierId id) const;
+  std::size_t size() const;
+
+ private:
+  static constexpr std::size_t kNumShards = 16;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string_view, IdentifierId> ids;
+    // Owns the texts the keys of ids point to.
+    Arena texts{4 * 1024};
+  };
+
+  std::array<Shard, kNumShards> shards_;
+  // Indexed by IdentifierId. Locked after a shard, never before.
+  mutable std::mutex texts_mutex_;
+  std::vector<std::string_view> texts_;
+};
+
+// Remembers the IDs an interner gave out so that a tokenizer asks it, and
+// takes its lock, only once per distinct name. Keys are views of the
+// caller's text, which must outlive the cache. Not thread safe, meant to
+// live on one thread for the duration of one file.
+class InternCache final {
+ public:
+  explicit InternCache(StringInterner* interner);
+  InternCache() = delete;
+  ~InternCache() = default;
+
+  IdentifierId intern(std::string_view text);
+
+ private:
+  struct Slot {
+    const char* data = nullptr;
+    std::uint32_t size = 0;
+    IdentifierId id = 0;
+  };
+
+  static std::uint32_t hashOf(std::string_view text) noexcept;
+  IdentifierId insert(std::size_t slot, std::string_view text);
+
+  StringInterner* interner_;
+  // Open addressing with linear probing. Capacity is a power of two and at
+  // most half of it is used.
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+};
+
+// The interner shared by every token source and declaration table in the
+// process, so IDs from different files and threads can be compared.
+StringInterner& identifierPool();
+
+// Identifiers are short, so FNV-1a over the bytes beats anything that needs
+// setup.
+inline std::uint32_t InternCache::hashOf(
+    const std::string_view text) noexcept {
+  std::uint32_t hash = 2166136261u;
+  for (const auto c : text) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+inline IdentifierId InternCache::intern(const std::string_view text) {
+  const auto mask = slots_.size() - 1;
+  auto slot = hashOf(text) & mask;
+  while (slots_[slot].data != nullptr) {
+    const auto& entry = slots_[slot];
+    if (entry.size == text.size() &&
+        std::memcmp(entry.data, text.data(), text.size()) == 0) {
+      return entry.id;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return insert(slot, text);
+}
+
+#endif  // LIB_STRINGINTERNER_HPP_
@@ -0,0 +1,138 @@
+// No copyright.
+// Bracket structure of a token table.
+
+#include "StructuralIndex.hpp"
+
+#include <cstring>
+
+namespace {
+
+static_assert(static_cast<int>(SymbolType::kLeftCurlyBracket) == 0 &&
+                  static_cast<int>(SymbolType::kRightCurlyBracket) == 1 &&
+                  static_cast<int>(SymbolType::kLeftParenthesis) == 2 &&
+                  static_cast<int>(SymbolType::kRightParenthesis) == 3 &&
+                  static_cast<int>(SymbolType::kLeftSquareBracket) == 4 &&
+                  static_cast<int>(SymbolType::kRightSquareBracket) == 5,
+              "Brackets should be the first SymbolTypes, each opening one "
+              "followed by its closing one");
+
+// A token's bracket code is its SymbolType plus one for brackets and zero
+// for everything else. Opening brackets get odd codes, and an opening
+// bracket's code plus one is that of its closing bracket.
+constexpr std::uint16_t kNumBracketTypes = 6;
+constexpr std::uint8_t kLeftCurlyCode = 1;
+constexpr std::uint8_t kRightCurlyCode = 2;
+
+bool isOpening(const std::uint8_t code) { return (code & 1) != 0; }
+
+// Branch free so that the compiler vectorizes it.
+std::vector<std::uint8_t> bracketCodes(const TokenTable& table) {
+  const auto size = table.size();
+  std::vector<std::uint8_t> codes(size);
+  const auto* types = table.types.data();
+  const auto* subtypes = table.subtypes.data();
+  auto* out = codes.data();
+  for (std::size_t i = 0; i < size; ++i) {
+    const bool is_bracket = (types[i] == TokenType::kSymbol) &
+                            (subtypes[i] < kNumBracketTypes);
+    out[i] = static_cast<std::uint8_t>(is_bracket * (subtypes[i] + 1));
+  }
+  return codes;
+}
+
+// Index of the first nonzero code at or after begin, skipping eight codes at
+// a time since most tokens are no brackets.
+std::size_t nextBracket(const std::vector<std::uint8_t>& codes,
+                        std::size_t begin) {
+  const auto size = codes.size();
+  while (begin + 8 <= size) {
+    std::uint64_t word;
+    std::memcpy(&word, codes.data() + begin, sizeof(word));
+    if (word != 0) {
+      break;
+    }
+    begin += 8;
+  }
+  while (begin < size && codes[begin] == 0) {
+    ++begin;
+  }
+  return begin;
+}
+
+bool isSubroutineKeyword(const TokenTable& table, const std::size_t index) {
+  if (table.types[index] != TokenType::kKeyWord) {
+    return false;
+  }
+  const auto keyword = static_cast<KeyWordType>(table.subtypes[index]);
+  return keyword == KeyWordType::kConstructor ||
+         keyword == KeyWordType::kFunction || keyword == KeyWordType::kMethod;
+}
+
+}  // namespace
+
+StructuralIndex::StructuralIndex(const TokenTable& table)
+    : matches_(table.size(), kUnmatched) {
+  const auto codes = bracketCodes(table);
+  matchBrackets(codes);
+  findSubroutineSpans(table, codes);
+}
+
+std::size_t StructuralIndex::matching(const std::size_t index) const noexcept {
+  if (index >= matches_.size() || matches_[index] == kUnmatched) {
+    return kNoMatch;
+  }
+  return matches_[index];
+}
+
+void StructuralIndex::matchBrackets(const std::vector<std::uint8_t>& codes) {
+  std::vector<std::uint32_t> open_brackets;
+  for (auto i = nextBracket(codes, 0); i < codes.size();
+       i = nextBracket(codes, i + 1)) {
+    if (isOpening(codes[i])) {
+      open_brackets.push_back(static_cast<std::uint32_t>(i));
+      continue;
+    }
+    // A closing bracket of another kind than the innermost open one stays
+    // unmatched, and so does that open one.
+    if (open_brackets.empty() ||
+        codes[open_brackets.back()] + 1 != codes[i]) {
+      continue;
+    }
+    matches_[i] = open_brackets.back();
+    matches_[open_brackets.back()] = static_cast<std::uint32_t>(i);
+    open_brackets.pop_back();
+  }
+}
+
+void StructuralIndex::findSubroutineSpans(
+    const TokenTable& table, const std::vector<std::uint8_t>& codes) {
+  // A '{' one level inside the class body can only open a subroutine body,
+  // whose subroutine keyword is the last one before it: parameter lists
+  // hold no keywords of that kind.
+  std::size_t depth = 0;
+  std::size_t previous_end = 0;
+  for (auto i = nextBracket(codes, 0); i < codes.size();
+       i = nextBracket(codes, i + 1)) {
+    if (codes[i] == kRightCurlyCode) {
+      depth -= depth > 0 ? 1 : 0;
+      continue;
+    }
+    if (codes[i] != kLeftCurlyCode) {
+      continue;
+    }
+    ++depth;
+    if (depth != 2 || matches_[i] == kUnmatched) {
+      continue;
+    }
+
+    auto keyword = i;
+    while (keyword > previous_end && !isSubroutineKeyword(table, keyword)) {
+      --keyword;
+    }
+    if (!isSubroutineKeyword(table, keyword)) {
+      continue;
+    }
+    previous_end = matches_[i] + 1;
+    subroutine_spans_.push_back(TokenSpan{keyword, previous_end});
+  }
+}
@@ -0,0 +1,60 @@
+// No copyright.
+// Bracket structure of a token table.
+
+#ifndef LIB_STRUCTURALINDEX_HPP_
+#define LIB_STRUCTURALINDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Tokens.hpp"
+
+// Tokens [begin, end) of a TokenTable.
+struct TokenSpan {
+  std::size_t begin;
+  std::size_t end;
+
+  std::size_t size() const noexcept { return end - begin; }
+};
+
+// Matches every bracket of a TokenTable in one linear pass, without parsing,
+// so that callers can skip a block or split the table into subroutines
+// before the compilation engine runs. Brackets that do not balance are left
+// unmatched rather than rejected; the engine reports them when it gets
+// there.
+class StructuralIndex final {
+ public:
+  static constexpr std::size_t kNoMatch =
+      std::numeric_limits<std::size_t>::max();
+
+  explicit StructuralIndex(const TokenTable& table);
+  StructuralIndex() = delete;
+  ~StructuralIndex() = default;
+
+  // Index of the bracket matching the one at index, in either direction, or
+  // kNoMatch when the token is no bracket or is unbalanced.
+  std::size_t matching(std::size_t index) const noexcept;
+
+  // subroutineDecs of the class body, in source order: from the subroutine
+  // keyword up to and including the '}' closing its body. Subroutines whose
+  // body does not balance are left out.
+  const std::vector<TokenSpan>& subroutineSpans() const noexcept {
+    return subroutine_spans_;
+  }
+
+ private:
+  static constexpr std::uint32_t kUnmatched =
+      std::numeric_limits<std::uint32_t>::max();
+
+  void matchBrackets(const std::vector<std::uint8_t>& codes);
+  void findSubroutineSpans(const TokenTable& table,
+                           const std::vector<std::uint8_t>& codes);
+
+  // Indexed by token, kUnmatched for everything but matched brackets.
+  std::vector<std::uint32_t> matches_;
+  std::vector<TokenSpan> subroutine_spans_;
+};
+
+#endif  // LIB_STRUCTURALINDEX_HPP_
@@ -0,0 +1,67 @@
+// No copyright.
+// Scoped table of the variables a class and its subroutines declare.
+
+#include "SymbolTable.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+void SymbolTable::pushScope() {
+  marks_.push_back(Mark{symbols_.size(), counts_});
+}
+
+void SymbolTable::popScope() {
+  if (marks_.empty()) {
+    throw std::runtime_error("No scope to pop");
+  }
+  const auto& mark = marks_.back();
+  names_.resize(mark.size);
+  symbols_.resize(mark.size);
+  counts_ = mark.counts;
+  marks_.pop_back();
+}
+
+const Symbol& SymbolTable::define(const IdentifierId name,
+                                  const IdentifierId type,
+                                  const SymbolKind kind) {
+  if (kind == SymbolKind::kFieldSize) {
+    throw std::runtime_error("Invalid symbol kind");
+  }
+  const auto scope_begin = marks_.empty() ? 0 : marks_.back().size;
+  for (auto i = scope_begin; i < names_.size(); ++i) {
+    if (names_[i] == name) {
+      throw std::runtime_error("Cannot declare twice: " +
+                               std::string(identifierPool().text(name)));
+    }
+  }
+
+  const auto index = takeIndex(kind);
+  names_.push_back(name);
+  symbols_.push_back(Symbol{name, type, kind, index});
+  return symbols_.back();
+}
+
+void SymbolTable::reserve(const SymbolKind kind) {
+  if (kind == SymbolKind::kFieldSize) {
+    throw std::runtime_error("Invalid symbol kind");
+  }
+  takeIndex(kind);
+}
+
+const Symbol* SymbolTable::find(const IdentifierId name) const noexcept {
+  for (auto i = names_.size(); i > 0; --i) {
+    if (names_[i - 1] == name) {
+      return &symbols_[i - 1];
+    }
+  }
+  return nullptr;
+}
+
+std::uint16_t SymbolTable::takeIndex(const SymbolKind kind) {
+  auto& count = counts_[static_cast<std::size_t>(kind)];
+  if (count == std::numeric_limits<std::uint16_t>::max()) {
+    throw std::runtime_error("Too many variables");
+  }
+  return count++;
+}
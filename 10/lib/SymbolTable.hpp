@@ -0,0 +1,81 @@
+// No copyright.
+// Scoped table of the variables a class and its subroutines declare.
+
+#ifndef LIB_SYMBOLTABLE_HPP_
+#define LIB_SYMBOLTABLE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "StringInterner.hpp"
+
+// Memory segment a variable lives in.
+enum class SymbolKind : std::uint8_t {
+  kStatic = 0,
+  kField,
+  kArgument,
+  kLocal,
+  kFieldSize,
+};
+
+// type is the identifierPool() ID of the type name, e.g. of "int" or of a
+// class name. index counts the earlier symbols of the same kind.
+struct Symbol {
+  IdentifierId name;
+  IdentifierId type;
+  SymbolKind kind;
+  std::uint16_t index;
+};
+
+// Symbols are stored in declaration order in one flat array and scopes are
+// marks into it, so opening a scope is a push and closing one truncates the
+// array, whatever the table held. Lookups scan the names from the innermost
+// scope outwards: a class and a subroutine declare a few dozen names at
+// most, which fit in a handful of cache lines.
+class SymbolTable final {
+ public:
+  SymbolTable() = default;
+  ~SymbolTable() = default;
+
+  // Indices continue from the enclosing scope and popScope() restores them.
+  void pushScope();
+  void popScope();
+  // Number of open scopes besides the outermost one, which never closes.
+  std::size_t scopeDepth() const noexcept { return marks_.size(); }
+
+  // Throws when name is already declared in the innermost scope. Outer
+  // declarations are shadowed.
+  const Symbol& define(IdentifierId name, IdentifierId type, SymbolKind kind);
+  // Takes the next index of kind without naming it, e.g. argument 0 of a
+  // method, which holds this.
+  void reserve(SymbolKind kind);
+
+  // The innermost declaration of name, nullptr if there is none.
+  const Symbol* find(IdentifierId name) const noexcept;
+  // Number of indices of kind taken so far.
+  std::uint16_t count(SymbolKind kind) const noexcept {
+    return counts_[static_cast<std::size_t>(kind)];
+  }
+  std::size_t size() const noexcept { return symbols_.size(); }
+
+ private:
+  static constexpr std::size_t kNumKinds =
+      static_cast<std::size_t>(SymbolKind::kFieldSize);
+
+  struct Mark {
+    std::size_t size;
+    std::array<std::uint16_t, kNumKinds> counts;
+  };
+
+  std::uint16_t takeIndex(SymbolKind kind);
+
+  // Parallel to symbols_, scanned on its own.
+  std::vector<IdentifierId> names_;
+  std::vector<Symbol> symbols_;
+  std::vector<Mark> marks_;
+  std::array<std::uint16_t, kNumKinds> counts_{};
+};
+
+#endif  // LIB_SYMBOLTABLE_HPP_
@@ -0,0 +1,45 @@
+// No copyright.
+// Jack syntax tree.
+
+#include "SyntaxTree.hpp"
+
+#include <stdexcept>
+
+SyntaxTreeBuilder::SyntaxTreeBuilder(Arena* arena) : arena_(arena) {
+  open_nodes_.push_back(arena_->create<SyntaxNode>());
+}
+
+void SyntaxTreeBuilder::beginNode(const NodeKind kind) {
+  auto* node = arena_->create<SyntaxNode>();
+  node->kind = kind;
+  append(node);
+  open_nodes_.push_back(node);
+}
+
+void SyntaxTreeBuilder::endNode() {
+  if (open_nodes_.size() == 1) {
+    throw std::runtime_error("No syntax node to close");
+  }
+  open_nodes_.pop_back();
+}
+
+void SyntaxTreeBuilder::addTerminal(const TokenType token_type,
+                                    const std::uint16_t subtype,
+                                    const std::string_view text) {
+  auto* node = arena_->create<SyntaxNode>();
+  node->kind = NodeKind::kTerminal;
+  node->token_type = token_type;
+  node->subtype = subtype;
+  node->text = text;
+  append(node);
+}
+
+void SyntaxTreeBuilder::append(SyntaxNode* node) {
+  auto* parent = open_nodes_.back();
+  if (parent->last_child == nullptr) {
+    parent->first_child = node;
+  } else {
+    parent->last_child->next_sibling = node;
+  }
+  parent->last_child = node;
+}
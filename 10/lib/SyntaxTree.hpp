@@ -0,0 +1,108 @@
+// No copyright.
+// Jack syntax tree.
+
+#ifndef LIB_SYNTAXTREE_HPP_
+#define LIB_SYNTAXTREE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Tokens.hpp"
+
+// Nonterminals are named after the grammar rules of the reference XML.
+enum class NodeKind : std::uint8_t {
+  // Root holding whatever the engine compiled, usually a single class.
+  kFragment = 0,
+  kClass,
+  kClassVarDec,
+  kSubroutineDec,
+  kParameterList,
+  kSubroutineBody,
+  kVarDec,
+  kStatements,
+  kLetStatement,
+  kIfStatement,
+  kWhileStatement,
+  kDoStatement,
+  kReturnStatement,
+  kExpression,
+  kTerm,
+  kExpressionList,
+  kTerminal,
+  kFieldSize,
+};
+
+// Indexed by NodeKind.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(NodeKind::kFieldSize)>
+    kNodeKindNames{
+        "fragment",        "class",          "classVarDec",
+        "subroutineDec",   "parameterList",  "subroutineBody",
+        "varDec",          "statements",     "letStatement",
+        "ifStatement",     "whileStatement", "doStatement",
+        "returnStatement", "expression",     "term",
+        "expressionList",  "terminal",
+    };
+
+// Children form a singly linked list so that nodes are fixed size and can
+// live in an Arena. token_type, subtype and text are only set on terminals:
+// subtype is interpreted as in TokenTable and text is what the XML shows,
+// i.e. string constants without their quotes. Integer constants have no
+// text, their value is the subtype.
+struct SyntaxNode {
+  NodeKind kind = NodeKind::kFragment;
+  TokenType token_type = TokenType::kFieldSize;
+  std::uint16_t subtype = 0;
+  std::string_view text;
+  SyntaxNode* first_child = nullptr;
+  SyntaxNode* last_child = nullptr;
+  SyntaxNode* next_sibling = nullptr;
+
+  bool isTerminal() const noexcept { return kind == NodeKind::kTerminal; }
+};
+
+// Builds a tree top down in an Arena owned by the caller.
+class SyntaxTreeBuilder final {
+ public:
+  explicit SyntaxTreeBuilder(Arena* arena);
+  SyntaxTreeBuilder() = delete;
+  ~SyntaxTreeBuilder() = default;
+
+  // Opens a nonterminal as the last child of the innermost open node.
+  void beginNode(NodeKind kind);
+  void endNode();
+  void addTerminal(TokenType token_type, std::uint16_t subtype,
+                   std::string_view text);
+
+  const SyntaxNode& root() const noexcept { return *open_nodes_.front(); }
+
+ private:
+  void append(SyntaxNode* node);
+
+  Arena* arena_;
+  std::vector<SyntaxNode*> open_nodes_;
+};
+
+// Walks the tree depth first. Visitor provides
+//   void enterNode(const SyntaxNode&);  // nonterminals, before children
+//   void leaveNode(const SyntaxNode&);  // nonterminals, after children
+//   void visitTerminal(const SyntaxNode&);
+template <typename Visitor>
+void visitSyntaxTree(const SyntaxNode& node, Visitor* visitor) {
+  if (node.isTerminal()) {
+    visitor->visitTerminal(node);
+    return;
+  }
+  visitor->enterNode(node);
+  for (const auto* child = node.first_child; child != nullptr;
+       child = child->next_sibling) {
+    visitSyntaxTree(*child, visitor);
+  }
+  visitor->leaveNode(node);
+}
+
+#endif  // LIB_SYNTAXTREE_HPP_
@@ -3,146 +3,172 @@
 
 #include "lib/Tokens.hpp"
 
-#include <algorithm>
 #include <iostream>
 #include <stdexcept>
-#include <unordered_map>
 
 namespace {
 
-const std::unordered_map<std::string, KeyWordType> kKeywordNamesToEnum{
-    {kKeywordNames[0], KeyWordType::kClass},
-    {kKeywordNames[1], KeyWordType::kMethod},
-    {kKeywordNames[2], KeyWordType::kFunction},
-    {kKeywordNames[3], KeyWordType::kConstructor},
-    {kKeywordNames[4], KeyWordType::kInt},
-    {kKeywordNames[5], KeyWordType::kBoolean},
-    {kKeywordNames[6], KeyWordType::kChar},
-    {kKeywordNames[7], KeyWordType::kVoid},
-    {kKeywordNames[8], KeyWordType::kVar},
-    {kKeywordNames[9], KeyWordType::kStatic},
-    {kKeywordNames[10], KeyWordType::kField},
-    {kKeywordNames[11], KeyWordType::kLet},
-    {kKeywordNames[12], KeyWordType::kDo},
-    {kKeywordNames[13], KeyWordType::kIf},
-    {kKeywordNames[14], KeyWordType::kElse},
-    {kKeywordNames[15], KeyWordType::kWhile},
-    {kKeywordNames[16], KeyWordType::kReturn},
-    {kKeywordNames[17], KeyWordType::kTrue},
-    {kKeywordNames[18], KeyWordType::kFalse},
-    {kKeywordNames[19], KeyWordType::kNull},
-    {kKeywordNames[20], KeyWordType::kThis},
+// Subtypes of tokens tagged TokenType::kFieldSize.
+enum InvalidTokenReason : std::uint16_t {
+  kInvalidToken = 0,
+  kIntegerOutOfBound,
+  kStartsWithInteger,
 };
 
-}  // namespace
-
-Tokens::Tokens(const std::vector<std::string> tokens) : tokens_(tokens) {}
-
-bool Tokens::hasMoreTokens() const { return token_index_ + 1 < tokens_.size(); }
-
-void Tokens::advance() {
-  if (!hasMoreTokens()) {
-    throw std::runtime_error("No more tokens exists.");
+constexpr bool allKeywordsRecognized() {
+  for (std::size_t i = 0; i < kKeywordNames.size(); ++i) {
+    if (keywordTypeOf(kKeywordNames[i]) != static_cast<KeyWordType>(i)) {
+      return false;
+    }
   }
-  ++token_index_;
+  return true;
 }
+static_assert(allKeywordsRecognized(),
+              "keywordCandidate disagrees with kKeywordNames");
 
-TokenType Tokens::tokenType() {
-  const auto& token = tokens_[token_index_];
+}  // namespace
 
-  if (std::find(std::cbegin(kKeywordNames), std::cend(kKeywordNames), token) !=
-      std::cend(kKeywordNames)) {
-    return TokenType::kKeyWord;
+Tokens::Tokens(const std::vector<std::string>& tokens) {
+  std::size_t total_size = 0;
+  for (const auto& token : tokens) {
+    total_size += token.size();
   }
 
-  if (std::find(std::cbegin(kSymbols), std::cend(kSymbols), token) !=
-      std::cend(kSymbols)) {
-    return TokenType::kSymbol;
+  auto buffer = std::make_shared<std::string>();
+  buffer->reserve(total_size);
+  for (const auto& token : tokens) {
+    buffer->append(token);
   }
-
-  if (isIntegerConstant(token)) {
-    return TokenType::kIntConst;
+  source_ = *buffer;
+  source_owner_ = std::move(buffer);
+
+  TokenTable table;
+  std::uint32_t offset = 0;
+  for (const auto& token : tokens) {
+    pushClassified(source_.substr(offset, token.size()), offset, &table);
+    offset += static_cast<std::uint32_t>(token.size());
   }
+  end_index_ = table.size();
+  table_ = std::make_shared<const TokenTable>(std::move(table));
+}
 
-  if (token[0] == '\"' && token[token.size() - 1] == '\"') {
-    return TokenType::kStringConst;
-  }
+Tokens::Tokens(std::shared_ptr<const void> source_owner,
+               std::string_view source, TokenTable table)
+    : source_owner_(std::move(source_owner)),
+      source_(source),
+      table_(std::make_shared<const TokenTable>(std::move(table))),
+      end_index_(table_->size()) {}
 
-  if (isValidIdentifier(token)) {
-    return TokenType::kIdentifier;
+Tokens Tokens::slice(const std::size_t begin, const std::size_t end) const {
+  if (begin >= end || end > table_->size()) {
+    throw std::runtime_error("Invalid token range");
   }
-
-  throw std::runtime_error("Invalied token.");
+  Tokens tokens(*this);
+  tokens.token_index_ = begin;
+  tokens.end_index_ = end;
+  return tokens;
 }
 
-KeyWordType Tokens::keyWord() {
-  if (tokenType() != TokenType::kKeyWord) {
-    std::cout << int(tokenType()) << std::endl;
-    std::cout << identifier() << std::endl;
-    throw std::runtime_error("It is not kKeyWord token type");
+void Tokens::seek(const std::size_t index) {
+  if (index >= end_index_) {
+    throw std::runtime_error("No more tokens exists.");
   }
-
-  return kKeywordNamesToEnum.at(tokens_[token_index_]);
+  token_index_ = index;
 }
 
-std::string Tokens::symbol() {
-  if (tokenType() != TokenType::kSymbol) {
-    throw std::runtime_error("It is not kSymbol token type");
+void Tokens::throwInvalidToken() const {
+  switch (table_->subtypes[token_index_]) {
+    case kIntegerOutOfBound:
+      throw std::runtime_error("Interger out of bound.");
+    case kStartsWithInteger:
+      throw std::runtime_error("Identifier should not start with integer");
+    default:
+      throw std::runtime_error("Invalied token.");
   }
-
-  return tokens_[token_index_];
 }
 
-int Tokens::intVal() {
-  if (tokenType() != TokenType::kIntConst) {
-    throw std::runtime_error("It is not kIntConst token type");
+void Tokens::throwUnexpectedType(const TokenType expected) const {
+  if (expected == TokenType::kKeyWord) {
+    std::cerr << int(tokenType()) << std::endl;
+    std::cerr << identifier() << std::endl;
   }
-
-  return std::stoi(tokens_[token_index_]);
+  tokens_internal::throwUnexpectedType(expected);
 }
 
-std::string Tokens::stringVal() {
-  if (tokenType() != TokenType::kStringConst) {
-    throw std::runtime_error("It is not kStringConst token type");
+void tokens_internal::throwUnexpectedType(const TokenType expected) {
+  switch (expected) {
+    case TokenType::kKeyWord:
+      throw std::runtime_error("It is not kKeyWord token type");
+    case TokenType::kSymbol:
+      throw std::runtime_error("It is not kSymbol token type");
+    case TokenType::kIntConst:
+      throw std::runtime_error("It is not kIntConst token type");
+    case TokenType::kStringConst:
+      throw std::runtime_error("It is not kStringConst token type");
+    case TokenType::kIdentifier:
+      throw std::runtime_error("It is not kIdentifier token type");
+    default:
+      throw std::runtime_error("Invalied token.");
   }
-
-  return tokens_[token_index_].substr(1, tokens_[token_index_].size() - 2);
 }
 
-std::string Tokens::identifier() {
-  if (tokenType() != TokenType::kIdentifier) {
-    throw std::runtime_error("It is not kIdentifier token type");
+void Tokens::pushClassified(std::string_view token, std::uint32_t offset,
+                            TokenTable* table) {
+  const auto length = static_cast<std::uint32_t>(token.size());
+
+  const auto keyword = keywordTypeOf(token);
+  if (keyword != KeyWordType::kFieldSize) {
+    table->push(TokenType::kKeyWord, static_cast<std::uint16_t>(keyword),
+                offset, length);
+    return;
   }
 
-  return tokens_[token_index_];
-}
+  if (token.size() == 1 && symbolTypeOf(token[0]) != SymbolType::kFieldSize) {
+    table->push(TokenType::kSymbol,
+                static_cast<std::uint16_t>(symbolTypeOf(token[0])), offset,
+                length);
+    return;
+  }
 
-void Tokens::recede() {
-  if (token_index_ == 0) {
-    throw std::runtime_error("No more tokens exists.");
+  if (!token.empty() && std::isdigit(token[0])) {
+    if (!isIntegerConstant(token)) {
+      table->push(TokenType::kFieldSize, kStartsWithInteger, offset, length);
+      return;
+    }
+    // More than 5 digits is out of bound anyway, avoid overflowing.
+    long value = 0;
+    for (const auto c : token.substr(0, 6)) {
+      value = value * 10 + (c - '0');
+    }
+    if (token.size() > 6 || value > 32768) {
+      table->push(TokenType::kFieldSize, kIntegerOutOfBound, offset, length);
+      return;
+    }
+    table->push(TokenType::kIntConst, static_cast<std::uint16_t>(value),
+                offset, length);
+    return;
   }
-  --token_index_;
-}
 
-bool Tokens::isIntegerConstant(const std::string& token) const {
-  if (std::isdigit(token[0])) {
-    if (token.find_first_not_of("0123456789") == std::string::npos) {
-      const auto token_int = std::stoi(token);
-      if (token_int < 0 || token_int > 32768) {
-        throw std::runtime_error("Interger out of bound.");
-      }
+  if (token.size() >= 2 && token.front() == '\"' && token.back() == '\"') {
+    table->push(TokenType::kStringConst, 0, offset, length);
+    return;
+  }
 
-      return true;
-    } else {
-      throw std::runtime_error("Identifier should not start with integer");
-    }
+  if (isValidIdentifier(token)) {
+    table->push(TokenType::kIdentifier, 0, offset, length,
+                identifierPool().intern(token));
+    return;
   }
 
-  return false;
+  table->push(TokenType::kFieldSize, kInvalidToken, offset, length);
+}
+
+bool Tokens::isIntegerConstant(std::string_view token) const {
+  return token.find_first_not_of("0123456789") == std::string_view::npos;
 }
 
-bool Tokens::isValidIdentifier(const std::string& token) const {
-  if (std::isdigit(token[0])) {
+bool Tokens::isValidIdentifier(std::string_view token) const {
+  if (token.empty() || std::isdigit(token[0])) {
     return false;
   }
 
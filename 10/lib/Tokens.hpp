@@ -4,9 +4,17 @@
 #ifndef LIB_TOKENS_HPP_
 #define LIB_TOKENS_HPP_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "StringInterner.hpp"
+
 enum class TokenType {
   kKeyWord = 0,
   kSymbol,
@@ -41,15 +49,158 @@ enum class KeyWordType {
   kFieldSize,
 };
 
-const std::vector<std::string> kKeywordNames{
-    "class", "method", "function", "constructor", "int",   "boolean", "char",
-    "void",  "var",    "static",   "field",       "let",   "do",      "if",
-    "else",  "while",  "return",   "true",        "false", "null",    "this",
+enum class SymbolType {
+  kLeftCurlyBracket = 0,
+  kRightCurlyBracket,
+  kLeftParenthesis,
+  kRightParenthesis,
+  kLeftSquareBracket,
+  kRightSquareBracket,
+  kPeriod,
+  kComma,
+  kSemicolon,
+  kPlus,
+  kMinus,
+  kAsterisk,
+  kSlash,
+  kAmpersand,
+  kVerticalBar,
+  kLessThan,
+  kGreaterThan,
+  kEqual,
+  kTilde,
+  kFieldSize,
+};
+
+// Indexed by KeyWordType.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(KeyWordType::kFieldSize)>
+    kKeywordNames{
+        "class", "method", "function", "constructor", "int",    "boolean",
+        "char",  "void",   "var",      "static",      "field",  "let",
+        "do",    "if",     "else",     "while",       "return", "true",
+        "false", "null",   "this",
+    };
+
+// Indexed by SymbolType.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(SymbolType::kFieldSize)>
+    kSymbols{
+        "{", "}", "(", ")", "[", "]", ".", ",", ";", "+",
+        "-", "*", "/", "&", "|", "<", ">", "=", "~",
+    };
+
+namespace tokens_internal {
+
+// Picks the only keyword a name can be from its length and first characters.
+constexpr KeyWordType keywordCandidate(std::string_view name) {
+  switch (name.size()) {
+    case 2:
+      return name[0] == 'd' ? KeyWordType::kDo : KeyWordType::kIf;
+    case 3:
+      return name[0] == 'i'   ? KeyWordType::kInt
+             : name[0] == 'v' ? KeyWordType::kVar
+                              : KeyWordType::kLet;
+    case 4:
+      switch (name[0]) {
+        case 'c':
+          return KeyWordType::kChar;
+        case 'v':
+          return KeyWordType::kVoid;
+        case 'e':
+          return KeyWordType::kElse;
+        case 'n':
+          return KeyWordType::kNull;
+        default:
+          return name[1] == 'r' ? KeyWordType::kTrue : KeyWordType::kThis;
+      }
+    case 5:
+      return name[0] == 'c'   ? KeyWordType::kClass
+             : name[0] == 'w' ? KeyWordType::kWhile
+             : name[1] == 'i' ? KeyWordType::kField
+                              : KeyWordType::kFalse;
+    case 6:
+      return name[0] == 'm'   ? KeyWordType::kMethod
+             : name[0] == 's' ? KeyWordType::kStatic
+                              : KeyWordType::kReturn;
+    case 7:
+      return KeyWordType::kBoolean;
+    case 8:
+      return KeyWordType::kFunction;
+    case 11:
+      return KeyWordType::kConstructor;
+    default:
+      return KeyWordType::kFieldSize;
+  }
+}
+
+constexpr std::array<SymbolType, 256> makeSymbolTypeTable() {
+  std::array<SymbolType, 256> table{};
+  for (auto& symbol_type : table) {
+    symbol_type = SymbolType::kFieldSize;
+  }
+  for (std::size_t i = 0; i < kSymbols.size(); ++i) {
+    table[static_cast<unsigned char>(kSymbols[i][0])] =
+        static_cast<SymbolType>(i);
+  }
+  return table;
+}
+
+constexpr auto kSymbolTypeTable = makeSymbolTypeTable();
+
+// Shared by the token sources for accessors called on the wrong token type.
+[[noreturn]] void throwUnexpectedType(TokenType expected);
+
+}  // namespace tokens_internal
+
+// Returns KeyWordType::kFieldSize when name is not a keyword.
+constexpr KeyWordType keywordTypeOf(std::string_view name) {
+  const auto candidate = tokens_internal::keywordCandidate(name);
+  if (candidate == KeyWordType::kFieldSize ||
+      kKeywordNames[static_cast<std::size_t>(candidate)] != name) {
+    return KeyWordType::kFieldSize;
+  }
+  return candidate;
+}
+
+// Returns SymbolType::kFieldSize when c is not a symbol.
+constexpr SymbolType symbolTypeOf(char c) {
+  return tokens_internal::kSymbolTypeTable[static_cast<unsigned char>(c)];
+}
+
+// Classified tokens in structure of arrays layout, one entry per token.
+// subtypes holds the KeyWordType for keywords, the SymbolType for symbols
+// and the value for integer constants. ids holds the identifierPool() ID of
+// identifiers and 0 for other tokens. Tokens which failed to classify are
+// tagged TokenType::kFieldSize and only throw when accessed.
+struct TokenTable {
+  std::vector<TokenType> types;
+  std::vector<std::uint16_t> subtypes;
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> lengths;
+  std::vector<IdentifierId> ids;
+
+  void push(TokenType type, std::uint16_t subtype, std::uint32_t offset,
+            std::uint32_t length, IdentifierId id = 0) {
+    types.push_back(type);
+    subtypes.push_back(subtype);
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    ids.push_back(id);
+  }
+  std::size_t size() const noexcept { return types.size(); }
 };
 
-const std::vector<std::string> kSymbols{
-    "{", "}", "(", ")", "[", "]", ".", ",", ";", "+",
-    "-", "*", "/", "&", "|", "<", ">", "=", "~",
+// One classified token. subtype is interpreted as in TokenTable.
+struct Token {
+  TokenType type = TokenType::kFieldSize;
+  std::uint16_t subtype = 0;
+  std::string_view text;
+
+  bool isSymbol(const SymbolType symbol_type) const noexcept {
+    return type == TokenType::kSymbol &&
+           subtype == static_cast<std::uint16_t>(symbol_type);
+  }
 };
 
 class ITokens {
@@ -57,39 +208,162 @@ class ITokens {
   virtual ~ITokens() = default;
   virtual bool hasMoreTokens() const = 0;
   virtual void advance() = 0;
-  virtual TokenType tokenType() = 0;
-  virtual KeyWordType keyWord() = 0;
-  virtual std::string symbol() = 0;
-  virtual int intVal() = 0;
-  virtual std::string stringVal() = 0;
-  virtual std::string identifier() = 0;
-
-  virtual void recede() = 0;
+  virtual TokenType tokenType() const = 0;
+  virtual KeyWordType keyWord() const = 0;
+  virtual std::string_view symbol() const = 0;
+  virtual SymbolType symbolType() const = 0;
+  virtual int intVal() const = 0;
+  virtual std::string_view stringVal() const = 0;
+  virtual std::string_view identifier() const = 0;
+  // identifierPool() ID of the current identifier, for comparing names
+  // without their text.
+  virtual IdentifierId identifierId() const = 0;
+
+  // Returns the token n positions after the current one without moving the
+  // cursor. Past the last token the result has type TokenType::kFieldSize.
+  virtual Token peek(std::size_t n) const noexcept = 0;
 };
 
 class Tokens final : public ITokens {
  public:
-  Tokens(const std::vector<std::string> tokens);
+  // Copies the tokens into a single buffer owned by Tokens.
+  Tokens(const std::vector<std::string>& tokens);
+  // Tokens already classified by the tokenizer. Offsets point into source,
+  // source_owner keeps that memory alive.
+  Tokens(std::shared_ptr<const void> source_owner, std::string_view source,
+         TokenTable table);
   Tokens() = delete;
   ~Tokens() = default;
 
   bool hasMoreTokens() const;
   void advance();
-  TokenType tokenType();
-  KeyWordType keyWord();
-  std::string symbol();
-  int intVal();
-  std::string stringVal();
-  std::string identifier();
+  TokenType tokenType() const;
+  KeyWordType keyWord() const;
+  std::string_view symbol() const;
+  SymbolType symbolType() const;
+  int intVal() const;
+  std::string_view stringVal() const;
+  std::string_view identifier() const;
+  IdentifierId identifierId() const;
+
+  Token peek(std::size_t n) const noexcept;
 
-  void recede();
+  // Random access for callers that split the token array between cursors.
+  // Copies and slices share the table, which is never modified.
+  const TokenTable& table() const noexcept { return *table_; }
+  // Index of the current token in table().
+  std::size_t position() const noexcept { return token_index_; }
+  // Moves the cursor to index, which must lie within this view.
+  void seek(std::size_t index);
+  // A cursor over the tokens [begin, end) of table(), starting at begin.
+  Tokens slice(std::size_t begin, std::size_t end) const;
 
  private:
-  bool isIntegerConstant(const std::string& token) const;
-  bool isValidIdentifier(const std::string& token) const;
+  [[noreturn]] void throwInvalidToken() const;
+  [[noreturn]] void throwUnexpectedType(TokenType expected) const;
+  std::string_view currentToken() const;
+  void pushClassified(std::string_view token, std::uint32_t offset,
+                      TokenTable* table);
+  bool isIntegerConstant(std::string_view token) const;
+  bool isValidIdentifier(std::string_view token) const;
 
-  std::vector<std::string> tokens_;
+  std::shared_ptr<const void> source_owner_;
+  std::string_view source_;
+  std::shared_ptr<const TokenTable> table_;
+  // One past the last token of this view.
+  std::size_t end_index_ = 0;
   std::size_t token_index_ = 0;
 };
 
+// The accessors are defined here so that callers holding a Tokens, rather
+// than an ITokens, get them inlined. Error paths stay out of line.
+
+inline bool Tokens::hasMoreTokens() const {
+  return token_index_ + 1 < end_index_;
+}
+
+inline void Tokens::advance() {
+  if (!hasMoreTokens()) {
+    throw std::runtime_error("No more tokens exists.");
+  }
+  ++token_index_;
+}
+
+inline TokenType Tokens::tokenType() const {
+  // An empty view, e.g. of a file with only comments, has no current token.
+  if (token_index_ >= end_index_) {
+    throw std::runtime_error("No more tokens exists.");
+  }
+  const auto type = table_->types[token_index_];
+  if (type == TokenType::kFieldSize) {
+    throwInvalidToken();
+  }
+  return type;
+}
+
+inline KeyWordType Tokens::keyWord() const {
+  if (tokenType() != TokenType::kKeyWord) {
+    throwUnexpectedType(TokenType::kKeyWord);
+  }
+  return static_cast<KeyWordType>(table_->subtypes[token_index_]);
+}
+
+inline std::string_view Tokens::symbol() const {
+  if (tokenType() != TokenType::kSymbol) {
+    throwUnexpectedType(TokenType::kSymbol);
+  }
+  return currentToken();
+}
+
+inline SymbolType Tokens::symbolType() const {
+  if (tokenType() != TokenType::kSymbol) {
+    throwUnexpectedType(TokenType::kSymbol);
+  }
+  return static_cast<SymbolType>(table_->subtypes[token_index_]);
+}
+
+inline int Tokens::intVal() const {
+  if (tokenType() != TokenType::kIntConst) {
+    throwUnexpectedType(TokenType::kIntConst);
+  }
+  return table_->subtypes[token_index_];
+}
+
+inline std::string_view Tokens::stringVal() const {
+  if (tokenType() != TokenType::kStringConst) {
+    throwUnexpectedType(TokenType::kStringConst);
+  }
+  const auto token = currentToken();
+  return token.substr(1, token.size() - 2);
+}
+
+inline std::string_view Tokens::identifier() const {
+  if (tokenType() != TokenType::kIdentifier) {
+    throwUnexpectedType(TokenType::kIdentifier);
+  }
+  return currentToken();
+}
+
+inline IdentifierId Tokens::identifierId() const {
+  if (tokenType() != TokenType::kIdentifier) {
+    throwUnexpectedType(TokenType::kIdentifier);
+  }
+  return table_->ids[token_index_];
+}
+
+inline Token Tokens::peek(const std::size_t n) const noexcept {
+  const auto index = token_index_ + n;
+  if (index >= end_index_) {
+    return Token{};
+  }
+  const auto& table = *table_;
+  return Token{table.types[index], table.subtypes[index],
+               source_.substr(table.offsets[index], table.lengths[index])};
+}
+
+inline std::string_view Tokens::currentToken() const {
+  return source_.substr(table_->offsets[token_index_],
+                        table_->lengths[token_index_]);
+}
+
 #endif  // LIB_TOKENS_HPP_
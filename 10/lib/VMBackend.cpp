@@ -0,0 +1,303 @@
+// No copyright.
+// Lowers the intermediate representation to VM code.
+
+#include "VMBackend.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+
+#include "StringInterner.hpp"
+
+namespace {
+
+// Where each kind of variable lives in the VM.
+VMSegment segmentOf(const std::uint8_t kind) {
+  switch (static_cast<SymbolKind>(kind)) {
+    case SymbolKind::kStatic:
+      return VMSegment::kStatic;
+    case SymbolKind::kField:
+      return VMSegment::kThis;
+    case SymbolKind::kArgument:
+      return VMSegment::kArgument;
+    case SymbolKind::kLocal:
+      return VMSegment::kLocal;
+    default:
+      throw std::runtime_error("Invalid symbol kind");
+  }
+}
+
+bool isComparison(const IRInstruction& instruction) {
+  const auto op = static_cast<IRBinaryOp>(instruction.op);
+  return instruction.opcode == IROpcode::kBinary &&
+         (op == IRBinaryOp::kLessThan || op == IRBinaryOp::kGreaterThan ||
+          op == IRBinaryOp::kEqual);
+}
+
+// Whether the value a block branches on is 0 or -1, computed by its last
+// instructions as a comparison or ~ of one.
+bool isBoolean(const IRBlock& block) {
+  if (block.size == 0) {
+    return false;
+  }
+  const auto* last = &block.instructions[block.size - 1];
+  if (last->result != block.value) {
+    return false;
+  }
+  if (last->opcode == IROpcode::kUnary &&
+      static_cast<IRUnaryOp>(last->op) == IRUnaryOp::kNot &&
+      block.size >= 2) {
+    const auto* operand = last - 1;
+    return operand->result == last->lhs && isComparison(*operand);
+  }
+  return isComparison(*last);
+}
+
+}  // namespace
+
+VMBackend::VMBackend(VMWriter* writer) : writer_(writer) {}
+
+void VMBackend::lower(const IRFunction& function) {
+  auto& pool = identifierPool();
+  writer_->writeFunction(pool.text(function.class_name),
+                         pool.text(function.name), function.num_locals);
+
+  const auto layout = layoutOf(function);
+  stack_.clear();
+  for (IRBlockId id = 0; id < function.blocks.size(); ++id) {
+    if (!layout.reachable[id]) {
+      continue;
+    }
+    if (layout.labeled[id]) {
+      writer_->writeLabel("L", id);
+    }
+    const auto& block = function.blocks[id];
+    for (std::uint32_t i = 0; i < block.size; ++i) {
+      lowerInstruction(block.instructions[i]);
+    }
+
+    const auto next = id + 1;
+    switch (block.terminator) {
+      case IRTerminator::kFallthrough:
+        break;
+      case IRTerminator::kJump:
+        if (block.target != next) {
+          writer_->writeGoto("L", block.target);
+        }
+        break;
+      case IRTerminator::kBranch: {
+        // The condition, or its inverse if negated, holds when if-goto
+        // jumps, which it does on anything but 0.
+        const auto negated = lowerCondition(block);
+        const auto on_true = negated ? block.other : block.target;
+        const auto on_false = negated ? block.target : block.other;
+        if (on_true == next) {
+          // not only inverts the 0 and -1 of comparisons, anything else is
+          // compared to 0.
+          if (block.rhs == kNoTemp &&
+              (block.condition == IRCondition::kNotEqual ||
+               block.condition == IRCondition::kEqual) &&
+              !isBoolean(block)) {
+            writer_->writePush(VMSegment::kConstant, 0);
+            writer_->writeArithmetic(VMArithmetic::kEq);
+          } else {
+            writer_->writeArithmetic(VMArithmetic::kNot);
+          }
+          writer_->writeIf("L", on_false);
+        } else {
+          writer_->writeIf("L", on_true);
+          if (on_false != next) {
+            writer_->writeGoto("L", on_false);
+          }
+        }
+        break;
+      }
+      case IRTerminator::kReturn:
+        use(block.value);
+        writer_->writeReturn();
+        break;
+    }
+    if (!stack_.empty()) {
+      throw std::runtime_error("Unused temporaries at the end of a block");
+    }
+  }
+}
+
+void VMBackend::lowerInstruction(const IRInstruction& instruction) {
+  auto& pool = identifierPool();
+  switch (instruction.opcode) {
+    case IROpcode::kConstant:
+      if (instruction.value >= 0) {
+        writer_->writePush(VMSegment::kConstant,
+                           static_cast<std::uint16_t>(instruction.value));
+      } else {
+        // ~value fits, -value does not for -32768.
+        writer_->writePush(VMSegment::kConstant,
+                           static_cast<std::uint16_t>(~instruction.value));
+        writer_->writeArithmetic(VMArithmetic::kNot);
+      }
+      break;
+    case IROpcode::kString:
+      writer_->writePush(VMSegment::kConstant, instruction.count);
+      writer_->writeCall("String", "new", 1);
+      for (std::size_t i = 0; i < instruction.count; ++i) {
+        writer_->writePush(VMSegment::kConstant,
+                           static_cast<unsigned char>(instruction.text[i]));
+        writer_->writeCall("String", "appendChar", 2);
+      }
+      break;
+    case IROpcode::kThis:
+      writer_->writePush(VMSegment::kPointer, 0);
+      break;
+    case IROpcode::kLoad:
+      writer_->writePush(segmentOf(instruction.op), instruction.count);
+      break;
+    case IROpcode::kStore:
+      use(instruction.lhs);
+      writer_->writePop(segmentOf(instruction.op), instruction.count);
+      break;
+    case IROpcode::kLoadIndirect:
+      use(instruction.lhs);
+      writer_->writePop(VMSegment::kPointer, 1);
+      writer_->writePush(VMSegment::kThat, 0);
+      break;
+    case IROpcode::kStoreIndirect:
+      use(instruction.rhs);
+      use(instruction.lhs);
+      writer_->writePop(VMSegment::kTemp, 0);
+      writer_->writePop(VMSegment::kPointer, 1);
+      writer_->writePush(VMSegment::kTemp, 0);
+      writer_->writePop(VMSegment::kThat, 0);
+      break;
+    case IROpcode::kUnary:
+      use(instruction.lhs);
+      switch (static_cast<IRUnaryOp>(instruction.op)) {
+        case IRUnaryOp::kNeg:
+          writer_->writeArithmetic(VMArithmetic::kNeg);
+          break;
+        case IRUnaryOp::kNot:
+          writer_->writeArithmetic(VMArithmetic::kNot);
+          break;
+        case IRUnaryOp::kMultiplyByPowerOf2:
+          // The VM has no dup, so each doubling goes through temp 0.
+          for (auto i = instruction.value; i > 0; --i) {
+            writer_->writePop(VMSegment::kTemp, 0);
+            writer_->writePush(VMSegment::kTemp, 0);
+            writer_->writePush(VMSegment::kTemp, 0);
+            writer_->writeArithmetic(VMArithmetic::kAdd);
+          }
+          break;
+        case IRUnaryOp::kDivideByPowerOf2:
+          // Nor a shift, so halving is left to Math.
+          writer_->writePush(
+              VMSegment::kConstant,
+              static_cast<std::uint16_t>(1 << instruction.value));
+          writer_->writeCall("Math", "divide", 2);
+          break;
+        default:
+          throw std::runtime_error("Invalid unary operation");
+      }
+      break;
+    case IROpcode::kBinary:
+      use(instruction.rhs);
+      use(instruction.lhs);
+      switch (static_cast<IRBinaryOp>(instruction.op)) {
+        case IRBinaryOp::kAdd:
+          writer_->writeArithmetic(VMArithmetic::kAdd);
+          break;
+        case IRBinaryOp::kSub:
+          writer_->writeArithmetic(VMArithmetic::kSub);
+          break;
+        case IRBinaryOp::kMultiply:
+          writer_->writeCall("Math", "multiply", 2);
+          break;
+        case IRBinaryOp::kDivide:
+          writer_->writeCall("Math", "divide", 2);
+          break;
+        case IRBinaryOp::kAnd:
+          writer_->writeArithmetic(VMArithmetic::kAnd);
+          break;
+        case IRBinaryOp::kOr:
+          writer_->writeArithmetic(VMArithmetic::kOr);
+          break;
+        case IRBinaryOp::kLessThan:
+          writer_->writeArithmetic(VMArithmetic::kLt);
+          break;
+        case IRBinaryOp::kGreaterThan:
+          writer_->writeArithmetic(VMArithmetic::kGt);
+          break;
+        case IRBinaryOp::kEqual:
+          writer_->writeArithmetic(VMArithmetic::kEq);
+          break;
+        default:
+          throw std::runtime_error("Invalid binary operation");
+      }
+      break;
+    case IROpcode::kCall:
+      for (auto i = instruction.count; i > 0; --i) {
+        use(instruction.arguments[i - 1]);
+      }
+      writer_->writeCall(pool.text(instruction.callee_class),
+                         pool.text(instruction.callee_name),
+                         instruction.count);
+      break;
+    case IROpcode::kSetThis:
+      use(instruction.lhs);
+      writer_->writePop(VMSegment::kPointer, 0);
+      break;
+    case IROpcode::kDiscard:
+      use(instruction.lhs);
+      writer_->writePop(VMSegment::kTemp, 0);
+      break;
+  }
+  if (instruction.result != kNoTemp) {
+    stack_.push_back(instruction.result);
+  }
+}
+
+bool VMBackend::lowerCondition(const IRBlock& block) {
+  const auto zero = block.rhs == kNoTemp;
+  if (!zero) {
+    use(block.rhs);
+  }
+  use(block.value);
+  const auto compare = [&](const VMArithmetic command) {
+    if (zero) {
+      writer_->writePush(VMSegment::kConstant, 0);
+    }
+    writer_->writeArithmetic(command);
+  };
+  switch (block.condition) {
+    case IRCondition::kNotEqual:
+      if (zero) {
+        return false;
+      }
+      writer_->writeArithmetic(VMArithmetic::kEq);
+      return true;
+    case IRCondition::kEqual:
+      if (zero) {
+        return true;
+      }
+      writer_->writeArithmetic(VMArithmetic::kEq);
+      return false;
+    case IRCondition::kLess:
+      compare(VMArithmetic::kLt);
+      return false;
+    case IRCondition::kGreater:
+      compare(VMArithmetic::kGt);
+      return false;
+    case IRCondition::kLessOrEqual:
+      compare(VMArithmetic::kGt);
+      return true;
+    case IRCondition::kGreaterOrEqual:
+      compare(VMArithmetic::kLt);
+      return true;
+  }
+  throw std::runtime_error("Invalid condition");
+}
+
+void VMBackend::use(const IRTemp temp) {
+  if (stack_.empty() || stack_.back() != temp) {
+    throw std::runtime_error("Temporaries out of stack order");
+  }
+  stack_.pop_back();
+}
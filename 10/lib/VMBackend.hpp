@@ -0,0 +1,35 @@
+// No copyright.
+// Lowers the intermediate representation to VM code.
+
+#ifndef LIB_VMBACKEND_HPP_
+#define LIB_VMBACKEND_HPP_
+
+#include <vector>
+
+#include "IR.hpp"
+#include "VMWriter.hpp"
+
+// Temporaries map to the VM stack, so functions must keep them in stack
+// order; lower() throws otherwise. Block n is labeled Ln.
+class VMBackend final : public IIRBackend {
+ public:
+  explicit VMBackend(VMWriter* writer);
+  VMBackend() = delete;
+  ~VMBackend() = default;
+
+  void lower(const IRFunction& function) override;
+
+ private:
+  void lowerInstruction(const IRInstruction& instruction);
+  // Leaves a value on the stack that is not 0 exactly when the condition
+  // of a kBranch holds, or exactly when it does not if this returns true.
+  bool lowerCondition(const IRBlock& block);
+  // Checks that temp is the one on top of the stack and pops it.
+  void use(IRTemp temp);
+
+  VMWriter* writer_;
+  // Temporaries on the VM stack, checked against the function.
+  std::vector<IRTemp> stack_;
+};
+
+#endif  // LIB_VMBACKEND_HPP_
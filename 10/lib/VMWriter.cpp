@@ -0,0 +1,123 @@
+// No copyright.
+// Writes Hack VM commands.
+
+#include "VMWriter.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <stdexcept>
+
+namespace {
+
+// Indexed by VMSegment.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(VMSegment::kFieldSize)>
+    kSegmentNames{
+        " constant ", " argument ", " local ",   " static ",
+        " this ",     " that ",     " pointer ", " temp ",
+    };
+
+// Indexed by VMArithmetic.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(VMArithmetic::kFieldSize)>
+    kArithmeticCommands{
+        "add\n", "sub\n", "neg\n", "eq\n",  "gt\n",
+        "lt\n",  "and\n", "or\n",  "not\n",
+    };
+
+}  // namespace
+
+VMWriter::VMWriter(IOutputSink* sink) : sink_(sink) {}
+
+void VMWriter::writePush(const VMSegment segment, const std::uint16_t index) {
+  writeSegmentCommand("push", segment, index);
+}
+
+void VMWriter::writePop(const VMSegment segment, const std::uint16_t index) {
+  if (segment == VMSegment::kConstant) {
+    throw std::runtime_error("Cannot pop to constant");
+  }
+  writeSegmentCommand("pop", segment, index);
+}
+
+void VMWriter::writeArithmetic(const VMArithmetic command) {
+  const auto index = static_cast<std::size_t>(command);
+  if (index >= kArithmeticCommands.size()) {
+    throw std::runtime_error("Invalid arithmetic command");
+  }
+  sink_->append(kArithmeticCommands[index]);
+}
+
+void VMWriter::writeLabel(const std::string_view prefix,
+                          const std::uint32_t number) {
+  writeLabelCommand("label ", prefix, number);
+}
+
+void VMWriter::writeGoto(const std::string_view prefix,
+                         const std::uint32_t number) {
+  writeLabelCommand("goto ", prefix, number);
+}
+
+void VMWriter::writeIf(const std::string_view prefix,
+                       const std::uint32_t number) {
+  writeLabelCommand("if-goto ", prefix, number);
+}
+
+void VMWriter::writeCall(const std::string_view class_name,
+                         const std::string_view subroutine_name,
+                         const std::uint16_t num_args) {
+  writeNamedCommand("call ", class_name, subroutine_name, num_args);
+}
+
+void VMWriter::writeFunction(const std::string_view class_name,
+                             const std::string_view subroutine_name,
+                             const std::uint16_t num_locals) {
+  writeNamedCommand("function ", class_name, subroutine_name, num_locals);
+}
+
+void VMWriter::writeReturn() { sink_->append("return\n"); }
+
+void VMWriter::writeSegmentCommand(const std::string_view command,
+                                   const VMSegment segment,
+                                   const std::uint16_t index) {
+  const auto segment_index = static_cast<std::size_t>(segment);
+  if (segment_index >= kSegmentNames.size()) {
+    throw std::runtime_error("Invalid segment");
+  }
+  if (segment == VMSegment::kConstant && index > 32767) {
+    throw std::runtime_error("Constant out of range");
+  }
+  sink_->append(command);
+  sink_->append(kSegmentNames[segment_index]);
+  appendNumber(index);
+  sink_->append("\n");
+}
+
+void VMWriter::writeLabelCommand(const std::string_view command,
+                                 const std::string_view prefix,
+                                 const std::uint32_t number) {
+  sink_->append(command);
+  sink_->append(prefix);
+  appendNumber(number);
+  sink_->append("\n");
+}
+
+void VMWriter::writeNamedCommand(const std::string_view command,
+                                 const std::string_view class_name,
+                                 const std::string_view subroutine_name,
+                                 const std::uint16_t count) {
+  sink_->append(command);
+  sink_->append(class_name);
+  sink_->append(".");
+  sink_->append(subroutine_name);
+  sink_->append(" ");
+  appendNumber(count);
+  sink_->append("\n");
+}
+
+void VMWriter::appendNumber(const std::uint32_t number) {
+  char digits[16];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+  sink_->append(std::string_view(digits, result.ptr - digits));
+}
@@ -0,0 +1,72 @@
+// No copyright.
+// Writes Hack VM commands.
+
+#ifndef LIB_VMWRITER_HPP_
+#define LIB_VMWRITER_HPP_
+
+#include <cstdint>
+#include <string_view>
+
+#include "OutputSink.hpp"
+
+enum class VMSegment : std::uint8_t {
+  kConstant = 0,
+  kArgument,
+  kLocal,
+  kStatic,
+  kThis,
+  kThat,
+  kPointer,
+  kTemp,
+  kFieldSize,
+};
+
+enum class VMArithmetic : std::uint8_t {
+  kAdd = 0,
+  kSub,
+  kNeg,
+  kEq,
+  kGt,
+  kLt,
+  kAnd,
+  kOr,
+  kNot,
+  kFieldSize,
+};
+
+// Appends one command per line to a sink, which must outlive the writer.
+// Labels are a prefix and a number, e.g. WHILE_EXP0, so callers never build
+// strings.
+class VMWriter final {
+ public:
+  explicit VMWriter(IOutputSink* sink);
+  VMWriter() = delete;
+  ~VMWriter() = default;
+
+  void writePush(VMSegment segment, std::uint16_t index);
+  void writePop(VMSegment segment, std::uint16_t index);
+  void writeArithmetic(VMArithmetic command);
+  void writeLabel(std::string_view prefix, std::uint32_t number);
+  void writeGoto(std::string_view prefix, std::uint32_t number);
+  void writeIf(std::string_view prefix, std::uint32_t number);
+  void writeCall(std::string_view class_name, std::string_view subroutine_name,
+                 std::uint16_t num_args);
+  void writeFunction(std::string_view class_name,
+                     std::string_view subroutine_name,
+                     std::uint16_t num_locals);
+  void writeReturn();
+
+ private:
+  void writeSegmentCommand(std::string_view command, VMSegment segment,
+                           std::uint16_t index);
+  void writeLabelCommand(std::string_view command, std::string_view prefix,
+                         std::uint32_t number);
+  void writeNamedCommand(std::string_view command, std::string_view class_name,
+                         std::string_view subroutine_name,
+                         std::uint16_t count);
+  void appendNumber(std::uint32_t number);
+
+  IOutputSink* sink_;
+};
+
+#endif  // LIB_VMWRITER_HPP_
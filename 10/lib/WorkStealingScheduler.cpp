@@ -0,0 +1,162 @@
+// No copyright.
+// Work stealing task scheduler.
+
+#include "WorkStealingScheduler.hpp"
+
+#include <utility>
+
+namespace {
+
+// Set on worker threads only.
+thread_local const WorkStealingScheduler* current_scheduler = nullptr;
+thread_local std::size_t current_index = 0;
+
+}  // namespace
+
+WorkStealingScheduler::WorkStealingScheduler(const std::size_t num_threads) {
+  const auto count = num_threads > 0 ? num_threads : 1;
+  deques_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    deques_.push_back(std::make_unique<TaskDeque>());
+  }
+  workers_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    workers_.emplace_back([this, i] { workerLoop(i); });
+  }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkStealingScheduler::spawn(TaskGroup* group,
+                                  std::function<void()> task) {
+  group->pending_.fetch_add(1, std::memory_order_relaxed);
+  auto index = currentWorker();
+  if (index == deques_.size()) {
+    index = next_deque_.fetch_add(1, std::memory_order_relaxed) %
+            deques_.size();
+  }
+  {
+    auto& deque = *deques_[index];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    deque.tasks.push_back(Task{group, std::move(task)});
+  }
+  queued_.fetch_add(1, std::memory_order_release);
+  {
+    // Orders the increment before a sleeper's predicate check.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wake_.notify_one();
+}
+
+void WorkStealingScheduler::wait(TaskGroup* group) {
+  const auto index = currentWorker();
+  while (group->pending_.load(std::memory_order_acquire) > 0) {
+    Task task;
+    if (popOrSteal(index, &task)) {
+      run(&task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this, group] {
+      return group->pending_.load(std::memory_order_acquire) == 0 ||
+             queued_.load(std::memory_order_acquire) > 0;
+    });
+  }
+
+  std::lock_guard<std::mutex> lock(group->error_mutex_);
+  if (group->error_) {
+    std::rethrow_exception(std::exchange(group->error_, nullptr));
+  }
+}
+
+std::size_t WorkStealingScheduler::threadCountFor(
+    const std::size_t requested) noexcept {
+  if (requested > 0) {
+    return requested;
+  }
+  const auto hardware = std::thread::hardware_concurrency();
+  return hardware > 0 ? hardware : 1;
+}
+
+void WorkStealingScheduler::workerLoop(const std::size_t index) {
+  current_scheduler = this;
+  current_index = index;
+  while (true) {
+    Task task;
+    if (popOrSteal(index, &task)) {
+      run(&task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] {
+      return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+std::size_t WorkStealingScheduler::currentWorker() const noexcept {
+  return current_scheduler == this ? current_index : deques_.size();
+}
+
+bool WorkStealingScheduler::popOrSteal(const std::size_t index, Task* task) {
+  if (queued_.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+
+  if (index < deques_.size()) {
+    auto& own = *deques_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  // Victims are tried starting after the thief, so thieves spread out.
+  const auto start = index < deques_.size() ? index + 1 : 0;
+  for (std::size_t i = 0; i < deques_.size(); ++i) {
+    auto& victim = *deques_[(start + i) % deques_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingScheduler::run(Task* task) {
+  try {
+    task->run();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(task->group->error_mutex_);
+    if (!task->group->error_) {
+      task->group->error_ = std::current_exception();
+    }
+  }
+  // Release the task's captures before its group can be seen as finished.
+  task->run = nullptr;
+
+  if (task->group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_.notify_all();
+  }
+}
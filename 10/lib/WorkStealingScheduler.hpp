@@ -0,0 +1,90 @@
+// No copyright.
+// Work stealing task scheduler.
+
+#ifndef LIB_WORKSTEALINGSCHEDULER_HPP_
+#define LIB_WORKSTEALINGSCHEDULER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks spawned together and waited for together. The first exception one
+// of them throws is rethrown by WorkStealingScheduler::wait().
+class TaskGroup final {
+ public:
+  TaskGroup() = default;
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+  ~TaskGroup() = default;
+
+ private:
+  friend class WorkStealingScheduler;
+
+  std::atomic<std::size_t> pending_{0};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+// Every worker owns a deque: it pushes and pops its own tasks at the back,
+// newest first, and when it runs dry steals the oldest task from the front
+// of another worker's deque. Old tasks are the ones most likely to spawn
+// more work, so a few steals keep every worker busy however uneven the
+// tasks are. Tasks may spawn and wait for further tasks; a waiting thread
+// runs queued tasks instead of blocking.
+class WorkStealingScheduler final {
+ public:
+  explicit WorkStealingScheduler(std::size_t num_threads);
+  WorkStealingScheduler() = delete;
+  WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+  WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+  // Groups must have been waited for.
+  ~WorkStealingScheduler();
+
+  // From a worker the task goes to that worker's deque, from any other
+  // thread the deques are filled round robin.
+  void spawn(TaskGroup* group, std::function<void()> task);
+  // Runs tasks until every task of group has finished.
+  void wait(TaskGroup* group);
+
+  std::size_t size() const noexcept { return workers_.size(); }
+
+  // num_threads for a requested count, 0 meaning one per hardware thread.
+  static std::size_t threadCountFor(std::size_t requested) noexcept;
+
+ private:
+  struct Task {
+    TaskGroup* group = nullptr;
+    std::function<void()> run;
+  };
+
+  struct TaskDeque {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void workerLoop(std::size_t index);
+  // The calling worker's index, or size() on other threads.
+  std::size_t currentWorker() const noexcept;
+  bool popOrSteal(std::size_t index, Task* task);
+  void run(Task* task);
+
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  std::atomic<std::size_t> queued_{0};
+  std::atomic<std::size_t> next_deque_{0};
+
+  // Idle threads sleep until a task is queued or a group finishes.
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  std::vector<std::thread> workers_;
+};
+
+#endif  // LIB_WORKSTEALINGSCHEDULER_HPP_
@@ -0,0 +1,39 @@
+// No copyright.
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "lib/Arena.hpp"
+
+namespace {
+
+struct Pair {
+  std::uint64_t first;
+  char second;
+};
+
+}  // namespace
+
+TEST(ArenaTest, CreateAlignsAndConstructs) {
+  Arena sut(64);
+  auto* c = sut.create<char>('a');
+  auto* pair = sut.create<Pair>(Pair{7, 'b'});
+  EXPECT_EQ(*c, 'a');
+  EXPECT_EQ(pair->first, 7u);
+  EXPECT_EQ(pair->second, 'b');
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(pair) % alignof(Pair), 0u);
+}
+
+TEST(ArenaTest, GrowsAndResets) {
+  Arena sut(64);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(*sut.create<int>(i), i);
+  }
+  auto* large = static_cast<char*>(sut.allocate(1000, 1));
+  large[999] = 'x';
+  EXPECT_EQ(sut.bytesAllocated(), 100 * sizeof(int) + 1000);
+
+  sut.reset();
+  EXPECT_EQ(sut.bytesAllocated(), 0u);
+  EXPECT_EQ(*sut.create<int>(42), 42);
+}
@@ -0,0 +1,47 @@
+// No copyright.
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/CharClassifier.hpp"
+
+TEST(CharClassifierTest, ClassifyBlockMatchesScalarForAllBytes) {
+  std::string bytes;
+  for (int c = 0; c < 256; ++c) {
+    bytes.push_back(static_cast<char>(c));
+  }
+
+  for (std::size_t block = 0; block < bytes.size(); block += kCharBlockSize) {
+    for (const std::size_t size : {kCharBlockSize, std::size_t{17}}) {
+      const auto sut = classifyBlock(bytes.data() + block, size);
+      const auto gt = classifyBlockScalar(bytes.data() + block, size);
+      EXPECT_EQ(sut.symbol, gt.symbol);
+      EXPECT_EQ(sut.whitespace, gt.whitespace);
+      EXPECT_EQ(sut.quote, gt.quote);
+      EXPECT_EQ(sut.identifier, gt.identifier);
+    }
+  }
+}
+
+TEST(CharClassifierTest, ClassifyBlockMasks) {
+  const std::string line = "let x = \"a\";\t";
+  const auto sut = classifyBlock(line.data(), line.size());
+  EXPECT_EQ(sut.symbol, (1u << 6) | (1u << 11));
+  EXPECT_EQ(sut.whitespace, (1u << 3) | (1u << 5) | (1u << 7) | (1u << 12));
+  EXPECT_EQ(sut.quote, (1u << 8) | (1u << 10));
+  EXPECT_EQ(sut.identifier, 0x7u | (1u << 4) | (1u << 9));
+}
+
+TEST(CharClassifierTest, SkipRunsAcrossBlocks) {
+  const std::string source =
+      std::string(100, ' ') + std::string(70, 'a') + "_1;";
+  CharClassifier sut(source.data(), source.data() + source.size());
+
+  const char* identifier_begin = sut.skipWhitespace(source.data());
+  EXPECT_EQ(identifier_begin - source.data(), 100);
+  const char* identifier_end = sut.skipIdentifierChars(identifier_begin);
+  EXPECT_EQ(identifier_end - source.data(), 172);
+  EXPECT_EQ(sut.skipWhitespace(identifier_end), identifier_end);
+  EXPECT_EQ(sut.skipIdentifierChars(source.data() + source.size()),
+            source.data() + source.size());
+}
@@ -3,12 +3,19 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "lib/CompilationEngine.hpp"
 #include "lib/JackDeclarations.hpp"
+#include "lib/StringInterner.hpp"
+#include "lib/SymbolTable.hpp"
 #include "lib/Tokens.hpp"
+#include "lib/VMBackend.hpp"
+#include "lib/VMWriter.hpp"
+#include "lib/WorkStealingScheduler.hpp"
+#include "lib/tests/TestUtil.hpp"
 
 namespace {
 
@@ -16,26 +23,62 @@ class MockTokens : public ITokens {
  public:
   MOCK_CONST_METHOD0(hasMoreTokens, bool());
   MOCK_METHOD(void, advance, (), (noexcept));
-  MOCK_METHOD(TokenType, tokenType, (), (noexcept));
-  MOCK_METHOD(KeyWordType, keyWord, (), (noexcept));
-  MOCK_METHOD(std::string, symbol, (), (noexcept));
-  MOCK_METHOD(int, intVal, (), (noexcept));
-  MOCK_METHOD(std::string, stringVal, (), (noexcept));
-  MOCK_METHOD(std::string, identifier, (), (noexcept));
-
-  MOCK_METHOD(void, recede, (), (noexcept));
+  MOCK_METHOD(TokenType, tokenType, (), (const, noexcept));
+  MOCK_METHOD(KeyWordType, keyWord, (), (const, noexcept));
+  MOCK_METHOD(std::string_view, symbol, (), (const, noexcept));
+  MOCK_METHOD(SymbolType, symbolType, (), (const, noexcept));
+  MOCK_METHOD(int, intVal, (), (const, noexcept));
+  MOCK_METHOD(std::string_view, stringVal, (), (const, noexcept));
+  MOCK_METHOD(std::string_view, identifier, (), (const, noexcept));
+  MOCK_METHOD(IdentifierId, identifierId, (), (const, noexcept));
+
+  MOCK_METHOD(Token, peek, (std::size_t), (const, noexcept));
 };
 
 class MockJackDeclarations : public IJackDeclarations {
  public:
-  MOCK_METHOD(void, addDeclaration, (const std::string&));
-  MOCK_METHOD(bool, isDeclared, (const std::string&));
+  MOCK_METHOD(void, addDeclaration, (IdentifierId));
+  MOCK_METHOD(bool, isDeclared, (IdentifierId));
   MOCK_METHOD(bool, isEmpty, ());
   MOCK_METHOD(void, clear, ());
 };
 
 constexpr char input_file[] = "lib/tests/data/test.jack";
 
+// The ID the token sources give name.
+void expectSymbol(const SymbolTable& symbols, std::string_view name,
+                  SymbolKind kind, std::uint16_t index) {
+  const auto* symbol = symbols.find(idOf(name));
+  ASSERT_NE(symbol, nullptr) << name;
+  EXPECT_EQ(symbol->kind, kind);
+  EXPECT_EQ(symbol->index, index);
+}
+
+std::string tokensXML(const ParseEventLog& log) {
+  StringSink sink;
+  writeXMLTokens(log, &sink);
+  return sink.output;
+}
+
+std::string treeXML(const ParseEventLog& log) {
+  StringSink sink;
+  writeTreeXML(log, &sink);
+  return sink.output;
+}
+
+// A class with a field and three subroutines, one of them nesting blocks.
+const std::vector<std::string> kClassTokens = {
+    "class", "C", "{", "field", "int", "n", ";",
+    "constructor", "C", "new", "(", ")", "{", "let", "n", "=", "0", ";",
+    "return", "this", ";", "}",
+    "method", "int", "f", "(", "int", "a", ")", "{", "var", "int", "i", ";",
+    "while", "(", "i", "<", "a", ")", "{", "if", "(", "n", ")", "{", "let",
+    "i", "=", "i", "+", "1", ";", "}", "}", "return", "i", ";", "}",
+    "function", "void", "g", "(", ")", "{", "do", "C", ".", "h", "(", ")",
+    ";", "return", ";", "}",
+    "}",
+};
+
 }  // namespace
 
 using ::testing::_;
@@ -54,8 +97,6 @@ TEST(CompilationEngineTest, CompileKeywordConstantOk) {
     EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
     CompilationEngine sut("./dummy.xml", std::move(m),
-                          std::make_unique<MockJackDeclarations>(),
-                          std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>());
     sut.compileKeywordConstant();
@@ -76,8 +117,6 @@ TEST(CompilationEngineTest, CompileKeywordConstantThrow) {
   auto m = std::make_unique<MockTokens>();
   EXPECT_CALL(*m, keyWord()).WillOnce(Return(KeyWordType::kBoolean));
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   EXPECT_THROW(sut.compileKeywordConstant(), std::runtime_error);
@@ -87,12 +126,11 @@ TEST(CompilationEngineTest, CompileUnaryOpOk) {
   for (const auto unary : {"-", "~"}) {
     auto m = std::make_unique<MockTokens>();
     EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kSymbol));
-    EXPECT_CALL(*m, symbol()).WillRepeatedly(Return(unary));
+    EXPECT_CALL(*m, symbolType())
+        .WillRepeatedly(Return(symbolTypeOf(unary[0])));
     EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
     CompilationEngine sut("./dummy.xml", std::move(m),
-                          std::make_unique<MockJackDeclarations>(),
-                          std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>());
     sut.compileUnaryOp();
@@ -112,10 +150,8 @@ TEST(CompilationEngineTest, CompileUnaryOpOk) {
 TEST(CompilationEngineTest, CompileUnaryOpThrow1) {
   auto m = std::make_unique<MockTokens>();
   EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kSymbol));
-  EXPECT_CALL(*m, symbol()).WillRepeatedly(Return("/"));
+  EXPECT_CALL(*m, symbolType()).WillRepeatedly(Return(SymbolType::kSlash));
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   EXPECT_THROW(sut.compileUnaryOp(), std::runtime_error);
@@ -125,8 +161,6 @@ TEST(CompilationEngineTest, CompileUnaryOpThrow2) {
   auto m = std::make_unique<MockTokens>();
   EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kKeyWord));
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   EXPECT_THROW(sut.compileUnaryOp(), std::runtime_error);
@@ -136,12 +170,11 @@ TEST(CompilationEngineTest, CompileOpOk) {
   for (const auto op : {"*", "-", "*", "/", "&", "|", "<", ">", "="}) {
     auto m = std::make_unique<MockTokens>();
     EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kSymbol));
-    EXPECT_CALL(*m, symbol()).WillRepeatedly(Return(op));
+    EXPECT_CALL(*m, symbolType())
+        .WillRepeatedly(Return(symbolTypeOf(op[0])));
     EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
     CompilationEngine sut("./dummy.xml", std::move(m),
-                          std::make_unique<MockJackDeclarations>(),
-                          std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>());
     sut.compileOp();
@@ -161,10 +194,8 @@ TEST(CompilationEngineTest, CompileOpOk) {
 TEST(CompilationEngineTest, CompileOpThrow1) {
   auto m = std::make_unique<MockTokens>();
   EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kSymbol));
-  EXPECT_CALL(*m, symbol()).WillRepeatedly(Return("~"));
+  EXPECT_CALL(*m, symbolType()).WillRepeatedly(Return(SymbolType::kTilde));
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   EXPECT_THROW(sut.compileOp(), std::runtime_error);
@@ -174,8 +205,6 @@ TEST(CompilationEngineTest, CompileOpThrow2) {
   auto m = std::make_unique<MockTokens>();
   EXPECT_CALL(*m, tokenType()).WillOnce(Return(TokenType::kKeyWord));
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   EXPECT_THROW(sut.compileOp(), std::runtime_error);
@@ -189,8 +218,6 @@ TEST(CompilationEngineTest, CompileTermInteger) {
     EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
     CompilationEngine sut("./dummy.xml", std::move(m),
-                          std::make_unique<MockJackDeclarations>(),
-                          std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>(),
                           std::make_unique<MockJackDeclarations>());
     sut.compileTerm();
@@ -215,8 +242,6 @@ TEST(CompilationEngineTest, CompileTermString) {
   EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   sut.compileTerm();
@@ -239,8 +264,6 @@ TEST(CompilationEngineTest, CompileTermKeyword) {
   EXPECT_CALL(*m, hasMoreTokens()).WillOnce(Return(false));
 
   CompilationEngine sut("./dummy.xml", std::move(m),
-                        std::make_unique<MockJackDeclarations>(),
-                        std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>(),
                         std::make_unique<MockJackDeclarations>());
   sut.compileTerm();
@@ -259,21 +282,17 @@ TEST(CompilationEngineTest, CompileTermKeyword) {
 TEST(CompilationEngineTest, CompileTermVarName) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"variable_name"};
   const std::vector<std::string> kVarNames{"variable_name"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  dummy_declarations->addDeclaration(kTokens[0]);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  sut.symbols().define(idOf(kTokens[0]), idOf("int"), SymbolKind::kLocal);
   sut.compileTerm();
   sut.writeXMLTokens();
 
@@ -289,23 +308,19 @@ TEST(CompilationEngineTest, CompileTermVarName) {
 TEST(CompilationEngineTest, CompileTermVarNameSquareBracket) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kVarNames{"variable_name"};
   const std::vector<std::string> kTokens{"variable_name", "[", "1", "]"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& var_name : kVarNames) {
-    dummy_declarations->addDeclaration(var_name);
-  }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  for (const auto& var_name : kVarNames) {
+    sut.symbols().define(idOf(var_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileTerm();
   sut.writeXMLTokens();
 
@@ -326,11 +341,7 @@ TEST(CompilationEngineTest, CompileTermVarNameSquareBracket) {
 
 TEST(CompilationEngineTest, CompileTermSubroutineCall) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kSubroutineNames{"subroutine_name"};
@@ -338,12 +349,11 @@ TEST(CompilationEngineTest, CompileTermSubroutineCall) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   auto dummy_declarations = std::make_unique<JackDeclarations>();
   for (const auto& subroutine_name : kSubroutineNames) {
-    dummy_declarations->addDeclaration(subroutine_name);
+    dummy_declarations->addDeclaration(idOf(subroutine_name));
   }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(dummy_declarations),
-                        std::move(m3));
+                        std::move(dummy_declarations));
   sut.compileTerm();
   sut.writeXMLTokens();
 
@@ -362,20 +372,16 @@ TEST(CompilationEngineTest, CompileTermSubroutineCall) {
 
 TEST(CompilationEngineTest, CompileTermCurlyBracket) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"(", "1", ")"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileTerm();
   sut.writeXMLTokens();
 
@@ -394,20 +400,16 @@ TEST(CompilationEngineTest, CompileTermCurlyBracket) {
 
 TEST(CompilationEngineTest, CompileTermUnaryOp) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"-", "1"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileTerm();
   sut.writeXMLTokens();
 
@@ -424,20 +426,16 @@ TEST(CompilationEngineTest, CompileTermUnaryOp) {
 
 TEST(CompilationEngineTest, CompileExpressionSingleTerm) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"1"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileExpression();
   sut.writeXMLTokens();
 
@@ -452,20 +450,16 @@ TEST(CompilationEngineTest, CompileExpressionSingleTerm) {
 
 TEST(CompilationEngineTest, CompileExpressionTwoTerms) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"2", "-", "1"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileExpression();
   sut.writeXMLTokens();
 
@@ -484,20 +478,16 @@ TEST(CompilationEngineTest, CompileExpressionTwoTerms) {
 
 TEST(CompilationEngineTest, CompileExpressionListZero) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileExpressionList();
   sut.writeXMLTokens();
 
@@ -510,20 +500,16 @@ TEST(CompilationEngineTest, CompileExpressionListZero) {
 
 TEST(CompilationEngineTest, CompileExpressionListOne) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"1", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileExpressionList();
   sut.writeXMLTokens();
 
@@ -538,20 +524,16 @@ TEST(CompilationEngineTest, CompileExpressionListOne) {
 
 TEST(CompilationEngineTest, CompileExpressionListTwo) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"1", "+", "2", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileExpressionList();
   sut.writeXMLTokens();
 
@@ -570,11 +552,7 @@ TEST(CompilationEngineTest, CompileExpressionListTwo) {
 
 TEST(CompilationEngineTest, CompileSubroutineCall) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kSubroutineNames{"subroutine_name"};
@@ -582,12 +560,11 @@ TEST(CompilationEngineTest, CompileSubroutineCall) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   auto dummy_declarations = std::make_unique<JackDeclarations>();
   for (const auto& subroutine_name : kSubroutineNames) {
-    dummy_declarations->addDeclaration(subroutine_name);
+    dummy_declarations->addDeclaration(idOf(subroutine_name));
   }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(dummy_declarations),
-                        std::move(m3));
+                        std::move(dummy_declarations));
   sut.compileSubroutineCall();
   sut.writeXMLTokens();
 
@@ -607,9 +584,7 @@ TEST(CompilationEngineTest, CompileSubroutineCall) {
 
 TEST(CompilationEngineTest, CompileSubroutineCallMember) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kVariableNames{"variable_name"};
@@ -617,19 +592,16 @@ TEST(CompilationEngineTest, CompileSubroutineCallMember) {
   const std::vector<std::string> kTokens{"variable_name", ".",
                                          "subroutine_name", "(", ")"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
-  auto dummy_variable_declarations = std::make_unique<JackDeclarations>();
   auto dummy_subroutine_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& variable_name : kVariableNames) {
-    dummy_variable_declarations->addDeclaration(variable_name);
-  }
   for (const auto& subroutine_name : kSubroutineNames) {
-    dummy_subroutine_declarations->addDeclaration(subroutine_name);
+    dummy_subroutine_declarations->addDeclaration(idOf(subroutine_name));
   }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_variable_declarations),
-                        std::move(dummy_subroutine_declarations),
-                        std::move(m2));
+                        std::move(dummy_subroutine_declarations));
+  for (const auto& variable_name : kVariableNames) {
+    sut.symbols().define(idOf(variable_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileSubroutineCall();
   sut.writeXMLTokens();
 
@@ -651,22 +623,50 @@ TEST(CompilationEngineTest, CompileSubroutineCallMember) {
   EXPECT_FALSE(std::getline(output, line));
 }
 
+TEST(CompilationEngineTest, CompileSubroutineCallOtherClass) {
+  auto m1 = std::make_unique<MockJackDeclarations>();
+  auto m3 = std::make_unique<MockJackDeclarations>();
+  EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
+  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
+
+  // TODO(me): Use mock?
+  const std::vector<std::string> kTokens{"Output", ".", "println", "(", ")"};
+  auto dummy_tokens = std::make_unique<Tokens>(kTokens);
+
+  CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
+                        std::move(m3));
+  sut.compileSubroutineCall();
+  sut.writeXMLTokens();
+
+  std::ifstream output("./dummy.xml");
+  EXPECT_TRUE(output);
+
+  std::string line;
+  std::getline(output, line);
+  EXPECT_EQ(line, "<identifier> Output </identifier>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> . </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<identifier> println </identifier>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> ( </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> ) </symbol>");
+  EXPECT_FALSE(std::getline(output, line));
+}
+
 TEST(CompilationEngineTest, CompileReturnStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"return", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileReturn();
   sut.writeXMLTokens();
 
@@ -683,20 +683,16 @@ TEST(CompilationEngineTest, CompileReturnStatement) {
 
 TEST(CompilationEngineTest, CompileReturnStatementExpression) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"return", "1", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileReturn();
   sut.writeXMLTokens();
 
@@ -715,11 +711,7 @@ TEST(CompilationEngineTest, CompileReturnStatementExpression) {
 
 TEST(CompilationEngineTest, CompileDoStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"do", "subroutine_name", "(", ")",
@@ -728,12 +720,11 @@ TEST(CompilationEngineTest, CompileDoStatement) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   auto dummy_declarations = std::make_unique<JackDeclarations>();
   for (const auto& subroutine_name : kSubroutineNames) {
-    dummy_declarations->addDeclaration(subroutine_name);
+    dummy_declarations->addDeclaration(idOf(subroutine_name));
   }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(dummy_declarations),
-                        std::move(m3));
+                        std::move(dummy_declarations));
   sut.compileDo();
   sut.writeXMLTokens();
 
@@ -756,11 +747,7 @@ TEST(CompilationEngineTest, CompileDoStatement) {
 
 TEST(CompilationEngineTest, CompileStatementToDo) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"do", "subroutine_name", "(", ")",
@@ -769,12 +756,11 @@ TEST(CompilationEngineTest, CompileStatementToDo) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   auto dummy_declarations = std::make_unique<JackDeclarations>();
   for (const auto& subroutine_name : kSubroutineNames) {
-    dummy_declarations->addDeclaration(subroutine_name);
+    dummy_declarations->addDeclaration(idOf(subroutine_name));
   }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(dummy_declarations),
-                        std::move(m3));
+                        std::move(dummy_declarations));
   sut.compileStatement();
   sut.writeXMLTokens();
 
@@ -797,13 +783,9 @@ TEST(CompilationEngineTest, CompileStatementToDo) {
 
 TEST(CompilationEngineTest, CompileWhileStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"while", "(",      "true", ")",
@@ -811,7 +793,7 @@ TEST(CompilationEngineTest, CompileWhileStatement) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileWhile();
   sut.writeXMLTokens();
 
@@ -840,13 +822,9 @@ TEST(CompilationEngineTest, CompileWhileStatement) {
 
 TEST(CompilationEngineTest, CompileStatementToWhile) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"while", "(",      "true", ")",
@@ -854,7 +832,7 @@ TEST(CompilationEngineTest, CompileStatementToWhile) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileStatement();
   sut.writeXMLTokens();
 
@@ -883,13 +861,9 @@ TEST(CompilationEngineTest, CompileStatementToWhile) {
 
 TEST(CompilationEngineTest, CompileIfStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"if", "(",      "true", ")",
@@ -897,7 +871,7 @@ TEST(CompilationEngineTest, CompileIfStatement) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileIf();
   sut.writeXMLTokens();
 
@@ -926,13 +900,9 @@ TEST(CompilationEngineTest, CompileIfStatement) {
 
 TEST(CompilationEngineTest, CompileStatementToIf) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"if", "(",      "true", ")",
@@ -940,7 +910,7 @@ TEST(CompilationEngineTest, CompileStatementToIf) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileStatement();
   sut.writeXMLTokens();
 
@@ -969,13 +939,9 @@ TEST(CompilationEngineTest, CompileStatementToIf) {
 
 TEST(CompilationEngineTest, CompileIfElseStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"if",     "(", "true", ")",    "{",
@@ -984,7 +950,7 @@ TEST(CompilationEngineTest, CompileIfElseStatement) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileIf();
   sut.writeXMLTokens();
 
@@ -1024,23 +990,19 @@ TEST(CompilationEngineTest, CompileIfElseStatement) {
 TEST(CompilationEngineTest, CompileLetStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"let", "variable_name", "=", "1", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   const std::vector<std::string> kVarNames{"variable_name"};
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& variable_name : kVarNames) {
-    dummy_declarations->addDeclaration(variable_name);
-  }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  for (const auto& variable_name : kVarNames) {
+    sut.symbols().define(idOf(variable_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileLet();
   sut.writeXMLTokens();
 
@@ -1064,24 +1026,20 @@ TEST(CompilationEngineTest, CompileLetStatement) {
 TEST(CompilationEngineTest, CompileLetBrakectStatement) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{
       "let", "variable_name", "[", "2", "]", "=", "1", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   const std::vector<std::string> kVarNames{"variable_name"};
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& variable_name : kVarNames) {
-    dummy_declarations->addDeclaration(variable_name);
-  }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  for (const auto& variable_name : kVarNames) {
+    sut.symbols().define(idOf(variable_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileLet();
   sut.writeXMLTokens();
 
@@ -1111,23 +1069,19 @@ TEST(CompilationEngineTest, CompileLetBrakectStatement) {
 TEST(CompilationEngineTest, CompileStatementToLet) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"let", "variable_name", "=", "1", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   const std::vector<std::string> kVarNames{"variable_name"};
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& variable_name : kVarNames) {
-    dummy_declarations->addDeclaration(variable_name);
-  }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  for (const auto& variable_name : kVarNames) {
+    sut.symbols().define(idOf(variable_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileStatement();
   sut.writeXMLTokens();
 
@@ -1151,24 +1105,20 @@ TEST(CompilationEngineTest, CompileStatementToLet) {
 TEST(CompilationEngineTest, CompileStatements) {
   auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{
       "let", "variable_name", "=", "1", ";", "return", "variable_name", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
   const std::vector<std::string> kVarNames{"variable_name"};
-  auto dummy_declarations = std::make_unique<JackDeclarations>();
-  for (const auto& variable_name : kVarNames) {
-    dummy_declarations->addDeclaration(variable_name);
-  }
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(dummy_declarations), std::move(m2),
-                        std::move(m3));
+                        std::move(m2));
+  for (const auto& variable_name : kVarNames) {
+    sut.symbols().define(idOf(variable_name), idOf("int"), SymbolKind::kLocal);
+  }
   sut.compileStatements();
   sut.writeXMLTokens();
 
@@ -1195,22 +1145,108 @@ TEST(CompilationEngineTest, CompileStatements) {
   EXPECT_FALSE(std::getline(output, line));
 }
 
-TEST(CompilationEngineTest, CompileStatementsNothing) {
+TEST(CompilationEngineTest, CompileStatementsWhile) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
+  EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
+  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
+
+  // TODO(me): Use mock?
+  const std::vector<std::string> kTokens{"while", "(", "true", ")",
+                                         "{",     "}", "return", ";"};
+  auto dummy_tokens = std::make_unique<Tokens>(kTokens);
+
+  CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
+                        std::move(m3));
+  sut.compileStatements();
+  sut.writeXMLTokens();
+
+  std::ifstream output("./dummy.xml");
+  EXPECT_TRUE(output);
+
+  std::string line;
+  std::getline(output, line);
+  EXPECT_EQ(line, "<keyword> while </keyword>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> ( </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<keyword> true </keyword>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> ) </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> { </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> } </symbol>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<keyword> return </keyword>");
+  std::getline(output, line);
+  EXPECT_EQ(line, "<symbol> ; </symbol>");
+  EXPECT_FALSE(std::getline(output, line));
+}
+
+TEST(CompilationEngineTest, SyntaxTreeOfLetStatement) {
+  auto m1 = std::make_unique<MockJackDeclarations>();
+  auto m2 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
+
+  // TODO(me): Use mock?
+  const std::vector<std::string> kTokens{"let", "x", "=", "-", "1", ";"};
+  auto dummy_tokens = std::make_unique<Tokens>(kTokens);
+
+  CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
+                        std::move(m2));
+  sut.symbols().define(idOf("x"), idOf("int"), SymbolKind::kLocal);
+  sut.compileStatements();
+
+  const auto& root = sut.syntaxTree();
+  EXPECT_EQ(root.kind, NodeKind::kFragment);
+  const auto* statements = root.first_child;
+  ASSERT_NE(statements, nullptr);
+  EXPECT_EQ(statements->kind, NodeKind::kStatements);
+  EXPECT_EQ(statements->next_sibling, nullptr);
+  const auto* let = statements->first_child;
+  ASSERT_NE(let, nullptr);
+  EXPECT_EQ(let->kind, NodeKind::kLetStatement);
+
+  std::vector<NodeKind> let_children;
+  const SyntaxNode* expression = nullptr;
+  for (auto* child = let->first_child; child; child = child->next_sibling) {
+    let_children.push_back(child->kind);
+    if (child->kind == NodeKind::kExpression) {
+      expression = child;
+    }
+  }
+  EXPECT_EQ(let_children,
+            (std::vector<NodeKind>{NodeKind::kTerminal, NodeKind::kTerminal,
+                                   NodeKind::kTerminal, NodeKind::kExpression,
+                                   NodeKind::kTerminal}));
+  EXPECT_EQ(let->first_child->next_sibling->text, "x");
+
+  // expression -> term -> ('-' term -> integerConstant).
+  ASSERT_NE(expression, nullptr);
+  const auto* term = expression->first_child;
+  ASSERT_EQ(term->kind, NodeKind::kTerm);
+  EXPECT_TRUE(term->first_child->isTerminal());
+  EXPECT_EQ(term->first_child->text, "-");
+  const auto* inner_term = term->first_child->next_sibling;
+  ASSERT_EQ(inner_term->kind, NodeKind::kTerm);
+  EXPECT_EQ(inner_term->first_child->token_type, TokenType::kIntConst);
+  EXPECT_EQ(inner_term->first_child->subtype, 1);
+}
+
+TEST(CompilationEngineTest, CompileStatementsNothing) {
+  auto m1 = std::make_unique<MockJackDeclarations>();
+  auto m3 = std::make_unique<MockJackDeclarations>();
+  EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{")"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileStatements();
   sut.writeXMLTokens();
 
@@ -1223,23 +1259,19 @@ TEST(CompilationEngineTest, CompileStatementsNothing) {
 
 TEST(CompilationEngineTest, CompileVarDec) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"var", "int", "variable_name", ";"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileVarDec();
+  expectSymbol(sut.symbols(), "variable_name", SymbolKind::kLocal, 0);
+  EXPECT_EQ(sut.symbols().find(idOf("variable_name"))->type, idOf("int"));
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1259,16 +1291,9 @@ TEST(CompilationEngineTest, CompileVarDec) {
 
 TEST(CompilationEngineTest, CompileVarDecMultiple) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name_1")).Times(1);
-  EXPECT_CALL(*m4, addDeclaration("variable_name_2")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{
@@ -1276,8 +1301,10 @@ TEST(CompilationEngineTest, CompileVarDecMultiple) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileVarDec();
+  expectSymbol(sut.symbols(), "variable_name_1", SymbolKind::kLocal, 0);
+  expectSymbol(sut.symbols(), "variable_name_2", SymbolKind::kLocal, 1);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1301,20 +1328,16 @@ TEST(CompilationEngineTest, CompileVarDecMultiple) {
 
 TEST(CompilationEngineTest, CompileSubroutineBodyNoDec) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"{", "return", ";", "}"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileSubroutineBody();
   sut.writeXMLTokens();
 
@@ -1335,15 +1358,9 @@ TEST(CompilationEngineTest, CompileSubroutineBodyNoDec) {
 
 TEST(CompilationEngineTest, CompileSubroutineBodyOneDec) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"{", "var",    "int", "variable_name",
@@ -1351,8 +1368,9 @@ TEST(CompilationEngineTest, CompileSubroutineBodyOneDec) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileSubroutineBody();
+  expectSymbol(sut.symbols(), "variable_name", SymbolKind::kLocal, 0);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1380,16 +1398,9 @@ TEST(CompilationEngineTest, CompileSubroutineBodyOneDec) {
 
 TEST(CompilationEngineTest, CompileSubroutineBodyTwoDec) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name_1")).Times(1);
-  EXPECT_CALL(*m4, addDeclaration("variable_name_2")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{
@@ -1398,8 +1409,10 @@ TEST(CompilationEngineTest, CompileSubroutineBodyTwoDec) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileSubroutineBody();
+  expectSymbol(sut.symbols(), "variable_name_1", SymbolKind::kLocal, 0);
+  expectSymbol(sut.symbols(), "variable_name_2", SymbolKind::kLocal, 1);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1431,20 +1444,16 @@ TEST(CompilationEngineTest, CompileSubroutineBodyTwoDec) {
 
 TEST(CompilationEngineTest, CompileParameterListZero) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{")"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileParameterList();
   sut.writeXMLTokens();
 
@@ -1457,23 +1466,18 @@ TEST(CompilationEngineTest, CompileParameterListZero) {
 
 TEST(CompilationEngineTest, CompileParameterListOne) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"int", "variable_name"};
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileParameterList();
+  expectSymbol(sut.symbols(), "variable_name", SymbolKind::kArgument, 0);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1489,16 +1493,9 @@ TEST(CompilationEngineTest, CompileParameterListOne) {
 
 TEST(CompilationEngineTest, CompileParameterListTwo) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-  EXPECT_CALL(*m4, addDeclaration("variable_name_1")).Times(1);
-  EXPECT_CALL(*m4, addDeclaration("variable_name_2")).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> kTokens{"int", "variable_name_1", ",", "int",
@@ -1506,8 +1503,10 @@ TEST(CompilationEngineTest, CompileParameterListTwo) {
   auto dummy_tokens = std::make_unique<Tokens>(kTokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileParameterList();
+  expectSymbol(sut.symbols(), "variable_name_1", SymbolKind::kArgument, 0);
+  expectSymbol(sut.symbols(), "variable_name_2", SymbolKind::kArgument, 1);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1532,18 +1531,11 @@ TEST(CompilationEngineTest, CompileSubroutineDec) {
        {"constructor", "function", "method"}) {
     for (const std::string& var_type : {"void", "int"}) {
       auto m1 = std::make_unique<MockJackDeclarations>();
-      auto m2 = std::make_unique<MockJackDeclarations>();
       auto m3 = std::make_unique<MockJackDeclarations>();
-      auto m4 = std::make_unique<MockJackDeclarations>();
       EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-      EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
       EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-      EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
-      EXPECT_CALL(*m3, addDeclaration("subroutine_name")).Times(1);
-      EXPECT_CALL(*m4, isEmpty).WillOnce(Return(true));
-      EXPECT_CALL(*m4, addDeclaration("variable_name")).Times(1);
-      EXPECT_CALL(*m4, clear).Times(1);
+      EXPECT_CALL(*m3, addDeclaration(idOf("subroutine_name"))).Times(1);
 
       // TODO(me): Use mock?
       const std::vector<std::string> tokens{
@@ -1562,9 +1554,11 @@ TEST(CompilationEngineTest, CompileSubroutineDec) {
       auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
       CompilationEngine sut("./dummy.xml", std::move(dummy_tokens),
-                            std::move(m1), std::move(m2), std::move(m3),
-                            std::move(m4));
+                            std::move(m1), std::move(m3));
       sut.compileSubroutine();
+      // The subroutine scope ends with the subroutine.
+      EXPECT_EQ(sut.symbols().find(idOf("variable_name")), nullptr);
+      EXPECT_EQ(sut.symbols().scopeDepth(), 0u);
       sut.writeXMLTokens();
 
       std::ifstream output("./dummy.xml");
@@ -1601,20 +1595,16 @@ TEST(CompilationEngineTest, CompileSubroutineDec) {
 TEST(CompilationEngineTest, CompileTypePrimitive) {
   for (const std::string& type_name : {"int", "char", "boolean"}) {
     auto m1 = std::make_unique<MockJackDeclarations>();
-    auto m2 = std::make_unique<MockJackDeclarations>();
     auto m3 = std::make_unique<MockJackDeclarations>();
-    auto m4 = std::make_unique<MockJackDeclarations>();
     EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
     EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
     // TODO(me): Use mock?
     const std::vector<std::string> tokens{type_name};
     auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
     CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                          std::move(m2), std::move(m3), std::move(m4));
+                          std::move(m3));
     sut.compileType();
     sut.writeXMLTokens();
 
@@ -1629,22 +1619,17 @@ TEST(CompilationEngineTest, CompileTypePrimitive) {
 }
 
 TEST(CompilationEngineTest, CompileTypeClassName) {
-  auto m1 = std::make_unique<MockJackDeclarations>();
   auto m2 = std::make_unique<MockJackDeclarations>();
-  auto m3 = std::make_unique<MockJackDeclarations>();
-  EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
 
   // TODO(me): Use mock?
   const std::vector<std::string> tokens{"class_name"};
   auto dummy_tokens = std::make_unique<Tokens>(tokens);
   auto dummy_declarations = std::make_unique<JackDeclarations>();
-  dummy_declarations->addDeclaration(tokens[0]);
+  dummy_declarations->addDeclaration(idOf(tokens[0]));
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens),
-                        std::move(dummy_declarations), std::move(m1),
-                        std::move(m2), std::move(m3));
+                        std::move(dummy_declarations), std::move(m2));
   sut.compileType();
   sut.writeXMLTokens();
 
@@ -1660,15 +1645,9 @@ TEST(CompilationEngineTest, CompileTypeClassName) {
 TEST(CompilationEngineTest, CompileClassVarDec) {
   for (const std::string& class_var_type : {"static", "field"}) {
     auto m1 = std::make_unique<MockJackDeclarations>();
-    auto m2 = std::make_unique<MockJackDeclarations>();
     auto m3 = std::make_unique<MockJackDeclarations>();
-    auto m4 = std::make_unique<MockJackDeclarations>();
     EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
     EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-    EXPECT_CALL(*m2, addDeclaration("variable_name")).Times(1);
 
     // TODO(me): Use mock?
     const std::vector<std::string> tokens{class_var_type, "int",
@@ -1676,8 +1655,11 @@ TEST(CompilationEngineTest, CompileClassVarDec) {
     auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
     CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                          std::move(m2), std::move(m3), std::move(m4));
+                          std::move(m3));
     sut.compileClassVarDec();
+    const auto kind = class_var_type == "static" ? SymbolKind::kStatic
+                                                 : SymbolKind::kField;
+    expectSymbol(sut.symbols(), "variable_name", kind, 0);
     sut.writeXMLTokens();
 
     std::ifstream output("./dummy.xml");
@@ -1699,16 +1681,9 @@ TEST(CompilationEngineTest, CompileClassVarDec) {
 TEST(CompilationEngineTest, CompileClassVarDecMultiple) {
   for (const std::string& class_var_type : {"static", "field"}) {
     auto m1 = std::make_unique<MockJackDeclarations>();
-    auto m2 = std::make_unique<MockJackDeclarations>();
     auto m3 = std::make_unique<MockJackDeclarations>();
-    auto m4 = std::make_unique<MockJackDeclarations>();
     EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
     EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-    EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
-
-    EXPECT_CALL(*m2, addDeclaration("variable_name_1")).Times(1);
-    EXPECT_CALL(*m2, addDeclaration("variable_name_2")).Times(1);
 
     // TODO(me): Use mock?
     const std::vector<std::string> tokens{
@@ -1716,8 +1691,12 @@ TEST(CompilationEngineTest, CompileClassVarDecMultiple) {
     auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
     CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                          std::move(m2), std::move(m3), std::move(m4));
+                          std::move(m3));
     sut.compileClassVarDec();
+    const auto kind = class_var_type == "static" ? SymbolKind::kStatic
+                                                 : SymbolKind::kField;
+    expectSymbol(sut.symbols(), "variable_name_1", kind, 0);
+    expectSymbol(sut.symbols(), "variable_name_2", kind, 1);
     sut.writeXMLTokens();
 
     std::ifstream output("./dummy.xml");
@@ -1742,22 +1721,18 @@ TEST(CompilationEngineTest, CompileClassVarDecMultiple) {
 
 TEST(CompilationEngineTest, CompileClassEmpty) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
-  EXPECT_CALL(*m1, addDeclaration("class_name")).Times(1);
+  EXPECT_CALL(*m1, addDeclaration(idOf("class_name"))).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> tokens{"class", "class_name", "{", "}"};
   auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileClass();
   sut.writeXMLTokens();
 
@@ -1778,19 +1753,12 @@ TEST(CompilationEngineTest, CompileClassEmpty) {
 
 TEST(CompilationEngineTest, CompileClassOneEach) {
   auto m1 = std::make_unique<MockJackDeclarations>();
-  auto m2 = std::make_unique<MockJackDeclarations>();
   auto m3 = std::make_unique<MockJackDeclarations>();
-  auto m4 = std::make_unique<MockJackDeclarations>();
   EXPECT_CALL(*m1, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m2, isDeclared(_)).WillRepeatedly(Return(false));
   EXPECT_CALL(*m3, isDeclared(_)).WillRepeatedly(Return(false));
-  EXPECT_CALL(*m4, isDeclared(_)).WillRepeatedly(Return(false));
 
-  EXPECT_CALL(*m1, addDeclaration("class_name")).Times(1);
-  EXPECT_CALL(*m2, addDeclaration("class_variable_name")).Times(1);
-  EXPECT_CALL(*m3, addDeclaration("subroutine_name")).Times(1);
-  EXPECT_CALL(*m4, isEmpty()).WillOnce(Return(true));
-  EXPECT_CALL(*m4, clear()).Times(1);
+  EXPECT_CALL(*m1, addDeclaration(idOf("class_name"))).Times(1);
+  EXPECT_CALL(*m3, addDeclaration(idOf("subroutine_name"))).Times(1);
 
   // TODO(me): Use mock?
   const std::vector<std::string> tokens{
@@ -1806,8 +1774,9 @@ TEST(CompilationEngineTest, CompileClassOneEach) {
   auto dummy_tokens = std::make_unique<Tokens>(tokens);
 
   CompilationEngine sut("./dummy.xml", std::move(dummy_tokens), std::move(m1),
-                        std::move(m2), std::move(m3), std::move(m4));
+                        std::move(m3));
   sut.compileClass();
+  expectSymbol(sut.symbols(), "class_variable_name", SymbolKind::kStatic, 0);
   sut.writeXMLTokens();
 
   std::ifstream output("./dummy.xml");
@@ -1846,3 +1815,233 @@ TEST(CompilationEngineTest, CompileClassOneEach) {
   EXPECT_EQ(line, "<symbol> } </symbol>");
   EXPECT_FALSE(std::getline(output, line));
 }
+
+TEST(CompilationEngineTest, CompileClassParallelMatchesSequential) {
+  ConcreteCompilationEngine sequential("./dummy.xml",
+                                       std::make_unique<Tokens>(kClassTokens));
+  sequential.compileClass();
+
+  WorkStealingScheduler scheduler(3);
+  ConcreteCompilationEngine sut("./dummy.xml",
+                                std::make_unique<Tokens>(kClassTokens));
+  sut.compileClassParallel(&scheduler);
+
+  EXPECT_EQ(treeXML(sut.parseEvents()), treeXML(sequential.parseEvents()));
+}
+
+TEST(CompilationEngineTest, CompileClassParallelFirstErrorInSource) {
+  // Both methods are invalid, whichever fails first the first one is
+  // reported.
+  const std::vector<std::string> tokens = {
+      "class", "C", "{",
+      "method", "void", "f", "(", ")", "{", "let", "x", "=", "1", ";", "}",
+      "method", "void", "g", "(", ")", "{", "let", "2", "=", "1", ";", "}",
+      "}",
+  };
+  WorkStealingScheduler scheduler(2);
+  for (int i = 0; i < 20; ++i) {
+    ConcreteCompilationEngine sut("./dummy.xml",
+                                  std::make_unique<Tokens>(tokens));
+    try {
+      sut.compileClassParallel(&scheduler);
+      FAIL();
+    } catch (const std::runtime_error& e) {
+      EXPECT_STREQ(e.what(), "undefined varName");
+    }
+  }
+
+  // Unbalanced braces are found before any subroutine is parsed.
+  ConcreteCompilationEngine unbalanced(
+      "./dummy.xml",
+      std::make_unique<Tokens>(std::vector<std::string>{
+          "class", "C", "{", "function", "void", "f", "(", ")", "{", "}"}));
+  EXPECT_THROW(unbalanced.compileClassParallel(&scheduler),
+               std::runtime_error);
+}
+
+TEST(CompilationEngineTest, CompileClassOutlineSkipsBodies) {
+  ConcreteCompilationEngine full("./dummy.xml",
+                                 std::make_unique<Tokens>(kClassTokens));
+  full.compileClass();
+  ConcreteCompilationEngine sut("./dummy.xml",
+                                std::make_unique<Tokens>(kClassTokens));
+  sut.compileClassOutline();
+
+  int subroutines = 0;
+  for (const auto& event : sut.parseEvents().events()) {
+    EXPECT_NE(event.nodeKind(), NodeKind::kSubroutineBody);
+    if (event.kind == ParseEventKind::kBeginNode &&
+        event.nodeKind() == NodeKind::kSubroutineDec) {
+      ++subroutines;
+    }
+  }
+  EXPECT_EQ(subroutines, 3);
+  const auto outline = tokensXML(sut.parseEvents());
+  EXPECT_NE(outline.find("<identifier> f </identifier>\n"
+                         "<symbol> ( </symbol>\n"
+                         "<keyword> int </keyword>\n"
+                         "<identifier> a </identifier>\n"
+                         "<symbol> ) </symbol>\n"
+                         "<keyword> function </keyword>\n"),
+            std::string::npos);
+
+  // Bodies parse on demand to what the full parse produced.
+  ASSERT_EQ(sut.outlinedSubroutines().size(), 3u);
+  std::string subroutines_xml;
+  for (std::size_t i = 0; i < 3; ++i) {
+    subroutines_xml += tokensXML(sut.compileOutlinedSubroutine(i));
+  }
+  const auto full_xml = tokensXML(full.parseEvents());
+  EXPECT_NE(full_xml.find(subroutines_xml), std::string::npos);
+  EXPECT_THROW(sut.compileOutlinedSubroutine(3), std::runtime_error);
+}
+
+TEST(CompilationEngineTest, CompileClassOutlineRejectsMissingBraces) {
+  const std::vector<std::vector<std::string>> sources = {
+      // f's body is never closed, so the last '}' closes it, not the class.
+      {"class", "A", "{",
+       "function", "void", "f", "(", ")", "{", "return", ";",
+       "function", "void", "g", "(", ")", "{", "return", ";", "}",
+       "}"},
+      // Only the class's '}' is missing.
+      {"class", "A", "{",
+       "function", "void", "f", "(", ")", "{", "return", ";", "}"},
+  };
+  for (const auto& tokens : sources) {
+    ConcreteCompilationEngine sut("./dummy.xml",
+                                  std::make_unique<Tokens>(tokens));
+    try {
+      sut.compileClassOutline();
+      FAIL();
+    } catch (const std::runtime_error& e) {
+      EXPECT_STREQ(e.what(), "should be }");
+    }
+  }
+}
+
+TEST(CompilationEngineTest, GenerateVMCode) {
+  const std::vector<std::string> tokens = {
+      "class", "P", "{", "field", "int", "x", ",", "y", ";",
+      "static", "int", "count", ";",
+      "constructor", "P", "new", "(", "int", "ax", ",", "int", "ay", ")", "{",
+      "let", "x", "=", "ax", ";", "let", "count", "=", "count", "+", "1", ";",
+      "return", "this", ";", "}",
+      "method", "int", "sum", "(", "Array", "a", ",", "int", "n", ")", "{",
+      "var", "int", "i", ",", "s", ";",
+      "while", "(", "i", "<", "n", ")", "{",
+      "let", "a", "[", "i", "]", "=", "s", "-", "a", "[", "i", "]", ";",
+      "let", "i", "=", "i", "+", "1", ";", "}",
+      "if", "(", "~", "(", "s", "=", "0", ")", ")", "{",
+      "do", "Output", ".", "printString", "(", "\"ok\"", ")", ";",
+      "}", "else", "{", "let", "s", "=", "true", ";", "}",
+      "return", "s", "*", "sum", "(", "a", ",", "n", "/", "2", ")", ";", "}",
+      "function", "void", "main", "(", ")", "{", "var", "P", "p", ";",
+      "let", "p", "=", "P", ".", "new", "(", "1", ",", "2", ")", ";",
+      "do", "p", ".", "sum", "(", "null", ",", "3", ")", ";", "return", ";",
+      "}",
+      "}",
+  };
+  const std::string expected =
+      "function P.new 0\n"
+      "push constant 2\n"
+      "call Memory.alloc 1\n"
+      "pop pointer 0\n"
+      "push argument 0\n"
+      "pop this 0\n"
+      "push static 0\n"
+      "push constant 1\n"
+      "add\n"
+      "pop static 0\n"
+      "push pointer 0\n"
+      "return\n"
+      "function P.sum 2\n"
+      "push argument 0\n"
+      "pop pointer 0\n"
+      "label L1\n"
+      "push local 0\n"
+      "push argument 2\n"
+      "lt\n"
+      "not\n"
+      "if-goto L3\n"
+      "push argument 1\n"
+      "push local 0\n"
+      "add\n"
+      "push local 1\n"
+      "push argument 1\n"
+      "push local 0\n"
+      "add\n"
+      "pop pointer 1\n"
+      "push that 0\n"
+      "sub\n"
+      "pop temp 0\n"
+      "pop pointer 1\n"
+      "push temp 0\n"
+      "pop that 0\n"
+      "push local 0\n"
+      "push constant 1\n"
+      "add\n"
+      "pop local 0\n"
+      "goto L1\n"
+      "label L3\n"
+      "push local 1\n"
+      "push constant 0\n"
+      "eq\n"
+      "not\n"
+      "not\n"
+      "if-goto L5\n"
+      "push constant 2\n"
+      "call String.new 1\n"
+      "push constant 111\n"
+      "call String.appendChar 2\n"
+      "push constant 107\n"
+      "call String.appendChar 2\n"
+      "call Output.printString 1\n"
+      "pop temp 0\n"
+      "goto L6\n"
+      "label L5\n"
+      "push constant 0\n"
+      "not\n"
+      "pop local 1\n"
+      "label L6\n"
+      "push local 1\n"
+      "push pointer 0\n"
+      "push argument 1\n"
+      "push argument 2\n"
+      "push constant 2\n"
+      "call Math.divide 2\n"
+      "call P.sum 3\n"
+      "call Math.multiply 2\n"
+      "return\n"
+      "function P.main 1\n"
+      "push constant 1\n"
+      "push constant 2\n"
+      "call P.new 2\n"
+      "pop local 0\n"
+      "push local 0\n"
+      "push constant 0\n"
+      "push constant 3\n"
+      "call P.sum 3\n"
+      "pop temp 0\n"
+      "push constant 0\n"
+      "return\n";
+
+  StringSink sink;
+  VMWriter writer(&sink);
+  VMBackend backend(&writer);
+  ConcreteCompilationEngine sut("./dummy.xml",
+                                std::make_unique<Tokens>(tokens));
+  sut.generateTo(&backend);
+  sut.compileClass();
+  EXPECT_EQ(sink.output, expected);
+
+  // Parallel parsing must not reorder the code.
+  StringSink parallel_sink;
+  VMWriter parallel_writer(&parallel_sink);
+  VMBackend parallel_backend(&parallel_writer);
+  WorkStealingScheduler scheduler(2);
+  ConcreteCompilationEngine parallel("./dummy.xml",
+                                     std::make_unique<Tokens>(tokens));
+  parallel.generateTo(&parallel_backend);
+  parallel.compileClassParallel(&scheduler);
+  EXPECT_EQ(parallel_sink.output, expected);
+}
@@ -0,0 +1,347 @@
+// No copyright.
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/HackBackend.hpp"
+#include "lib/IR.hpp"
+#include "lib/IRSimplifier.hpp"
+#include "lib/StringInterner.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+// The Hack ALU, for comp with M read as A.
+std::int16_t compute(std::string comp, const std::int16_t d,
+                     const std::int16_t a) {
+  for (auto& c : comp) {
+    c = c == 'M' ? 'A' : c;
+  }
+  const std::map<std::string, int> results = {
+      {"0", 0},         {"1", 1},         {"-1", -1},       {"D", d},
+      {"A", a},         {"!D", ~d},       {"!A", ~a},       {"-D", -d},
+      {"-A", -a},       {"D+1", d + 1},   {"A+1", a + 1},   {"D-1", d - 1},
+      {"A-1", a - 1},   {"D+A", d + a},   {"D-A", d - a},   {"A-D", a - d},
+      {"D&A", d & a},   {"D|A", d | a}};
+  const auto result = results.find(comp);
+  if (result == results.end()) {
+    throw std::runtime_error("Invalid comp " + comp);
+  }
+  return static_cast<std::int16_t>(result->second);
+}
+
+// Runs the one function of assembly on a Hack CPU, called with arguments,
+// and returns what it returns. The function may not call others.
+std::int16_t run(const std::string& assembly,
+                 const std::initializer_list<std::int16_t> arguments) {
+  std::map<std::string, int> symbols = {{"SP", 0},    {"LCL", 1},
+                                        {"ARG", 2},   {"THIS", 3},
+                                        {"THAT", 4},  {"R13", 13},
+                                        {"R14", 14}};
+  std::vector<std::string> program;
+  for (std::size_t begin = 0; begin < assembly.size();) {
+    const auto end = assembly.find('\n', begin);
+    const auto line = assembly.substr(begin, end - begin);
+    begin = end + 1;
+    if (line[0] == '(') {
+      symbols[line.substr(1, line.size() - 2)] = program.size();
+    } else {
+      program.push_back(line);
+    }
+  }
+
+  // The return address is just past the program, where the CPU stops.
+  std::vector<std::int16_t> ram(32768);
+  ram[2] = 256;
+  for (const auto argument : arguments) {
+    ram[256 + ram[0]++] = argument;
+  }
+  ram[0] += 256;
+  ram[ram[0]] = static_cast<std::int16_t>(program.size());
+  ram[0] += 5;
+  ram[1] = ram[0];
+
+  std::int16_t a = 0;
+  std::int16_t d = 0;
+  std::size_t pc = 0;
+  for (auto steps = 0; pc < program.size(); ++steps) {
+    if (steps == 100000) {
+      throw std::runtime_error("Does not return");
+    }
+    const auto& instruction = program[pc++];
+    if (instruction[0] == '@') {
+      const auto symbol = instruction.substr(1);
+      a = static_cast<std::int16_t>(symbol[0] >= '0' && symbol[0] <= '9'
+                                        ? std::stoi(symbol)
+                                        : symbols.at(symbol));
+      continue;
+    }
+    const auto equals = instruction.find('=');
+    const auto semicolon = instruction.find(';');
+    const auto dest =
+        equals == std::string::npos ? "" : instruction.substr(0, equals);
+    const auto comp_begin = equals == std::string::npos ? 0 : equals + 1;
+    const auto comp = instruction.substr(comp_begin, semicolon - comp_begin);
+    const auto jump = semicolon == std::string::npos
+                          ? ""
+                          : instruction.substr(semicolon + 1);
+    const auto address = static_cast<std::uint16_t>(a) & 0x7fff;
+    const auto result = compute(comp, d, comp.find('M') != std::string::npos
+                                             ? ram[address]
+                                             : a);
+    if (dest.find('M') != std::string::npos) {
+      ram[address] = result;
+    }
+    if (dest.find('A') != std::string::npos) {
+      a = result;
+    }
+    if (dest.find('D') != std::string::npos) {
+      d = result;
+    }
+    if (jump == "JMP" || (jump == "JEQ" && result == 0) ||
+        (jump == "JNE" && result != 0) || (jump == "JLT" && result < 0) ||
+        (jump == "JGT" && result > 0) || (jump == "JLE" && result <= 0) ||
+        (jump == "JGE" && result >= 0)) {
+      pc = static_cast<std::uint16_t>(a);
+    }
+  }
+  return ram[256];
+}
+
+// Operand pairs whose difference overflows and some whose does not.
+constexpr std::int16_t kOperands[][2] = {
+    {32767, -32768}, {-32768, 32767}, {20000, -20000}, {-20000, 20000},
+    {1, -32768},     {-32768, 1},     {0, -1},         {-1, 0},
+    {-32768, -32768}, {5, 5},         {3, 7},          {-7, -3}};
+
+}  // namespace
+
+TEST(HackBackendTest, LowersFunction) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  // if (x = 3) { let s = 7; } return -32768;
+  builder.load(SymbolKind::kLocal, 0);
+  builder.constant(3);
+  builder.binary(IRBinaryOp::kEqual);
+  const auto then_block = builder.newBlock();
+  const auto end = builder.newBlock();
+  builder.branch(then_block, end);
+  builder.placeBlock(then_block);
+  builder.constant(7);
+  builder.store(SymbolKind::kStatic, 2);
+  builder.placeBlock(end);
+  builder.constant(-32768);
+  builder.ret();
+
+  StringSink sink;
+  HackBackend sut(&sink);
+  sut.lower(builder.endFunction(1));
+  const std::string expected_head =
+      "(Main.f)\n"
+      "@SP\nAM=M+1\nA=A-1\nM=0\n"
+      // push local 0.
+      "@LCL\nA=M\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      // push constant 3.
+      "@3\nD=A\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      // eq.
+      "@SP\nAM=M-1\nD=M\nA=A-1\nD=M-D\nM=-1\n@Main.f$cmp.0\nD;JEQ\n"
+      "@SP\nA=M-1\nM=0\n(Main.f$cmp.0)\n"
+      // Branch over the then block when false.
+      "@SP\nAM=M-1\nD=M\n@Main.f$L2\nD;JEQ\n"
+      // pop static 2.
+      "@7\nD=A\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+      "@SP\nAM=M-1\nD=M\n@Main.2\nM=D\n"
+      "(Main.f$L2)\n"
+      // -32768 is ~32767.
+      "@32767\nD=!A\n@SP\nAM=M+1\nA=A-1\nM=D\n";
+  EXPECT_EQ(sink.output.substr(0, expected_head.size()), expected_head);
+  EXPECT_NE(sink.output.find("@R14\nA=M\n0;JMP\n", expected_head.size()),
+            std::string::npos);
+}
+
+TEST(HackBackendTest, CallsFollowTheVMConvention) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("g"));
+  builder.constant(2);
+  builder.constant(3);
+  builder.binary(IRBinaryOp::kMultiply);
+  builder.discard();
+  builder.constant(0);
+  builder.ret();
+
+  StringSink sink;
+  HackBackend sut(&sink);
+  sut.lower(builder.endFunction(0));
+  EXPECT_NE(sink.output.find("@Main.g$ret.0\nD=A\n"), std::string::npos);
+  // ARG = SP - 2 - 5.
+  EXPECT_NE(sink.output.find("@SP\nD=M\n@7\nD=D-A\n@ARG\nM=D\n"
+                             "@SP\nD=M\n@LCL\nM=D\n@Math.multiply\n0;JMP\n"
+                             "(Main.g$ret.0)\n@SP\nM=M-1\n"),
+            std::string::npos);
+}
+
+TEST(HackBackendTest, ShiftsInline) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("h"));
+  builder.load(SymbolKind::kArgument, 0);
+  builder.constant(4);
+  builder.binary(IRBinaryOp::kMultiply);
+  builder.constant(16384);
+  builder.binary(IRBinaryOp::kDivide);
+  builder.ret();
+
+  StringSink sink;
+  HackBackend backend(&sink);
+  IRSimplifier sut(&backend);
+  sut.lower(builder.endFunction(0));
+  EXPECT_NE(sink.output.find("@ARG\nA=M\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n"
+                             "@SP\nA=M-1\nD=M\nM=D+M\nD=M\nM=D+M\n"),
+            std::string::npos);
+  // Biased by 16383 if negative, then bit 14 and the sign are all left.
+  EXPECT_NE(sink.output.find("@16383\nD=A\n@R13\nM=D+M\n"),
+            std::string::npos);
+  EXPECT_NE(sink.output.find("@R13\nD=M\n@16384\nD=D&A\n"),
+            std::string::npos);
+  EXPECT_NE(sink.output.find("@1\nD=!A\n"), std::string::npos);
+  EXPECT_EQ(sink.output.find("Math."), std::string::npos);
+}
+
+TEST(HackBackendTest, JumpsOnComparisons) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("k"));
+  // while (~(i > n)) { let i = i + 1; } if (i < 0) { return 1; } return 0;
+  const auto condition = builder.newBlock();
+  auto end = builder.newBlock();
+  builder.placeBlock(condition);
+  builder.load(SymbolKind::kLocal, 0);
+  builder.load(SymbolKind::kArgument, 0);
+  builder.binary(IRBinaryOp::kGreaterThan);
+  builder.unary(IRUnaryOp::kNot);
+  const auto body = builder.newBlock();
+  builder.branch(body, end);
+  builder.placeBlock(body);
+  builder.load(SymbolKind::kLocal, 0);
+  builder.constant(1);
+  builder.binary(IRBinaryOp::kAdd);
+  builder.store(SymbolKind::kLocal, 0);
+  builder.jump(condition);
+  builder.placeBlock(end);
+  builder.load(SymbolKind::kLocal, 0);
+  builder.constant(0);
+  builder.binary(IRBinaryOp::kLessThan);
+  const auto then_block = builder.newBlock();
+  end = builder.newBlock();
+  builder.branch(then_block, end);
+  builder.placeBlock(then_block);
+  builder.constant(1);
+  builder.ret();
+  builder.placeBlock(end);
+  builder.constant(0);
+  builder.ret();
+
+  StringSink sink;
+  HackBackend backend(&sink);
+  IRSimplifier sut(&backend);
+  sut.lower(builder.endFunction(1));
+  // i - n when the signs agree, from which the jump follows.
+  const std::string compare = "@SP\nA=M+1\nD=D-M\n";
+  // Out of the loop if i > n at the top, back into it if i <= n at the
+  // bottom.
+  EXPECT_NE(sink.output.find(compare + "@Main.k$cmp.2\n0;JMP\n"),
+            std::string::npos);
+  EXPECT_NE(sink.output.find("D=1\n(Main.k$cmp.2)\n@Main.k$L2\nD;JGT\n"),
+            std::string::npos);
+  EXPECT_NE(sink.output.find("D=1\n(Main.k$cmp.5)\n@Main.k$L1\nD;JLE\n"),
+            std::string::npos);
+  EXPECT_NE(sink.output.find("@SP\nAM=M-1\nD=M\n@Main.k$L4\nD;JGE\n"),
+            std::string::npos);
+  // Neither comparison leaves a boolean to test.
+  EXPECT_EQ(sink.output.find("M=-1\n"), std::string::npos);
+}
+
+TEST(HackBackendTest, BranchesAcrossOverflow) {
+  for (const auto& operands : kOperands) {
+    const auto a = operands[0];
+    const auto b = operands[1];
+    for (const auto op : {IRBinaryOp::kLessThan, IRBinaryOp::kGreaterThan}) {
+      for (const auto negated : {false, true}) {
+        for (const auto constant : {false, true}) {
+          // if (a op b) { return -1; } return 0; with ~ around a op b if
+          // negated, and b a constant if constant.
+          IRBuilder builder;
+          builder.beginFunction(idOf("Main"), idOf("b"));
+          builder.load(SymbolKind::kArgument, 0);
+          if (constant) {
+            builder.constant(b);
+          } else {
+            builder.load(SymbolKind::kArgument, 1);
+          }
+          builder.binary(op);
+          if (negated) {
+            builder.unary(IRUnaryOp::kNot);
+          }
+          const auto then_block = builder.newBlock();
+          const auto end = builder.newBlock();
+          builder.branch(then_block, end);
+          builder.placeBlock(then_block);
+          builder.constant(-1);
+          builder.ret();
+          builder.placeBlock(end);
+          builder.constant(0);
+          builder.ret();
+          StringSink sink;
+          HackBackend backend(&sink);
+          IRSimplifier sut(&backend);
+          sut.lower(builder.endFunction(0));
+
+          const auto holds = (op == IRBinaryOp::kLessThan ? a < b : a > b) !=
+                             negated;
+          EXPECT_EQ(run(sink.output, {a, b}), holds ? -1 : 0)
+              << (negated ? "~(" : "(") << a << " op "
+              << static_cast<int>(op) << " " << b << ")"
+              << (constant ? " constant" : "");
+        }
+      }
+    }
+  }
+}
+
+TEST(HackBackendTest, ComparesAcrossOverflow) {
+  for (const auto op : {IRBinaryOp::kLessThan, IRBinaryOp::kGreaterThan,
+                        IRBinaryOp::kEqual}) {
+    // return a op b;
+    IRBuilder builder;
+    builder.beginFunction(idOf("Main"), idOf("c"));
+    builder.load(SymbolKind::kArgument, 0);
+    builder.load(SymbolKind::kArgument, 1);
+    builder.binary(op);
+    builder.ret();
+    StringSink sink;
+    HackBackend sut(&sink);
+    sut.lower(builder.endFunction(0));
+
+    for (const auto& operands : kOperands) {
+      const auto a = operands[0];
+      const auto b = operands[1];
+      const auto holds = op == IRBinaryOp::kLessThan      ? a < b
+                         : op == IRBinaryOp::kGreaterThan ? a > b
+                                                          : a == b;
+      EXPECT_EQ(run(sink.output, {a, b}), holds ? -1 : 0)
+          << a << " op " << static_cast<int>(op) << " " << b;
+    }
+  }
+}
+
+TEST(HackBackendTest, BootstrapCallsSysInit) {
+  StringSink sink;
+  writeHackBootstrap(&sink);
+  EXPECT_EQ(sink.output.rfind("@256\nD=A\n@SP\nM=D\n", 0), 0u);
+  EXPECT_NE(sink.output.find("@Sys.init\n0;JMP\n"), std::string::npos);
+}
@@ -0,0 +1,119 @@
+// No copyright.
+
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/IR.hpp"
+#include "lib/StringInterner.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+TEST(IRTest, TemporariesFollowTheStack) {
+  IRBuilder sut;
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  // return 1 - x * 2.
+  sut.constant(1);
+  sut.load(SymbolKind::kLocal, 0);
+  sut.constant(2);
+  sut.binary(IRBinaryOp::kMultiply);
+  sut.binary(IRBinaryOp::kSub);
+  sut.ret();
+  const auto& function = sut.endFunction(1);
+
+  EXPECT_EQ(function.class_name, idOf("Main"));
+  EXPECT_EQ(function.name, idOf("main"));
+  EXPECT_EQ(function.num_locals, 1);
+  EXPECT_EQ(function.num_temps, 5u);
+  ASSERT_EQ(function.blocks.size(), 1u);
+  const auto& block = function.blocks[0];
+  ASSERT_EQ(block.size, 5u);
+  const auto& multiply = block.instructions[3];
+  EXPECT_EQ(multiply.opcode, IROpcode::kBinary);
+  EXPECT_EQ(multiply.lhs, 1u);
+  EXPECT_EQ(multiply.rhs, 2u);
+  EXPECT_EQ(multiply.result, 3u);
+  const auto& subtract = block.instructions[4];
+  EXPECT_EQ(subtract.lhs, 0u);
+  EXPECT_EQ(subtract.rhs, 3u);
+  EXPECT_EQ(block.terminator, IRTerminator::kReturn);
+  EXPECT_EQ(block.value, 4u);
+}
+
+TEST(IRTest, CallsTakeTheirArgumentsInOrder) {
+  IRBuilder sut;
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  sut.thisPointer();
+  sut.string("ab");
+  sut.call(idOf("Main"), idOf("f"), 2);
+  sut.discard();
+  const auto& function = sut.endFunction(0);
+
+  const auto& call = function.blocks[0].instructions[2];
+  EXPECT_EQ(call.opcode, IROpcode::kCall);
+  ASSERT_EQ(call.count, 2);
+  EXPECT_EQ(call.arguments[0], 0u);
+  EXPECT_EQ(call.arguments[1], 1u);
+  EXPECT_EQ(call.callee_name, idOf("f"));
+  const auto& string = function.blocks[0].instructions[1];
+  EXPECT_EQ(std::string_view(string.text, string.count), "ab");
+  EXPECT_EQ(function.blocks[0].terminator, IRTerminator::kFallthrough);
+}
+
+TEST(IRTest, BlocksAreNumberedInLayoutOrder) {
+  IRBuilder sut;
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  // while (x) {} return 0; return 0;
+  const auto condition = sut.newBlock();
+  const auto end = sut.newBlock();
+  sut.placeBlock(condition);
+  sut.load(SymbolKind::kArgument, 0);
+  const auto body = sut.newBlock();
+  sut.branch(body, end);
+  sut.placeBlock(body);
+  sut.jump(condition);
+  sut.placeBlock(end);
+  sut.constant(0);
+  sut.ret();
+  sut.constant(0);
+  sut.ret();
+  const auto& function = sut.endFunction(0);
+
+  ASSERT_EQ(function.blocks.size(), 4u);
+  EXPECT_EQ(function.blocks[0].terminator, IRTerminator::kBranch);
+  EXPECT_EQ(function.blocks[0].target, 1u);
+  EXPECT_EQ(function.blocks[0].other, 2u);
+  EXPECT_EQ(function.blocks[1].terminator, IRTerminator::kJump);
+  EXPECT_EQ(function.blocks[1].target, 0u);
+
+  const auto layout = layoutOf(function);
+  EXPECT_EQ(layout.reachable, (std::vector<bool>{true, true, true, false}));
+  EXPECT_EQ(layout.labeled, (std::vector<bool>{true, false, true, false}));
+}
+
+TEST(IRTest, InvertsConditions) {
+  for (const auto condition :
+       {IRCondition::kNotEqual, IRCondition::kEqual, IRCondition::kLess,
+        IRCondition::kGreater, IRCondition::kLessOrEqual,
+        IRCondition::kGreaterOrEqual}) {
+    EXPECT_NE(inverseOf(condition), condition);
+    EXPECT_EQ(inverseOf(inverseOf(condition)), condition);
+  }
+  EXPECT_EQ(inverseOf(IRCondition::kLess), IRCondition::kGreaterOrEqual);
+  EXPECT_EQ(inverseOf(IRCondition::kGreater), IRCondition::kLessOrEqual);
+}
+
+TEST(IRTest, RejectsMalformedCode) {
+  IRBuilder sut;
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  EXPECT_THROW(sut.binary(IRBinaryOp::kAdd), std::runtime_error);
+  EXPECT_THROW(sut.constant(32768), std::runtime_error);
+
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  sut.constant(0);
+  EXPECT_THROW(sut.placeBlock(sut.newBlock()), std::runtime_error);
+
+  sut.beginFunction(idOf("Main"), idOf("main"));
+  sut.jump(sut.newBlock());
+  EXPECT_THROW(sut.endFunction(0), std::runtime_error);
+}
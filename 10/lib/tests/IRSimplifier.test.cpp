@@ -0,0 +1,453 @@
+// No copyright.
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "lib/IR.hpp"
+#include "lib/IRSimplifier.hpp"
+#include "lib/StringInterner.hpp"
+#include "lib/VMBackend.hpp"
+#include "lib/VMWriter.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+// Simplifies the function body builds and returns its VM code without the
+// function command.
+std::string simplified(const std::function<void(IRBuilder*)>& body) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  body(&builder);
+
+  StringSink sink;
+  VMWriter writer(&sink);
+  VMBackend backend(&writer);
+  IRSimplifier sut(&backend);
+  sut.lower(builder.endFunction(0));
+  return sink.output.substr(sink.output.find('\n') + 1);
+}
+
+// The VM code of multiplying the top of the stack by 2^times.
+std::string doubled(const int times) {
+  std::string code;
+  for (auto i = 0; i < times; ++i) {
+    code += "pop temp 0\npush temp 0\npush temp 0\nadd\n";
+  }
+  return code;
+}
+
+// Keeps the number of temporaries of the last function lowered.
+class TempCounter : public IIRBackend {
+ public:
+  void lower(const IRFunction& function) { num_temps = function.num_temps; }
+
+  IRTemp num_temps = 0;
+};
+
+}  // namespace
+
+TEST(IRSimplifierTest, FoldsConstants) {
+  // return (16 * 32) + (-(1 - 3) / ~0) - (7 < 8);
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->constant(16);
+              ir->constant(32);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->constant(1);
+              ir->constant(3);
+              ir->binary(IRBinaryOp::kSub);
+              ir->unary(IRUnaryOp::kNeg);
+              ir->constant(0);
+              ir->unary(IRUnaryOp::kNot);
+              ir->binary(IRBinaryOp::kDivide);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->constant(7);
+              ir->constant(8);
+              ir->binary(IRBinaryOp::kLessThan);
+              ir->binary(IRBinaryOp::kSub);
+              ir->ret();
+            }),
+            "push constant 511\n"
+            "return\n");
+  // 32767 + 1 and 300 * 300 wrap around like at run time, and
+  // -32768 | 24464 is -8304.
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->constant(32767);
+              ir->constant(1);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->constant(300);
+              ir->constant(300);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->binary(IRBinaryOp::kOr);
+              ir->ret();
+            }),
+            "push constant 8303\n"
+            "not\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, KeepsWhatFailsAtRunTime) {
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->constant(1);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kDivide);
+              ir->ret();
+            }),
+            "push constant 1\n"
+            "push constant 0\n"
+            "call Math.divide 2\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, DropsIdentities) {
+  // return ((~(~x) * 2) + 0) * 1 - -(-y) & -1 | 0;
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kLocal, 0);
+              ir->unary(IRUnaryOp::kNot);
+              ir->unary(IRUnaryOp::kNot);
+              ir->constant(2);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->constant(1);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->load(SymbolKind::kLocal, 1);
+              ir->unary(IRUnaryOp::kNeg);
+              ir->unary(IRUnaryOp::kNeg);
+              ir->binary(IRBinaryOp::kSub);
+              ir->constant(-1);
+              ir->binary(IRBinaryOp::kAnd);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kOr);
+              ir->ret();
+            }),
+            "push local 0\n" + doubled(1) +
+                "push local 1\n"
+                "sub\n"
+                "return\n");
+  // 0 - x is -x, and x * -1 too.
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->constant(0);
+              ir->load(SymbolKind::kArgument, 0);
+              ir->binary(IRBinaryOp::kSub);
+              ir->constant(-1);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->ret();
+            }),
+            "push argument 0\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, DropsOperandsWithoutEffects) {
+  // let x = a[i] * 0; return f() & 0;
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kArgument, 0);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->loadIndirect();
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->store(SymbolKind::kLocal, 1);
+              ir->call(idOf("Main"), idOf("g"), 0);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kAnd);
+              ir->ret();
+            }),
+            "push constant 0\n"
+            "pop local 1\n"
+            "call Main.g 0\n"
+            "push constant 0\n"
+            "and\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, CanonicalizesConstantOperands) {
+  // return ((2 + x) - 7 < 5 + y) & ~(3 > x) & ~(z < 0);
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->constant(2);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->constant(7);
+              ir->binary(IRBinaryOp::kSub);
+              ir->constant(5);
+              ir->load(SymbolKind::kLocal, 1);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->binary(IRBinaryOp::kLessThan);
+              ir->constant(3);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->binary(IRBinaryOp::kGreaterThan);
+              ir->unary(IRUnaryOp::kNot);
+              ir->binary(IRBinaryOp::kAnd);
+              ir->load(SymbolKind::kLocal, 2);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kLessThan);
+              ir->unary(IRUnaryOp::kNot);
+              ir->binary(IRBinaryOp::kAnd);
+              ir->ret();
+            }),
+            "push local 0\n"
+            "push constant 5\n"
+            "sub\n"
+            "push local 1\n"
+            "push constant 5\n"
+            "add\n"
+            "lt\n"
+            "push local 0\n"
+            "push constant 2\n"
+            "gt\n"
+            "and\n"
+            "push local 2\n"
+            "push constant 0\n"
+            "not\n"
+            "gt\n"
+            "and\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, TurnsConstantBranchesIntoJumps) {
+  // while (true) { do g(); } return 0;
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              const auto condition = ir->newBlock();
+              const auto end = ir->newBlock();
+              ir->placeBlock(condition);
+              ir->constant(0);
+              ir->unary(IRUnaryOp::kNot);
+              const auto body = ir->newBlock();
+              ir->branch(body, end);
+              ir->placeBlock(body);
+              ir->call(idOf("Main"), idOf("g"), 0);
+              ir->discard();
+              ir->jump(condition);
+              ir->placeBlock(end);
+              ir->constant(0);
+              ir->ret();
+            }),
+            "label L0\n"
+            "call Main.g 0\n"
+            "pop temp 0\n"
+            "goto L0\n");
+}
+
+TEST(IRSimplifierTest, RejectsTemporariesOutOfStackOrder) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  builder.load(SymbolKind::kLocal, 0);
+  builder.load(SymbolKind::kLocal, 1);
+  builder.binary(IRBinaryOp::kSub);
+  builder.ret();
+  auto function = builder.endFunction(2);
+  IRInstruction swapped[3] = {function.blocks[0].instructions[0],
+                              function.blocks[0].instructions[1],
+                              function.blocks[0].instructions[2]};
+  std::swap(swapped[2].lhs, swapped[2].rhs);
+  function.blocks[0].instructions = swapped;
+
+  StringSink sink;
+  VMWriter writer(&sink);
+  VMBackend backend(&writer);
+  IRSimplifier sut(&backend);
+  EXPECT_THROW(sut.lower(function), std::runtime_error);
+}
+
+TEST(IRSimplifierTest, ShiftsForPowersOf2) {
+  // return ((a[0] * 4) * 8) + (f() / -2) + (x * -32768);
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kArgument, 0);
+              ir->loadIndirect();
+              ir->constant(4);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->constant(8);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->call(idOf("Main"), idOf("g"), 0);
+              ir->constant(-2);
+              ir->binary(IRBinaryOp::kDivide);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->constant(-32768);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->ret();
+            }),
+            "push argument 0\n"
+            "pop pointer 1\n"
+            "push that 0\n" +
+                doubled(5) +
+                "call Main.g 0\n"
+                "push constant 2\n"
+                "call Math.divide 2\n"
+                "neg\n"
+                "add\n"
+                "push local 0\n" +
+                doubled(15) +
+                "add\n"
+                "return\n");
+}
+
+TEST(IRSimplifierTest, MultipliesVariablesBySumsOfPowersOf2) {
+  // return (x * 10) - (this * 7) + ((x + 1) * 10);
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kField, 2);
+              ir->constant(10);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->thisPointer();
+              ir->constant(7);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->binary(IRBinaryOp::kSub);
+              ir->load(SymbolKind::kField, 2);
+              ir->constant(1);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->constant(10);
+              ir->binary(IRBinaryOp::kMultiply);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->ret();
+            }),
+            "push this 2\n" + doubled(3) + "push this 2\n" + doubled(1) +
+                "add\n"
+                "push pointer 0\n" +
+                doubled(3) +
+                "push pointer 0\n"
+                "sub\n"
+                "sub\n"
+                "push this 2\n"
+                "push constant 1\n"
+                "add\n"
+                "push constant 10\n"
+                "call Math.multiply 2\n"
+                "add\n"
+                "return\n");
+}
+
+TEST(IRSimplifierTest, AllocatesTemporariesOnlyForRewrites) {
+  // return ((x + 1) * -10) + (x / -3), neither of which is rewritten.
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  builder.load(SymbolKind::kLocal, 0);
+  builder.constant(1);
+  builder.binary(IRBinaryOp::kAdd);
+  builder.constant(-10);
+  builder.binary(IRBinaryOp::kMultiply);
+  builder.load(SymbolKind::kLocal, 0);
+  builder.constant(-3);
+  builder.binary(IRBinaryOp::kDivide);
+  builder.binary(IRBinaryOp::kAdd);
+  builder.ret();
+
+  TempCounter backend;
+  IRSimplifier sut(&backend);
+  const auto& function = builder.endFunction(1);
+  const auto num_temps = function.num_temps;
+  sut.lower(function);
+  EXPECT_EQ(backend.num_temps, num_temps);
+}
+
+TEST(IRSimplifierTest, FusesComparisonsIntoBranches) {
+  // if (~(a < b)) { let a = 0; } while (i < 10) { let i = i + 1; }
+  // if (x = 0) { return 1; } return 0;
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kArgument, 0);
+              ir->load(SymbolKind::kArgument, 1);
+              ir->binary(IRBinaryOp::kLessThan);
+              ir->unary(IRUnaryOp::kNot);
+              auto then_block = ir->newBlock();
+              auto end = ir->newBlock();
+              ir->branch(then_block, end);
+              ir->placeBlock(then_block);
+              ir->constant(0);
+              ir->store(SymbolKind::kArgument, 0);
+              ir->placeBlock(end);
+
+              const auto condition = ir->newBlock();
+              end = ir->newBlock();
+              ir->placeBlock(condition);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->constant(10);
+              ir->binary(IRBinaryOp::kLessThan);
+              const auto body = ir->newBlock();
+              ir->branch(body, end);
+              ir->placeBlock(body);
+              ir->load(SymbolKind::kLocal, 0);
+              ir->constant(1);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->store(SymbolKind::kLocal, 0);
+              ir->jump(condition);
+              ir->placeBlock(end);
+
+              ir->load(SymbolKind::kStatic, 0);
+              ir->constant(0);
+              ir->binary(IRBinaryOp::kEqual);
+              then_block = ir->newBlock();
+              end = ir->newBlock();
+              ir->branch(then_block, end);
+              ir->placeBlock(then_block);
+              ir->constant(1);
+              ir->ret();
+              ir->placeBlock(end);
+              ir->constant(0);
+              ir->ret();
+            }),
+            "push argument 0\n"
+            "push argument 1\n"
+            "lt\n"
+            "if-goto L2\n"
+            "push constant 0\n"
+            "pop argument 0\n"
+            "label L2\n"
+            "push local 0\n"
+            "push constant 10\n"
+            "lt\n"
+            "not\n"
+            "if-goto L5\n"
+            "label L4\n"
+            "push local 0\n"
+            "push constant 1\n"
+            "add\n"
+            "pop local 0\n"
+            // The test is repeated at the bottom of the loop.
+            "push local 0\n"
+            "push constant 10\n"
+            "lt\n"
+            "if-goto L4\n"
+            "label L5\n"
+            "push static 0\n"
+            "if-goto L7\n"
+            "push constant 1\n"
+            "return\n"
+            "label L7\n"
+            "push constant 0\n"
+            "return\n");
+}
+
+TEST(IRSimplifierTest, KeepsBitwiseNotOfOtherValues) {
+  // if (~(x + 1)) { return 1; } return 0;
+  EXPECT_EQ(simplified([](IRBuilder* ir) {
+              ir->load(SymbolKind::kLocal, 0);
+              ir->constant(1);
+              ir->binary(IRBinaryOp::kAdd);
+              ir->unary(IRUnaryOp::kNot);
+              const auto then_block = ir->newBlock();
+              const auto end = ir->newBlock();
+              ir->branch(then_block, end);
+              ir->placeBlock(then_block);
+              ir->constant(1);
+              ir->ret();
+              ir->placeBlock(end);
+              ir->constant(0);
+              ir->ret();
+            }),
+            "push local 0\n"
+            "push constant 1\n"
+            "add\n"
+            "not\n"
+            // ~(x + 1) is not a comparison, so not would not invert it.
+            "push constant 0\n"
+            "eq\n"
+            "if-goto L2\n"
+            "push constant 1\n"
+            "return\n"
+            "label L2\n"
+            "push constant 0\n"
+            "return\n");
+}
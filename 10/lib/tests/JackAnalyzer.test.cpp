@@ -0,0 +1,55 @@
+// No copyright.
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/JackAnalyzer.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+constexpr char input_file[] = "lib/tests/data/ArrayTest/Main.jack";
+constexpr char tree_reference[] = "lib/tests/data/ArrayTest/Main.xml";
+constexpr char tokens_reference[] = "lib/tests/data/ArrayTest/MainT.xml";
+
+}  // namespace
+
+TEST(JackAnalyzerTest, TokensFilenameFor) {
+  EXPECT_EQ(JackAnalyzer::tokensFilenameFor("out/Main.xml"), "out/MainT.xml");
+  EXPECT_EQ(JackAnalyzer::tokensFilenameFor("Main"), "MainT.xml");
+}
+
+TEST(JackAnalyzerTest, TokensAndTreeMatchReference) {
+  JackAnalyzer sut(input_file, "./ArrayTestMain.xml");
+  sut.compileToTokensAndTreeXML();
+
+  EXPECT_EQ(readAll("./ArrayTestMain.xml"), readAll(tree_reference));
+  EXPECT_EQ(readAll("./ArrayTestMainT.xml"), readAll(tokens_reference));
+}
+
+TEST(JackAnalyzerTest, StreamingTreeMatchesReference) {
+  JackAnalyzer sut(input_file, "./ArrayTestMainStreamed.xml");
+  sut.compileToTreeXMLStreaming();
+
+  EXPECT_EQ(readAll("./ArrayTestMainStreamed.xml"), readAll(tree_reference));
+}
+
+TEST(JackAnalyzerTest, CompileToVM) {
+  JackAnalyzer sut(input_file, "./ArrayTestMain.vm");
+  sut.compile(AnalyzerOutput::kVMCode);
+
+  const auto code = readAll("./ArrayTestMain.vm");
+  EXPECT_EQ(code.rfind("function Main.main 4\n", 0), 0u);
+  EXPECT_NE(code.find("call Array.new 1\n"), std::string::npos);
+  EXPECT_EQ(code.find("<"), std::string::npos);
+}
+
+TEST(JackAnalyzerTest, CompileToHackAssembly) {
+  JackAnalyzer sut(input_file, "./ArrayTestMain.asm");
+  sut.compile(AnalyzerOutput::kHackAssembly);
+
+  const auto code = readAll("./ArrayTestMain.asm");
+  EXPECT_EQ(code.rfind("(Main.main)\n", 0), 0u);
+  EXPECT_NE(code.find("@Array.new\n0;JMP\n"), std::string::npos);
+  EXPECT_EQ(code.find("push"), std::string::npos);
+}
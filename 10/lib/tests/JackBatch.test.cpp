@@ -0,0 +1,69 @@
+// No copyright.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/JackBatch.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+constexpr char input_dir[] = "lib/tests/data/ArrayTest";
+constexpr char tree_reference[] = "lib/tests/data/ArrayTest/Main.xml";
+constexpr char tokens_reference[] = "lib/tests/data/ArrayTest/MainT.xml";
+
+}  // namespace
+
+TEST(JackBatchTest, CompileJobsForDirectory) {
+  const auto jobs = compileJobsFor({input_dir, "lib/tests/data/test.jack"},
+                                   "out");
+  ASSERT_EQ(jobs.size(), 2u);
+  EXPECT_EQ(jobs[0].source, "lib/tests/data/ArrayTest/Main.jack");
+  EXPECT_EQ(jobs[0].output_filename, "out/Main.xml");
+  EXPECT_EQ(jobs[1].source, "lib/tests/data/test.jack");
+  EXPECT_EQ(jobs[1].output_filename, "out/test.xml");
+}
+
+TEST(JackBatchTest, CompileJobsForDuplicateNames) {
+  EXPECT_THROW(compileJobsFor({input_dir, input_dir}, "out"),
+               std::runtime_error);
+}
+
+TEST(JackBatchTest, CompileAllMatchesReference) {
+  const auto failures = compileAll(compileJobsFor({input_dir}, "./batch_out"),
+                                   AnalyzerOutput::kTokensAndTreeXML, 2);
+  EXPECT_TRUE(failures.empty());
+  EXPECT_EQ(readAll("./batch_out/Main.xml"), readAll(tree_reference));
+  EXPECT_EQ(readAll("./batch_out/MainT.xml"), readAll(tokens_reference));
+}
+
+TEST(JackBatchTest, CompileAllReportsFailures) {
+  const std::vector<CompileJob> jobs{
+      {"lib/tests/data/missing.jack", "./batch_out/missing.xml"},
+      {"lib/tests/data/ArrayTest/Main.jack", "./batch_out/Main.xml"},
+  };
+  const auto failures = compileAll(jobs, AnalyzerOutput::kXMLTokens, 2);
+  ASSERT_EQ(failures.size(), 1u);
+  EXPECT_EQ(failures[0].source, "lib/tests/data/missing.jack");
+}
+
+TEST(JackBatchTest, CompileAllReportsSourcesWithoutTokens) {
+  const std::vector<CompileJob> jobs{
+      {"lib/tests/data/ArrayTest/Main.jack", "./batch_out/Main.out"},
+      {"lib/tests/data/comments_only.jack", "./batch_out/comments_only.out"},
+      {"lib/tests/data/empty.jack", "./batch_out/empty.out"},
+  };
+  for (const auto output :
+       {AnalyzerOutput::kXMLTokens, AnalyzerOutput::kTokensAndTreeXML,
+        AnalyzerOutput::kStreamingTreeXML, AnalyzerOutput::kOutlineXML,
+        AnalyzerOutput::kVMCode, AnalyzerOutput::kHackAssembly}) {
+    std::remove("./batch_out/Main.out");
+    const auto failures = compileAll(jobs, output, 4);
+    ASSERT_EQ(failures.size(), 2u) << static_cast<int>(output);
+    EXPECT_EQ(failures[0].source, "lib/tests/data/comments_only.jack");
+    EXPECT_EQ(failures[1].source, "lib/tests/data/empty.jack");
+    EXPECT_FALSE(readAll("./batch_out/Main.out").empty());
+  }
+}
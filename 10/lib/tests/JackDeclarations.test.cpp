@@ -0,0 +1,58 @@
+// No copyright.
+
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/JackDeclarations.hpp"
+#include "lib/StringInterner.hpp"
+
+namespace {
+
+IdentifierId nameId(const int i) {
+  return identifierPool().intern("v" + std::to_string(i));
+}
+
+}  // namespace
+
+TEST(JackDeclarationsTest, AddAndFind) {
+  JackDeclarations sut;
+  const auto x = identifierPool().intern("x");
+  const auto y = identifierPool().intern("y");
+  EXPECT_TRUE(sut.isEmpty());
+  sut.addDeclaration(x);
+  EXPECT_FALSE(sut.isEmpty());
+  EXPECT_TRUE(sut.isDeclared(x));
+  EXPECT_FALSE(sut.isDeclared(y));
+}
+
+TEST(JackDeclarationsTest, DeclaringTwiceThrows) {
+  JackDeclarations sut;
+  const auto x = identifierPool().intern("x");
+  sut.addDeclaration(x);
+  try {
+    sut.addDeclaration(x);
+    FAIL();
+  } catch (const std::runtime_error& error) {
+    EXPECT_STREQ(error.what(), "Cannot declare twice: x");
+  }
+}
+
+TEST(JackDeclarationsTest, GrowsClearsAndCopies) {
+  JackDeclarations sut;
+  for (int i = 0; i < 100; ++i) {
+    sut.addDeclaration(nameId(i));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(sut.isDeclared(nameId(i)));
+  }
+  EXPECT_FALSE(sut.isDeclared(nameId(100)));
+
+  JackDeclarations copy(sut);
+  sut.clear();
+  EXPECT_TRUE(sut.isEmpty());
+  EXPECT_FALSE(sut.isDeclared(nameId(0)));
+  EXPECT_TRUE(copy.isDeclared(nameId(99)));
+  sut.addDeclaration(nameId(0));
+  EXPECT_TRUE(sut.isDeclared(nameId(0)));
+}
@@ -8,6 +8,7 @@
 namespace {
 
 constexpr char input_file[] = "lib/tests/data/test.jack";
+constexpr char comments_input_file[] = "lib/tests/data/test_comments.jack";
 
 }  // namespace
 
@@ -32,3 +33,68 @@ TEST(JackTokenizerTest, ParseTest) {
   }
   EXPECT_FALSE(tokens.hasMoreTokens());
 }
+
+TEST(JackTokenizerTest, SinglePassParseTest) {
+  const std::vector<std::string> kGroundTruth = {
+      "class", "Main",   "{",          "function",   "void",    "main", "(",
+      ")",     "{",      "var",        "SquareGame", "game",    ";",    "let",
+      "game",  "=",      "SquareGame", ".",          "new",     "(",    ")",
+      ";",     "do",     "game",       ".",          "run",     "(",    ")",
+      ";",     "do",     "game",       ".",          "dispose", "(",    ")",
+      ";",     "return", ";",          "}",          "}",
+  };
+
+  JackTokenizer sut(input_file, LexMode::kSinglePass);
+  auto tokens = sut.parseInputFile();
+  Tokens gt(kGroundTruth);
+
+  while (gt.hasMoreTokens()) {
+    EXPECT_EQ(tokens.tokenType(), gt.tokenType());
+    tokens.advance();
+    gt.advance();
+  }
+  EXPECT_FALSE(tokens.hasMoreTokens());
+}
+
+TEST(JackTokenizerTest, SinglePassCommentsAndStringsTest) {
+  const std::vector<std::string> kGroundTruth = {
+      "class",
+      "Main",
+      "{",
+      "function",
+      "void",
+      "main",
+      "(",
+      ")",
+      "{",
+      "do",
+      "Output",
+      ".",
+      "printString",
+      "(",
+      "\"hello, world // not a comment\"",
+      ")",
+      ";",
+      "return",
+      "1",
+      "/",
+      "2",
+      ";",
+      "}",
+      "}",
+  };
+
+  JackTokenizer sut(comments_input_file, LexMode::kSinglePass);
+  auto tokens = sut.parseInputFile();
+  Tokens gt(kGroundTruth);
+
+  while (gt.hasMoreTokens()) {
+    EXPECT_EQ(tokens.tokenType(), gt.tokenType());
+    if (gt.tokenType() == TokenType::kStringConst) {
+      EXPECT_EQ(tokens.stringVal(), "hello, world // not a comment");
+    }
+    tokens.advance();
+    gt.advance();
+  }
+  EXPECT_FALSE(tokens.hasMoreTokens());
+}
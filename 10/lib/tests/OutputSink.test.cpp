@@ -0,0 +1,40 @@
+// No copyright.
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/OutputSink.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+constexpr char output_file[] = "./dummy_sink.txt";
+
+}  // namespace
+
+TEST(OutputSinkTest, AppendsAcrossFlushes) {
+  const std::string large(40, 'x');
+  {
+    BufferedFileSink sut(output_file, 16);
+    sut.append("<symbol> ");
+    sut.append("{");
+    sut.append(" </symbol>\n");
+    sut.append(large);
+    sut.append("\n");
+    sut.flush();
+  }
+  EXPECT_EQ(readAll(output_file), "<symbol> { </symbol>\n" + large + "\n");
+}
+
+TEST(OutputSinkTest, FlushesOnDestruction) {
+  {
+    BufferedFileSink sut(output_file);
+    sut.append("tail");
+  }
+  EXPECT_EQ(readAll(output_file), "tail");
+}
+
+TEST(OutputSinkTest, OpenFailureThrows) {
+  EXPECT_THROW(BufferedFileSink("./no_such_directory/out.xml"),
+               std::runtime_error);
+}
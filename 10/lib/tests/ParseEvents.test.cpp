@@ -0,0 +1,97 @@
+// No copyright.
+
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+#include "lib/ParseEvents.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+namespace {
+
+// Events of a let statement with a string and an integer term.
+ParseEventLog makeLetLog() {
+  ParseEventLog log;
+  log.beginNode(NodeKind::kLetStatement);
+  log.addKeyword(KeyWordType::kLet);
+  log.addIdentifier("x");
+  log.addSymbol(SymbolType::kEqual);
+  log.beginNode(NodeKind::kExpression);
+  log.beginNode(NodeKind::kTerm);
+  log.addStringConstant("a\\");
+  log.endNode(NodeKind::kTerm);
+  log.beginNode(NodeKind::kTerm);
+  log.addIntegerConstant(32767);
+  log.endNode(NodeKind::kTerm);
+  log.endNode(NodeKind::kExpression);
+  log.addSymbol(SymbolType::kSemicolon);
+  log.endNode(NodeKind::kLetStatement);
+  return log;
+}
+
+}  // namespace
+
+TEST(ParseEventsTest, RecordsEvents) {
+  const auto sut = makeLetLog();
+  ASSERT_EQ(sut.events().size(), 14u);
+  const auto& identifier = sut.events()[2];
+  EXPECT_EQ(identifier.kind, ParseEventKind::kTerminal);
+  EXPECT_EQ(identifier.tokenType(), TokenType::kIdentifier);
+  EXPECT_EQ(sut.text(identifier), "x");
+  EXPECT_EQ(sut.text(sut.events()[1]), "let");
+  EXPECT_EQ(sut.events()[4].nodeKind(), NodeKind::kExpression);
+}
+
+TEST(ParseEventsTest, WriteXMLTokens) {
+  StringSink sink;
+  writeXMLTokens(makeLetLog(), &sink);
+  EXPECT_EQ(sink.output,
+            "<keyword> let </keyword>\n"
+            "<identifier> x </identifier>\n"
+            "<symbol> = </symbol>\n"
+            "<stringConstant> a\\ </stringConstant>\n"
+            "<integerConstant> 32767 </integerConstant>\n"
+            "<symbol> ; </symbol>\n");
+}
+
+TEST(ParseEventsTest, WriteJSON) {
+  StringSink sink;
+  writeJSON(makeLetLog(), &sink);
+  EXPECT_EQ(sink.output,
+            "{\"kind\":\"fragment\",\"children\":["
+            "{\"kind\":\"letStatement\",\"children\":["
+            "{\"keyword\":\"let\"},{\"identifier\":\"x\"},{\"symbol\":\"=\"},"
+            "{\"kind\":\"expression\",\"children\":["
+            "{\"kind\":\"term\",\"children\":[{\"stringConstant\":\"a\\\\\"}]},"
+            "{\"kind\":\"term\",\"children\":[{\"integerConstant\":32767}]}]},"
+            "{\"symbol\":\";\"}]}]}\n");
+}
+
+TEST(ParseEventsTest, AppendRenumbersTexts) {
+  ParseEventLog log;
+  log.addIdentifier("y");
+  log.append(makeLetLog());
+  StringSink sink;
+  writeXMLTokens(log, &sink);
+  EXPECT_EQ(sink.output,
+            "<identifier> y </identifier>\n"
+            "<keyword> let </keyword>\n"
+            "<identifier> x </identifier>\n"
+            "<symbol> = </symbol>\n"
+            "<stringConstant> a\\ </stringConstant>\n"
+            "<integerConstant> 32767 </integerConstant>\n"
+            "<symbol> ; </symbol>\n");
+}
+
+TEST(ParseEventsTest, BuildSyntaxTree) {
+  const auto log = makeLetLog();
+  Arena arena;
+  const auto& root = buildSyntaxTree(log, &arena);
+  EXPECT_EQ(root.kind, NodeKind::kFragment);
+  const auto* let = root.first_child;
+  ASSERT_NE(let, nullptr);
+  EXPECT_EQ(let->kind, NodeKind::kLetStatement);
+  EXPECT_EQ(let->first_child->text, "let");
+  EXPECT_EQ(let->last_child->text, ";");
+  EXPECT_EQ(let->next_sibling, nullptr);
+}
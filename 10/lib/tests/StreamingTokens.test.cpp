@@ -0,0 +1,72 @@
+// No copyright.
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/StreamingTokens.hpp"
+
+namespace {
+
+StreamingTokens makeTokens(const std::string& source) {
+  auto buffer = std::make_shared<const std::string>(source);
+  const std::string_view view(*buffer);
+  return StreamingTokens(std::move(buffer), view);
+}
+
+}  // namespace
+
+TEST(StreamingTokensTest, MatchesTokens) {
+  auto sut = makeTokens(
+      "class Main { // comment\n"
+      "  function void main() { let x = a[1] + \"s t\"; return; } }");
+  Tokens expected(std::vector<std::string>{
+      "class", "Main", "{", "function", "void", "main", "(", ")", "{",
+      "let", "x", "=", "a", "[", "1", "]", "+", "\"s t\"", ";", "return",
+      ";", "}", "}"});
+
+  while (true) {
+    ASSERT_EQ(sut.tokenType(), expected.tokenType());
+    EXPECT_EQ(sut.peek(0).text, expected.peek(0).text);
+    EXPECT_EQ(sut.peek(0).subtype, expected.peek(0).subtype);
+    if (expected.tokenType() == TokenType::kIdentifier) {
+      EXPECT_EQ(sut.identifierId(), expected.identifierId());
+    }
+    if (!expected.hasMoreTokens()) {
+      break;
+    }
+    ASSERT_TRUE(sut.hasMoreTokens());
+    sut.advance();
+    expected.advance();
+  }
+  EXPECT_FALSE(sut.hasMoreTokens());
+  EXPECT_EQ(sut.symbolType(), SymbolType::kRightCurlyBracket);
+}
+
+TEST(StreamingTokensTest, PeekWithinLookahead) {
+  auto sut = makeTokens("do f(1);");
+  EXPECT_EQ(sut.keyWord(), KeyWordType::kDo);
+  EXPECT_EQ(sut.peek(1).text, "f");
+  EXPECT_TRUE(sut.peek(2).isSymbol(SymbolType::kLeftParenthesis));
+  EXPECT_EQ(sut.peek(StreamingTokens::kMaxLookahead).text, "1");
+
+  sut.advance();
+  EXPECT_EQ(sut.identifier(), "f");
+  EXPECT_EQ(sut.peek(3).text, ")");
+  sut.advance();
+  sut.advance();
+  EXPECT_EQ(sut.intVal(), 1);
+  EXPECT_EQ(sut.peek(2).text, ";");
+  EXPECT_EQ(sut.peek(3).type, TokenType::kFieldSize);
+}
+
+TEST(StreamingTokensTest, EmptySource) {
+  auto sut = makeTokens("  // nothing\n");
+  EXPECT_FALSE(sut.hasMoreTokens());
+  EXPECT_THROW(sut.tokenType(), std::runtime_error);
+  EXPECT_THROW(sut.advance(), std::runtime_error);
+}
@@ -0,0 +1,56 @@
+// No copyright.
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/StringInterner.hpp"
+
+TEST(StringInternerTest, IdsAreDenseAndStable) {
+  StringInterner sut;
+  EXPECT_EQ(sut.intern("x"), 0u);
+  EXPECT_EQ(sut.intern("y"), 1u);
+  EXPECT_EQ(sut.intern("x"), 0u);
+  EXPECT_EQ(sut.size(), 2u);
+}
+
+TEST(StringInternerTest, CopiesText) {
+  StringInterner sut;
+  std::string name = "counter";
+  const auto id = sut.intern(name);
+  name = "changed";
+  EXPECT_EQ(sut.text(id), "counter");
+  EXPECT_EQ(sut.intern("counter"), id);
+  EXPECT_THROW(sut.text(id + 1), std::runtime_error);
+}
+
+TEST(StringInternerTest, ThreadsAgreeOnIds) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumNames = 1000;
+  StringInterner sut;
+  std::vector<std::vector<IdentifierId>> ids(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      // Every thread interns the same names, in a different order.
+      for (int i = 0; i < kNumNames; ++i) {
+        const auto name = (i + t * 250) % kNumNames;
+        ids[t].push_back(sut.intern("name" + std::to_string(name)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(sut.size(), std::size_t{kNumNames});
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumNames; ++i) {
+      const auto name = (i + t * 250) % kNumNames;
+      EXPECT_EQ(sut.text(ids[t][i]), "name" + std::to_string(name));
+    }
+  }
+}
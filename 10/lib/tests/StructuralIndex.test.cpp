@@ -0,0 +1,69 @@
+// No copyright.
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/StructuralIndex.hpp"
+
+namespace {
+
+// Tokens' table, which only the Tokens constructor classifies.
+StructuralIndex indexOf(const std::vector<std::string>& tokens) {
+  const Tokens classified(tokens);
+  return StructuralIndex(classified.table());
+}
+
+}  // namespace
+
+TEST(StructuralIndexTest, MatchesBrackets) {
+  //                       0    1    2    3    4    5    6    7    8    9
+  const auto sut = indexOf({"{", "(", "a", "[", "1", "]", ")", "{", "}", "}"});
+  EXPECT_EQ(sut.matching(0), 9u);
+  EXPECT_EQ(sut.matching(9), 0u);
+  EXPECT_EQ(sut.matching(1), 6u);
+  EXPECT_EQ(sut.matching(3), 5u);
+  EXPECT_EQ(sut.matching(7), 8u);
+  EXPECT_EQ(sut.matching(2), StructuralIndex::kNoMatch);
+  EXPECT_EQ(sut.matching(10), StructuralIndex::kNoMatch);
+}
+
+TEST(StructuralIndexTest, LeavesUnbalancedBracketsUnmatched) {
+  const auto sut = indexOf({"(", "{", ")", "}", "]", "("});
+  EXPECT_EQ(sut.matching(0), StructuralIndex::kNoMatch);
+  EXPECT_EQ(sut.matching(1), 3u);
+  EXPECT_EQ(sut.matching(2), StructuralIndex::kNoMatch);
+  EXPECT_EQ(sut.matching(4), StructuralIndex::kNoMatch);
+  EXPECT_EQ(sut.matching(5), StructuralIndex::kNoMatch);
+}
+
+TEST(StructuralIndexTest, SubroutineSpans) {
+  const auto sut = indexOf({
+      "class", "C", "{", "field", "int", "n", ";",           // 0-6
+      "method", "void", "f", "(", "int", "a", ")", "{",     // 7-14
+      "if", "(", "a", ")", "{", "}", "}",                    // 15-21
+      "function", "int", "g", "(", ")", "{", "return", "1",  // 22-29
+      ";", "}",                                              // 30-31
+      "function", "void", "h", "(", ")", "{",                // 32-37
+      "let", "n", "=", "(", "1", "}",                        // 38-43
+      "}",
+  });
+  ASSERT_EQ(sut.subroutineSpans().size(), 2u);
+  EXPECT_EQ(sut.subroutineSpans()[0].begin, 7u);
+  EXPECT_EQ(sut.subroutineSpans()[0].end, 22u);
+  EXPECT_EQ(sut.subroutineSpans()[1].begin, 22u);
+  EXPECT_EQ(sut.subroutineSpans()[1].end, 32u);
+  // The unclosed '(' leaves h's body, and so the class, unbalanced.
+  EXPECT_EQ(sut.matching(37), StructuralIndex::kNoMatch);
+  EXPECT_EQ(sut.matching(2), StructuralIndex::kNoMatch);
+}
+
+TEST(StructuralIndexTest, SkipsLongRunsWithoutBrackets) {
+  std::vector<std::string> tokens{"{"};
+  for (int i = 0; i < 100; ++i) {
+    tokens.push_back("x");
+  }
+  tokens.push_back("}");
+  const auto sut = indexOf(tokens);
+  EXPECT_EQ(sut.matching(0), 101u);
+}
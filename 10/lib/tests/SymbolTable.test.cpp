@@ -0,0 +1,70 @@
+// No copyright.
+
+#include <stdexcept>
+#include <string_view>
+
+#include "gtest/gtest.h"
+#include "lib/StringInterner.hpp"
+#include "lib/SymbolTable.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+TEST(SymbolTableTest, IndicesRunPerKind) {
+  SymbolTable sut;
+  sut.define(idOf("a"), idOf("int"), SymbolKind::kField);
+  sut.define(idOf("b"), idOf("int"), SymbolKind::kStatic);
+  const auto& c = sut.define(idOf("c"), idOf("Point"), SymbolKind::kField);
+  EXPECT_EQ(c.index, 1);
+  EXPECT_EQ(c.type, idOf("Point"));
+  EXPECT_EQ(sut.count(SymbolKind::kField), 2);
+  EXPECT_EQ(sut.count(SymbolKind::kStatic), 1);
+  EXPECT_EQ(sut.count(SymbolKind::kLocal), 0);
+
+  const auto* b = sut.find(idOf("b"));
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(b->kind, SymbolKind::kStatic);
+  EXPECT_EQ(b->index, 0);
+  EXPECT_EQ(sut.find(idOf("d")), nullptr);
+}
+
+TEST(SymbolTableTest, PopScopeDropsItsSymbolsAndIndices) {
+  SymbolTable sut;
+  sut.define(idOf("x"), idOf("int"), SymbolKind::kField);
+  for (int subroutine = 0; subroutine < 2; ++subroutine) {
+    sut.pushScope();
+    EXPECT_EQ(sut.scopeDepth(), 1u);
+    sut.reserve(SymbolKind::kArgument);
+    EXPECT_EQ(sut.define(idOf("y"), idOf("int"), SymbolKind::kArgument).index,
+              1);
+    EXPECT_EQ(sut.define(idOf("z"), idOf("int"), SymbolKind::kLocal).index,
+              0);
+    EXPECT_NE(sut.find(idOf("z")), nullptr);
+    sut.popScope();
+  }
+  EXPECT_EQ(sut.scopeDepth(), 0u);
+  EXPECT_EQ(sut.size(), 1u);
+  EXPECT_EQ(sut.find(idOf("y")), nullptr);
+  EXPECT_EQ(sut.count(SymbolKind::kArgument), 0);
+  EXPECT_NE(sut.find(idOf("x")), nullptr);
+  EXPECT_THROW(sut.popScope(), std::runtime_error);
+}
+
+TEST(SymbolTableTest, InnerScopeShadows) {
+  SymbolTable sut;
+  sut.define(idOf("x"), idOf("int"), SymbolKind::kField);
+  sut.pushScope();
+  sut.define(idOf("x"), idOf("char"), SymbolKind::kLocal);
+  EXPECT_EQ(sut.find(idOf("x"))->kind, SymbolKind::kLocal);
+  sut.popScope();
+  EXPECT_EQ(sut.find(idOf("x"))->kind, SymbolKind::kField);
+}
+
+TEST(SymbolTableTest, DeclaringTwiceInAScopeThrows) {
+  SymbolTable sut;
+  sut.define(idOf("x"), idOf("int"), SymbolKind::kField);
+  try {
+    sut.define(idOf("x"), idOf("int"), SymbolKind::kStatic);
+    FAIL();
+  } catch (const std::runtime_error& error) {
+    EXPECT_STREQ(error.what(), "Cannot declare twice: x");
+  }
+}
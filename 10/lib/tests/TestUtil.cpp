@@ -0,0 +1,22 @@
+// No copyright.
+// Helpers shared by the tests.
+
+#include "lib/tests/TestUtil.hpp"
+
+#include <fstream>
+#include <sstream>
+
+void StringSink::append(const std::string_view fragment) {
+  output.append(fragment);
+}
+
+IdentifierId idOf(const std::string_view name) {
+  return identifierPool().intern(name);
+}
+
+std::string readAll(const std::string& filename) {
+  std::ifstream input(filename);
+  std::stringstream content;
+  content << input.rdbuf();
+  return content.str();
+}
@@ -0,0 +1,28 @@
+// No copyright.
+// Helpers shared by the tests.
+
+#ifndef LIB_TESTS_TESTUTIL_HPP_
+#define LIB_TESTS_TESTUTIL_HPP_
+
+#include <string>
+#include <string_view>
+
+#include "lib/OutputSink.hpp"
+#include "lib/StringInterner.hpp"
+
+// Keeps everything appended in memory.
+class StringSink final : public IOutputSink {
+ public:
+  void append(std::string_view fragment) override;
+  void flush() override {}
+
+  std::string output;
+};
+
+// identifierPool() ID of name, interning it if needed.
+IdentifierId idOf(std::string_view name);
+
+// The contents of a file, empty if it cannot be read.
+std::string readAll(const std::string& filename);
+
+#endif  // LIB_TESTS_TESTUTIL_HPP_
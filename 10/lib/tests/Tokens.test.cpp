@@ -1,11 +1,23 @@
 // No copyright.
 
+#include <memory>
+#include <string>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "lib/Tokens.hpp"
 
+namespace {
+
+const std::vector<std::string> kKeywordNameStrings(std::cbegin(kKeywordNames),
+                                                   std::cend(kKeywordNames));
+const std::vector<std::string> kSymbolStrings(std::cbegin(kSymbols),
+                                              std::cend(kSymbols));
+
+}  // namespace
+
 TEST(TokensTest, tokenTypeKeywordNamesTest) {
-  Tokens sut(kKeywordNames);
+  Tokens sut(kKeywordNameStrings);
   for (int i = 0; i < kKeywordNames.size() - 1; ++i) {
     EXPECT_EQ(sut.tokenType(), TokenType::kKeyWord);
     sut.advance();
@@ -15,7 +27,7 @@ TEST(TokensTest, tokenTypeKeywordNamesTest) {
 }
 
 TEST(TokensTest, tokenTypeSymbolsTest) {
-  Tokens sut(kSymbols);
+  Tokens sut(kSymbolStrings);
   for (int i = 0; i < kSymbols.size() - 1; ++i) {
     EXPECT_EQ(sut.tokenType(), TokenType::kSymbol);
     sut.advance();
@@ -25,7 +37,7 @@ TEST(TokensTest, tokenTypeSymbolsTest) {
 }
 
 TEST(TokensTest, KeyWordTestOk) {
-  Tokens sut(kKeywordNames);
+  Tokens sut(kKeywordNameStrings);
   for (int i = 0; i < kKeywordNames.size() - 1; ++i) {
     EXPECT_EQ(sut.keyWord(), static_cast<KeyWordType>(i));
     sut.advance();
@@ -40,7 +52,7 @@ TEST(JackTokenizerTest, KeyWordTestUnknownKeyRuntimeError) {
 }
 
 TEST(TokensTest, SymbolTestOk) {
-  Tokens sut(kSymbols);
+  Tokens sut(kSymbolStrings);
   for (int i = 0; i < kSymbols.size() - 1; ++i) {
     EXPECT_EQ(sut.symbol(), kSymbols[i]);
     sut.advance();
@@ -49,6 +61,60 @@ TEST(TokensTest, SymbolTestOk) {
   EXPECT_FALSE(sut.hasMoreTokens());
 }
 
+TEST(TokensTest, SymbolTypeTestOk) {
+  Tokens sut(kSymbolStrings);
+  for (int i = 0; i < kSymbols.size() - 1; ++i) {
+    EXPECT_EQ(sut.symbolType(), static_cast<SymbolType>(i));
+    sut.advance();
+  }
+  EXPECT_EQ(sut.symbolType(), SymbolType::kTilde);
+
+  Tokens keyword({"class"});
+  EXPECT_THROW(keyword.symbolType(), std::runtime_error);
+}
+
+TEST(TokensTest, EmptyTokensThrowWhenAccessed) {
+  Tokens sut(std::vector<std::string>{});
+  EXPECT_FALSE(sut.hasMoreTokens());
+  EXPECT_THROW(sut.tokenType(), std::runtime_error);
+  EXPECT_THROW(sut.keyWord(), std::runtime_error);
+  EXPECT_THROW(sut.symbol(), std::runtime_error);
+  EXPECT_EQ(sut.peek(0).type, TokenType::kFieldSize);
+}
+
+TEST(TokensTest, PeekDoesNotMoveCursor) {
+  Tokens sut({"do", "Output", ".", "println", "(", ")", ";"});
+  sut.advance();
+
+  const auto next = sut.peek(1);
+  EXPECT_TRUE(next.isSymbol(SymbolType::kPeriod));
+  EXPECT_EQ(next.text, ".");
+  const auto name = sut.peek(2);
+  EXPECT_EQ(name.type, TokenType::kIdentifier);
+  EXPECT_EQ(name.text, "println");
+  EXPECT_EQ(sut.peek(0).text, "Output");
+  EXPECT_EQ(sut.peek(6).type, TokenType::kFieldSize);
+  EXPECT_EQ(sut.identifier(), "Output");
+}
+
+TEST(TokensTest, SliceSharesTable) {
+  Tokens sut({"let", "x", "=", "1", ";", "return", ";"});
+  auto slice = sut.slice(1, 4);
+  EXPECT_EQ(&slice.table(), &sut.table());
+  EXPECT_EQ(slice.position(), 1u);
+  EXPECT_EQ(slice.identifier(), "x");
+  slice.advance();
+  slice.advance();
+  EXPECT_EQ(slice.intVal(), 1);
+  EXPECT_FALSE(slice.hasMoreTokens());
+  EXPECT_EQ(slice.peek(1).type, TokenType::kFieldSize);
+  EXPECT_THROW(sut.slice(4, 8), std::runtime_error);
+
+  sut.seek(5);
+  EXPECT_EQ(sut.keyWord(), KeyWordType::kReturn);
+  EXPECT_THROW(sut.seek(7), std::runtime_error);
+}
+
 TEST(JackTokenizerTest, SymbolTestUnknownKeyRuntimeError) {
   Tokens sut({"unknown key"});
   EXPECT_THROW(sut.symbol(), std::runtime_error);
@@ -100,3 +166,73 @@ TEST(JackTokenizerTest, IdentifierUnknownKeyRuntimeError) {
     EXPECT_THROW(sut.identifier(), std::runtime_error);
   }
 }
+
+TEST(TokensTest, ClassifiedTableIntoSourceOk) {
+  auto source = std::make_shared<const std::string>("let s = \"a b\";");
+  TokenTable table;
+  table.push(TokenType::kKeyWord, static_cast<std::uint16_t>(KeyWordType::kLet),
+             0, 3);
+  table.push(TokenType::kIdentifier, 0, 4, 1);
+  table.push(TokenType::kSymbol,
+             static_cast<std::uint16_t>(SymbolType::kEqual), 6, 1);
+  table.push(TokenType::kStringConst, 0, 8, 5);
+  table.push(TokenType::kSymbol,
+             static_cast<std::uint16_t>(SymbolType::kSemicolon), 13, 1);
+
+  Tokens sut(source, *source, std::move(table));
+  EXPECT_EQ(sut.tokenType(), TokenType::kKeyWord);
+  EXPECT_EQ(sut.keyWord(), KeyWordType::kLet);
+  sut.advance();
+  EXPECT_EQ(sut.identifier(), "s");
+  EXPECT_EQ(sut.identifier().data(), source->data() + 4);
+  sut.advance();
+  EXPECT_EQ(sut.symbol(), "=");
+  sut.advance();
+  EXPECT_EQ(sut.stringVal(), "a b");
+  sut.advance();
+  EXPECT_EQ(sut.symbol(), ";");
+  EXPECT_FALSE(sut.hasMoreTokens());
+}
+
+TEST(TokensTest, IdentifierIdsAreShared) {
+  Tokens sut({"let", "x", "=", "y", "+", "x", ";"});
+  EXPECT_THROW(sut.identifierId(), std::runtime_error);
+  sut.advance();
+  const auto x = sut.identifierId();
+  EXPECT_EQ(x, identifierPool().intern("x"));
+  EXPECT_EQ(identifierPool().text(x), "x");
+  sut.advance();
+  sut.advance();
+  EXPECT_NE(sut.identifierId(), x);
+  sut.advance();
+  sut.advance();
+  EXPECT_EQ(sut.identifierId(), x);
+}
+
+TEST(TokensTest, InvalidTokenThrowsOnlyWhenAccessed) {
+  Tokens sut({"let", "ng-name", ";"});
+  EXPECT_EQ(sut.keyWord(), KeyWordType::kLet);
+  sut.advance();
+  EXPECT_THROW(sut.tokenType(), std::runtime_error);
+  sut.advance();
+  EXPECT_EQ(sut.symbol(), ";");
+}
+
+TEST(TokensTest, KeywordTypeOfRecognizesOnlyKeywords) {
+  for (std::size_t i = 0; i < kKeywordNames.size(); ++i) {
+    EXPECT_EQ(keywordTypeOf(kKeywordNames[i]), static_cast<KeyWordType>(i));
+  }
+  for (const auto name : {"", "d", "dot", "clas", "classes", "Class", "thus",
+                          "fields", "functions", "constructo"}) {
+    EXPECT_EQ(keywordTypeOf(name), KeyWordType::kFieldSize);
+  }
+}
+
+TEST(TokensTest, SymbolTypeOfOk) {
+  for (std::size_t i = 0; i < kSymbols.size(); ++i) {
+    EXPECT_EQ(symbolTypeOf(kSymbols[i][0]), static_cast<SymbolType>(i));
+  }
+  for (const auto c : {'a', '0', '_', '"', ' ', '\\', ':', '\0'}) {
+    EXPECT_EQ(symbolTypeOf(c), SymbolType::kFieldSize);
+  }
+}
@@ -0,0 +1,90 @@
+// No copyright.
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "lib/IR.hpp"
+#include "lib/StringInterner.hpp"
+#include "lib/VMBackend.hpp"
+#include "lib/VMWriter.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+TEST(VMBackendTest, LowersFunction) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  // while (~(a[i] < -2)) { let s = s + "A"; } return s;
+  const auto condition = builder.newBlock();
+  const auto end = builder.newBlock();
+  builder.placeBlock(condition);
+  builder.load(SymbolKind::kArgument, 0);
+  builder.load(SymbolKind::kLocal, 1);
+  builder.binary(IRBinaryOp::kAdd);
+  builder.loadIndirect();
+  builder.constant(-2);
+  builder.binary(IRBinaryOp::kLessThan);
+  builder.unary(IRUnaryOp::kNot);
+  const auto body = builder.newBlock();
+  builder.branch(body, end);
+  builder.placeBlock(body);
+  builder.load(SymbolKind::kStatic, 0);
+  builder.string("A");
+  builder.binary(IRBinaryOp::kAdd);
+  builder.store(SymbolKind::kStatic, 0);
+  builder.jump(condition);
+  builder.placeBlock(end);
+  builder.load(SymbolKind::kStatic, 0);
+  builder.ret();
+
+  StringSink sink;
+  VMWriter writer(&sink);
+  VMBackend sut(&writer);
+  sut.lower(builder.endFunction(2));
+  EXPECT_EQ(sink.output,
+            "function Main.f 2\n"
+            "label L0\n"
+            "push argument 0\n"
+            "push local 1\n"
+            "add\n"
+            "pop pointer 1\n"
+            "push that 0\n"
+            "push constant 1\n"
+            "not\n"
+            "lt\n"
+            "not\n"
+            "not\n"
+            "if-goto L2\n"
+            "push static 0\n"
+            "push constant 1\n"
+            "call String.new 1\n"
+            "push constant 65\n"
+            "call String.appendChar 2\n"
+            "add\n"
+            "pop static 0\n"
+            "goto L0\n"
+            "label L2\n"
+            "push static 0\n"
+            "return\n");
+}
+
+TEST(VMBackendTest, RejectsTemporariesOutOfStackOrder) {
+  IRBuilder builder;
+  builder.beginFunction(idOf("Main"), idOf("f"));
+  builder.constant(1);
+  builder.constant(2);
+  builder.binary(IRBinaryOp::kSub);
+  builder.ret();
+  auto function = builder.endFunction(0);
+  IRInstruction swapped[3] = {function.blocks[0].instructions[0],
+                              function.blocks[0].instructions[1],
+                              function.blocks[0].instructions[2]};
+  std::swap(swapped[2].lhs, swapped[2].rhs);
+  function.blocks[0].instructions = swapped;
+
+  StringSink sink;
+  VMWriter writer(&sink);
+  VMBackend sut(&writer);
+  EXPECT_THROW(sut.lower(function), std::runtime_error);
+}
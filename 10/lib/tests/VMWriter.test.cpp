@@ -0,0 +1,76 @@
+// No copyright.
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+#include "lib/VMWriter.hpp"
+#include "lib/tests/TestUtil.hpp"
+
+TEST(VMWriterTest, WritesCommands) {
+  StringSink sink;
+  VMWriter sut(&sink);
+  sut.writeFunction("Main", "main", 2);
+  sut.writePush(VMSegment::kConstant, 32767);
+  sut.writePush(VMSegment::kArgument, 1);
+  sut.writeArithmetic(VMArithmetic::kAdd);
+  sut.writePop(VMSegment::kLocal, 0);
+  sut.writeLabel("WHILE_EXP", 0);
+  sut.writePush(VMSegment::kThat, 0);
+  sut.writeArithmetic(VMArithmetic::kNot);
+  sut.writeIf("WHILE_END", 0);
+  sut.writeCall("Output", "printInt", 1);
+  sut.writePop(VMSegment::kTemp, 0);
+  sut.writeGoto("WHILE_EXP", 0);
+  sut.writeLabel("WHILE_END", 0);
+  sut.writePush(VMSegment::kStatic, 3);
+  sut.writePop(VMSegment::kPointer, 1);
+  sut.writePush(VMSegment::kThis, 12);
+  sut.writeArithmetic(VMArithmetic::kNeg);
+  sut.writeReturn();
+
+  EXPECT_EQ(sink.output,
+            "function Main.main 2\n"
+            "push constant 32767\n"
+            "push argument 1\n"
+            "add\n"
+            "pop local 0\n"
+            "label WHILE_EXP0\n"
+            "push that 0\n"
+            "not\n"
+            "if-goto WHILE_END0\n"
+            "call Output.printInt 1\n"
+            "pop temp 0\n"
+            "goto WHILE_EXP0\n"
+            "label WHILE_END0\n"
+            "push static 3\n"
+            "pop pointer 1\n"
+            "push this 12\n"
+            "neg\n"
+            "return\n");
+}
+
+TEST(VMWriterTest, WritesEveryArithmeticCommand) {
+  StringSink sink;
+  VMWriter sut(&sink);
+  for (const auto command :
+       {VMArithmetic::kAdd, VMArithmetic::kSub, VMArithmetic::kNeg,
+        VMArithmetic::kEq, VMArithmetic::kGt, VMArithmetic::kLt,
+        VMArithmetic::kAnd, VMArithmetic::kOr, VMArithmetic::kNot}) {
+    sut.writeArithmetic(command);
+  }
+  EXPECT_EQ(sink.output, "add\nsub\nneg\neq\ngt\nlt\nand\nor\nnot\n");
+}
+
+TEST(VMWriterTest, RejectsInvalidCommands) {
+  StringSink sink;
+  VMWriter sut(&sink);
+  EXPECT_THROW(sut.writePop(VMSegment::kConstant, 0), std::runtime_error);
+  EXPECT_THROW(sut.writePush(VMSegment::kConstant, 32768),
+               std::runtime_error);
+  EXPECT_THROW(sut.writePush(VMSegment::kFieldSize, 0), std::runtime_error);
+  EXPECT_THROW(sut.writeArithmetic(VMArithmetic::kFieldSize),
+               std::runtime_error);
+  EXPECT_EQ(sink.output, "");
+}
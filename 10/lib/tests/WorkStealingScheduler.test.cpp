@@ -0,0 +1,86 @@
+// No copyright.
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/WorkStealingScheduler.hpp"
+
+namespace {
+
+// Sums [begin, end) by splitting it in halves down to single elements.
+void sumRange(WorkStealingScheduler* scheduler, const int begin,
+              const int end, std::atomic<long>* sum) {
+  if (end - begin == 1) {
+    *sum += begin;
+    return;
+  }
+  const int middle = begin + (end - begin) / 2;
+  TaskGroup group;
+  scheduler->spawn(&group, [=] { sumRange(scheduler, begin, middle, sum); });
+  scheduler->spawn(&group, [=] { sumRange(scheduler, middle, end, sum); });
+  scheduler->wait(&group);
+}
+
+}  // namespace
+
+TEST(WorkStealingSchedulerTest, RunsEveryTask) {
+  WorkStealingScheduler sut(4);
+  std::atomic<int> sum{0};
+  TaskGroup group;
+  for (int i = 1; i <= 1000; ++i) {
+    sut.spawn(&group, [&sum, i] { sum += i; });
+  }
+  sut.wait(&group);
+  EXPECT_EQ(sum, 500500);
+}
+
+TEST(WorkStealingSchedulerTest, NestedSpawnDoesNotDeadlock) {
+  // Every worker ends up waiting inside a task, so waiters have to run the
+  // queued tasks themselves.
+  WorkStealingScheduler sut(2);
+  std::atomic<long> sum{0};
+  sumRange(&sut, 0, 4096, &sum);
+  EXPECT_EQ(sum, 4096L * 4095 / 2);
+}
+
+TEST(WorkStealingSchedulerTest, IdleWorkersSteal) {
+  WorkStealingScheduler sut(4);
+  std::atomic<int> started{0};
+  TaskGroup outer;
+  // A single task spawns everything onto its own worker's deque. The other
+  // tasks can only start elsewhere if they are stolen.
+  sut.spawn(&outer, [&] {
+    TaskGroup inner;
+    for (int i = 0; i < 4; ++i) {
+      sut.spawn(&inner, [&started] {
+        ++started;
+        while (started < 4) {
+          std::this_thread::yield();
+        }
+      });
+    }
+    sut.wait(&inner);
+  });
+  sut.wait(&outer);
+  EXPECT_EQ(started, 4);
+}
+
+TEST(WorkStealingSchedulerTest, WaitRethrowsTaskError) {
+  WorkStealingScheduler sut(2);
+  std::atomic<int> count{0};
+  TaskGroup group;
+  sut.spawn(&group, [] { throw std::runtime_error("task failed"); });
+  for (int i = 0; i < 10; ++i) {
+    sut.spawn(&group, [&count] { ++count; });
+  }
+  EXPECT_THROW(sut.wait(&group), std::runtime_error);
+  EXPECT_EQ(count, 10);
+  EXPECT_NO_THROW(sut.wait(&group));
+}
+
+TEST(WorkStealingSchedulerTest, ThreadCountFor) {
+  EXPECT_EQ(WorkStealingScheduler::threadCountFor(3), 3u);
+  EXPECT_GE(WorkStealingScheduler::threadCountFor(0), 1u);
+}
@@ -1,27 +1,106 @@
 // No copyright.
 // Main program code.
 
+#include <cstddef>
+#include <filesystem>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "lib/HackBackend.hpp"
 #include "lib/JackAnalyzer.hpp"
+#include "lib/JackBatch.hpp"
+#include "lib/OutputSink.hpp"
+#include "lib/WorkStealingScheduler.hpp"
 
+// Usage:
+//   JackAnalyzerMain [-j N]
+//                    [--tokens-and-tree | --stream | --outline | --vm | --asm]
+//                    source... output
+// With --tokens-and-tree, output receives the parse tree and the token
+// listing goes next to it with a T suffix, as in the reference files.
+// With --stream, output receives the parse tree, written while parsing in
+// bounded memory. With --outline, output receives the parse tree of the
+// declarations only, skipping subroutine bodies. With --vm, output receives
+// VM code, generated while parsing, and with --asm Hack assembly.
+// A single source file is compiled to the output file. Otherwise sources may
+// be files or directories of .jack files, output is a directory receiving
+// X.xml, X.vm or X.asm for every X.jack. N threads compile the files
+// and, within a file, its subroutines; by default one thread per hardware
+// thread.
+// With --asm, the directory also receives 0Bootstrap.asm, which sets up the
+// stack and calls Sys.init. Hack runs a single file from its first
+// instruction, so compile the program and the OS in one run and concatenate
+// the directory's .asm files in name order, which puts the bootstrap first
+// as class names cannot start with a digit:
+//   JackAnalyzerMain --asm Program OS out && cat out/*.asm > Program.asm
 int main(int argc, char* argv[]) {
-  if (argc != 3) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::size_t num_threads = 0;
+  AnalyzerOutput output = AnalyzerOutput::kXMLTokens;
+  std::size_t first_source = 0;
+  try {
+    for (; first_source < args.size(); ++first_source) {
+      const auto& arg = args[first_source];
+      if (arg == "-j" && first_source + 1 < args.size()) {
+        num_threads = std::stoul(args[++first_source]);
+      } else if (arg == "--tokens-and-tree") {
+        output = AnalyzerOutput::kTokensAndTreeXML;
+      } else if (arg == "--stream") {
+        output = AnalyzerOutput::kStreamingTreeXML;
+      } else if (arg == "--outline") {
+        output = AnalyzerOutput::kOutlineXML;
+      } else if (arg == "--vm") {
+        output = AnalyzerOutput::kVMCode;
+      } else if (arg == "--asm") {
+        output = AnalyzerOutput::kHackAssembly;
+      } else {
+        break;
+      }
+    }
+  } catch (const std::logic_error& e) {
+    std::cout << "Invalid num of threads" << std::endl;
+    return 1;
+  }
+  if (args.size() < first_source + 2) {
     std::cout << "Invalid num of inputs" << std::endl;
     return 1;
   }
 
-  const std::string source(argv[1]);
-  const std::string output_filename(argv[2]);
+  const std::vector<std::string> sources(args.begin() + first_source,
+                                         args.end() - 1);
+  const std::string& output_filename = args.back();
 
   try {
-    JackAnalyzer analyzer(source, output_filename);
-    analyzer.compileToXML();
-  } catch (std::runtime_error e) {
+    if (sources.size() == 1 && !std::filesystem::is_directory(sources[0])) {
+      WorkStealingScheduler scheduler(
+          WorkStealingScheduler::threadCountFor(num_threads));
+      JackAnalyzer analyzer(sources[0], output_filename, &scheduler);
+      analyzer.compile(output);
+      return 0;
+    }
+
+    const auto extension = output == AnalyzerOutput::kVMCode ? ".vm"
+                           : output == AnalyzerOutput::kHackAssembly ? ".asm"
+                                                                     : ".xml";
+    const auto failures =
+        compileAll(compileJobsFor(sources, output_filename, extension), output,
+                   num_threads);
+    if (output == AnalyzerOutput::kHackAssembly) {
+      std::filesystem::create_directories(output_filename);
+      BufferedFileSink bootstrap(
+          (std::filesystem::path(output_filename) / "0Bootstrap.asm")
+              .string());
+      writeHackBootstrap(&bootstrap);
+      bootstrap.flush();
+    }
+    for (const auto& failure : failures) {
+      std::cerr << failure.source << ": " << failure.message << std::endl;
+    }
+    return failures.empty() ? 0 : 1;
+  } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return 1;
   }
-
-  return 0;
 }